@@ -0,0 +1,99 @@
+/**
+ * @file StreamingBench.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ *
+ * @brief Comparison of the DOM and streaming loads of a big entity's file and a big subscription's file.
+ * @details The files are generated in a temporary directory, then loaded once with load (the whole file parsed in a json) or stream (each name or component applied once parsed).
+ * @details The peak memory is the one of the whole process, run each mode in its own process to compare them.
+ * @details Built from the root of the repository with the sources of src, e.g.: g++ -std=c++20 -O2 -Iinclude bench/StreamingBench.cpp src/[A-Z]*.cpp -o streamingBench
+ * @details Usage: streamingBench dom|stream [names = 200000] [components = 120000]
+ */
+
+#include <TailorMade.h>
+#include <chrono>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+	void writeFiles(const filesystem::path& directory, size_t names, size_t components) {
+		filesystem::create_directories(directory);
+
+		ofstream entityFile(directory / "entities.json");
+		entityFile << "{\"tags\": [\"Bench\"], \"names\": [";
+		for (size_t i = 0; i < names; ++i) {
+			entityFile << (i ? "," : "") << "\"Entity" << i << "\"";
+		}
+		entityFile << "]}";
+
+		ofstream componentFile(directory / "transform.json");
+		componentFile << "{\"name\": \"Transform\", \"data\": {\"position\": \"vector3\", \"scale\": \"float\", \"label\": \"string\"}}";
+
+		// The same component again and again, each entry is applied on the entity.
+		ofstream subsFile(directory / "subscription.json");
+		subsFile << "{\"entity\": \"Entity0\", \"components\": [";
+		for (size_t i = 0; i < components; ++i) {
+			subsFile << (i ? "," : "") << "{\"name\": \"Transform\", \"data\": {\"position\": [" << i << ", 1.5, -2], \"scale\": " << i % 7 << ".25, \"label\": \"entry" << i << "\"}}";
+		}
+		subsFile << "]}";
+	}
+
+	double elapsed(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv) {
+	string mode = argc > 1 ? argv[1] : "";
+	if (mode != "dom" && mode != "stream") {
+		cerr << "Usage: " << argv[0] << " dom|stream [names] [components]" << endl;
+		return 1;
+	}
+	size_t names = argc > 2 ? stoul(argv[2]) : 200000;
+	size_t components = argc > 3 ? stoul(argv[3]) : 120000;
+	bool streamed = mode == "stream";
+
+	filesystem::path directory = filesystem::temp_directory_path() / "TailorMadeStreamingBench";
+	writeFiles(directory, names, components);
+	string entityPath = (directory / "entities.json").string();
+	string subsPath = (directory / "subscription.json").string();
+
+	shared_ptr<EntityManager> entityManager = make_shared<EntityManager>();
+	shared_ptr<unorMapCM> managers = make_shared<unorMapCM>();
+	(*managers)["Transform"] = make_shared<ComponentManager>((directory / "transform.json").string());
+	Subscription subscription(directory.string(), entityManager, managers, {});
+
+	auto start = chrono::steady_clock::now();
+	if (streamed) {
+		entityManager->stream(entityPath);
+	}
+	else {
+		ifstream file(entityPath);
+		entityManager->load(nlohmann::json::parse(file));
+	}
+	double entityTime = elapsed(start);
+
+	start = chrono::steady_clock::now();
+	if (streamed) {
+		subscription.stream(subsPath);
+	}
+	else {
+		ifstream file(subsPath);
+		subscription.load(subsPath, nlohmann::json::parse(file));
+	}
+	double subsTime = elapsed(start);
+
+	// The same result whatever the mode.
+	shared_ptr<Component> component = (*managers)["Transform"]->getComponent(entityManager->getEntity("Entity0"));
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	cout << mode << ": " << entityManager->getEntities("Bench", false).size() << " entities in " << entityTime << " ms, ";
+	cout << components << " components in " << subsTime << " ms (last label: " << component->get<string>("label") << "), ";
+	cout << "peak memory: " << usage.ru_maxrss / 1024 << " MiB" << endl;
+
+	filesystem::remove_all(directory);
+	return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file Aggregate.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _AGGREGATE_H
+#define _AGGREGATE_H
+
+#include <ComponentManager.h>
+#include <span>
+
+/**
+ * Statistics of an int, float or bool data over entities, a bool counts as 0 or 1.
+ * The minimum, the maximum and the mean are 0 if no entity was read.
+ */
+typedef struct Statistics {
+    /// Number of entities read.
+    size_t count = 0;
+    double sum = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+} Statistics;
+
+/**
+ * Statistics of a Vector2/Vector3 data over entities, per coordinate (z = 0 for a Vector2).
+ * The minimum, the maximum and the mean are null if no entity was read.
+ */
+typedef struct VectorStatistics {
+    /// Number of entities read.
+    size_t count = 0;
+    Vector3 sum = { 0.0f, 0.0f, 0.0f };
+    Vector3 min = { 0.0f, 0.0f, 0.0f };
+    Vector3 max = { 0.0f, 0.0f, 0.0f };
+    Vector3 mean = { 0.0f, 0.0f, 0.0f };
+} VectorStatistics;
+
+ /**
+ * @file Aggregate.h
+ * @brief Aggregate implementation
+ *
+ * @details This Aggregate class computes statistics and histograms of a data over the entities of a ComponentManager, in parallel over the global ThreadPool.
+ * @details The manager is locked once to list the components, each component is then locked once to read the data in place (no copy, no exception), and the values are reduced by blocks with VectorMath::reduce.
+ * @details The ints are summed exactly on 64 bits, the floats in float by blocks then in double, the results don't depend on the number of threads.
+ * @details The entities can be limited to a list (e.g.: the entities with a tag, or the result of a ValueIndex), each entity of the list should be given once.
+ */
+
+class Aggregate {
+public:
+    /**
+     * @brief Return the statistics of an int, float or bool data.
+     * @warning An error is thrown if the data is not an int, a float or a bool.
+     * @param manager The manager whose entities are read.
+     * @param field The data's name.
+     * @param checkState If true, the entities whose component is disabled are not read.
+     */
+    static Statistics statistics(ComponentManager& manager, const std::string& field, bool checkState = true);
+
+    /**
+     * @brief Version limited to the given entities, the ones without this component are ignored.
+     */
+    static Statistics statistics(ComponentManager& manager, const std::string& field, std::span<const int> entities, bool checkState = true);
+
+    /**
+     * @brief Return the statistics of a Vector2/Vector3 data, per coordinate.
+     * @warning An error is thrown if the data is not a Vector2 or a Vector3.
+     * @param manager The manager whose entities are read.
+     * @param field The data's name.
+     * @param checkState If true, the entities whose component is disabled are not read.
+     */
+    static VectorStatistics vectorStatistics(ComponentManager& manager, const std::string& field, bool checkState = true);
+
+    /**
+     * @brief Version limited to the given entities, the ones without this component are ignored.
+     */
+    static VectorStatistics vectorStatistics(ComponentManager& manager, const std::string& field, std::span<const int> entities, bool checkState = true);
+
+    /**
+     * @brief Return the number of entities in each of the bins splitting [min, max] evenly, the values outside (and NaN) are not counted.
+     * @warning An error is thrown if the data is not an int, a float or a bool, if there is no bin or if max is not greater than min.
+     * @param manager The manager whose entities are read.
+     * @param field The data's name.
+     * @param bins Number of bins.
+     * @param min Lower bound of the first bin.
+     * @param max Upper bound of the last bin (included).
+     * @param checkState If true, the entities whose component is disabled are not read.
+     */
+    static std::vector<size_t> histogram(ComponentManager& manager, const std::string& field, size_t bins, double min, double max, bool checkState = true);
+
+    /**
+     * @brief Version limited to the given entities, the ones without this component are ignored.
+     */
+    static std::vector<size_t> histogram(ComponentManager& manager, const std::string& field, size_t bins, double min, double max, std::span<const int> entities, bool checkState = true);
+
+private:
+    /**
+     * @brief Return the components of the given entities (of every entity if null), under one lock of the manager.
+     */
+    static std::vector<std::shared_ptr<Component>> gather(ComponentManager& manager, const std::span<const int>* entities, bool checkState);
+
+    /**
+     * @brief Return the type ID of a scalar data (int, float or bool), an error is thrown otherwise.
+     */
+    static size_t scalarType(ComponentManager& manager, const std::string& field);
+
+    static Statistics reduce(const std::vector<std::shared_ptr<Component>>& components, const std::string& field, size_t typeID);
+    static VectorStatistics reduceVectors(const std::vector<std::shared_ptr<Component>>& components, const std::string& field);
+    static std::vector<size_t> count(const std::vector<std::shared_ptr<Component>>& components, const std::string& field, size_t bins, double min, double max);
+
+    /**
+     * @brief Read the data of each component of the range [begin, end), call read(value) with its value.
+     */
+    template<typename Read>
+    static void read(const std::vector<std::shared_ptr<Component>>& components, size_t begin, size_t end, const std::string& field, Read read);
+};
+
+#endif //_AGGREGATE_H
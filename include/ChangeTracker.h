@@ -0,0 +1,97 @@
+/**
+ * @file ChangeTracker.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _CHANGETRACKER_H
+#define _CHANGETRACKER_H
+
+#include <ComponentManager.h>
+#include <mutex>
+
+ /**
+ * @file ChangeTracker.h
+ * @brief ChangeTracker implementation
+ *
+ * @details This ChangeTracker class gives a change tick to the entities of a ComponentManager: each write through Component::set and each subscription bumps the tick of the manager, and the entity takes it.
+ * @details The changes are kept in order in a log, the entities changed since a tick are found in O(changed) (e.g.: a System syncing only the modified entities, see System::addChanged).
+ * @details The entities already subscribed when the tracker is created count as changed once.
+ * @warning The data written without Component::set are not seen, call touch for them.
+ */
+
+class ChangeTracker : public ComponentListener {
+public:
+    /**
+     * @brief Constructor of the ChangeTracker, the entities already subscribed to the manager count as changed.
+     * @details The tracker should then be added to the manager's listeners (see Environment::enableChangeTracking, which does both).
+     * @param manager The followed manager.
+     */
+    ChangeTracker(std::shared_ptr<ComponentManager> manager);
+
+    ChangeTracker(const ChangeTracker&) = delete;
+    ChangeTracker& operator=(const ChangeTracker&) = delete;
+
+    /**
+     * @brief Return the tick of the last change, 0 if nothing changed.
+     */
+    uint64_t getTick();
+
+    /**
+     * @brief Return the tick of the last change of an entity, 0 if it is not subscribed.
+     */
+    uint64_t getTick(int entity);
+
+    /**
+     * @brief Return the entities changed after the given tick, each once, from the least recently changed.
+     * @param tick The tick of the previous call (0 the first time), updated to the tick of the last change.
+     */
+    std::vector<int> changedSince(uint64_t& tick);
+
+    /**
+     * @brief Mark a subscribed entity as changed (e.g.: after writing its data without Component::set).
+     */
+    void touch(int entity);
+
+    /**
+     * @brief Return the followed manager, nullptr if it doesn't exist anymore.
+     */
+    std::shared_ptr<ComponentManager> getManager();
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+private:
+    /**
+     * The followed manager, weak as the manager keeps its listeners.
+     */
+    std::weak_ptr<ComponentManager> manager;
+
+    uint64_t tick = 0;
+
+    /**
+     * The tick of the last change of each subscribed entity.
+     */
+    std::unordered_map<int, uint64_t> ticks;
+
+    /**
+     * The changes {tick, entity} by increasing tick. An entity's change is outdated if the entity changed again since.
+     */
+    std::vector<std::pair<uint64_t, int>> log;
+
+    std::mutex mtx;
+
+    /**
+     * @brief Give the next tick to an entity, the tracker should be locked.
+     */
+    void bump(int entity);
+
+    /**
+     * @brief Remove the outdated changes once the log is much longer than the number of entities, the tracker should be locked.
+     */
+    void compact();
+};
+
+#endif //_CHANGETRACKER_H
@@ -10,6 +10,12 @@
 #define _COMPONENT_H
 
 #include <TM_Tools.h>
+#include <memory>
+#include <atomic>
+#include <optional>
+
+class ComponentManager;
+
  /**
  * @file Component.h
  * @brief Component implementation
@@ -20,7 +26,9 @@
  */
 
 
-class Component {
+class Component : public std::enable_shared_from_this<Component> {
+    friend class ComponentManager;
+    friend class Aggregate;
 public: 
     Component() = default;
 
@@ -55,6 +63,13 @@ public:
      * @param name Data's name.
      */
     const std::string& getType(const std::string& name);
+
+    /**
+     * @brief Return the type ID of the given data (or std::variant_npos if the data doesn't exist).
+     * @see typeToID
+     * @param name Data's name.
+     */
+    size_t getTypeID(const std::string& name);
     
     /**
      * @brief Return a vector with the names of every data from this component.
@@ -66,6 +81,18 @@ public:
      * @details Can be used for serialization of the data or to make a copy of the component.
      */
     const dataUnMap& getRawData();
+
+    /**
+     * @brief Return a copy of the component's data structure, taken under its lock.
+     * @details To use instead of getRawData when a data can be written meanwhile by another thread (e.g.: from a listener).
+     */
+    dataUnMap copyRawData();
+
+    /**
+     * @brief Return a copy of the value of a data, taken under the component's lock, or nothing if the data doesn't exist.
+     * @param name Data's name.
+     */
+    std::optional<std::variant<ECS_Types>> copyValue(const std::string& name);
     
     /**
      * @brief Append to the given stream a serialized version of the data.
@@ -122,6 +149,29 @@ private:
      * Placeholder string initialized at "", used when a parameter is not valid for certain methods.
      */
     std::string placeholder;
+
+    /**
+     * The ComponentManager which owns this component, nullptr for a free component (e.g.: a reference component).
+     * Set by the manager when the component is attached to an entity, atomic as a data can be written meanwhile from another thread.
+     */
+    std::atomic<ComponentManager*> manager = nullptr;
+
+    /**
+     * The ID of the entity owning this component, -1 if the component is free.
+     */
+    std::atomic<int> entity = -1;
+
+    /**
+     * @brief Tell the owning manager that a data is about to be written.
+     * @param name Data's name.
+     */
+    void beforeSet(const std::string& name);
+
+    /**
+     * @brief Tell the owning manager that a data has been written.
+     * @param name Data's name.
+     */
+    void afterSet(const std::string& name);
 };
 
 template<typename Type>
@@ -134,7 +184,12 @@ inline Type Component::get(const std::string& name) {
         }
 
         std::variant<ECS_Types> data = dataMap[name].second;
-        return std::get<Type>(data); // Be careful of bad conversion here
+        if constexpr (CustomType<Type>) {
+            return std::get<CustomValue>(data).get<Type>();
+        }
+        else {
+            return std::get<Type>(data); // Be careful of bad conversion here
+        }
     }
     catch (std::exception& e) {
         std::cerr << "Component : " << e.what() << std::endl;
@@ -144,18 +199,29 @@ inline Type Component::get(const std::string& name) {
 
 template<typename Type>
 inline void Component::set(const std::string& name, Type value) {
-    std::scoped_lock lock(mtx);
-    try {
-        if (!dataMap.contains(name)) {
-            //No data with this name
-            throw std::runtime_error("Error : no data with the name \"" + name + "\".");
+    // The manager's listeners are called outside of the lock, they are free to read the component.
+    if (manager) beforeSet(name);
+    {
+        std::scoped_lock lock(mtx);
+        try {
+            if (!dataMap.contains(name)) {
+                //No data with this name
+                throw std::runtime_error("Error : no data with the name \"" + name + "\".");
+            }
+            if constexpr (CustomType<Type>) {
+                dataMap[name].second = CustomValue(value);
+            }
+            else {
+                dataMap[name].second = value;
+            }
+        }
+        catch (std::exception& e) {
+            std::cerr << "Component : " << e.what() << std::endl; // Be careful, some values will throw an error if you try to implicit cast towards them.
+            // For example, Vector3 ---> integer won't work.
+            return;
         }
-        dataMap[name].second = value;
-    }
-    catch (std::exception& e) {
-        std::cerr << "Component : " << e.what() << std::endl; // Be careful, some values will throw an error if you try to implicit cast towards them.
-        // For example, Vector3 ---> integer won't work.
     }
+    if (manager) afterSet(name);
 }
 
 #endif //_COMPONENT_H
\ No newline at end of file
@@ -9,6 +9,62 @@
 #define _COMPONENTMANAGER_H
 #include <Component.h>
 #include <memory>
+#include <algorithm>
+#include <atomic>
+
+class ComponentManager;
+
+/**
+ * @brief Interface to follow the changes made inside a ComponentManager.
+ * @details Every method has an empty default implementation, override only the ones you need.
+ * @details The listeners are called outside of the manager's lock, but on the thread which made the change.
+ */
+class ComponentListener {
+public:
+    virtual ~ComponentListener() = default;
+
+    /**
+     * @brief Called once an entity has been subscribed to the manager.
+     * @param manager The manager which changed.
+     * @param entity The ID of the subscribed entity.
+     */
+    virtual void onSubscribe(ComponentManager& manager, int entity) {}
+
+    /**
+     * @brief Called once an entity has been unsubscribed from the manager.
+     * @param manager The manager which changed.
+     * @param entity The ID of the unsubscribed entity.
+     * @param component The component the entity had.
+     * @param state The state the component had.
+     */
+    virtual void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) {}
+
+    /**
+     * @brief Called once the state of an entity's component has changed.
+     * @param manager The manager which changed.
+     * @param entity The ID of the entity.
+     * @param oldState The state before the change.
+     */
+    virtual void onStateChange(ComponentManager& manager, int entity, bool oldState) {}
+
+    /**
+     * @brief Called right before a data of an entity's component is written.
+     * @param manager The manager which changed.
+     * @param entity The ID of the entity.
+     * @param component The component about to be written.
+     * @param name Data's name.
+     */
+    virtual void beforeSet(ComponentManager& manager, int entity, Component& component, const std::string& name) {}
+
+    /**
+     * @brief Called right after a data of an entity's component has been written.
+     * @param manager The manager which changed.
+     * @param entity The ID of the entity.
+     * @param component The written component.
+     * @param name Data's name.
+     */
+    virtual void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) {}
+};
 
  /**
  * @file ComponentManager.h
@@ -21,6 +77,12 @@
 
 
 class ComponentManager {
+    friend class Component;
+    friend class SpatialIndex;
+    friend class ValueIndex;
+    friend class Aggregate;
+    friend class ChangeTracker;
+    friend class Hierarchy;
 public:
     /**
      * @brief The main constructor of the ComponentManager, created the components based of the file's description.
@@ -41,12 +103,25 @@ public:
      */
     const std::string& getName();
     
+    /**
+     * @brief Return the reference component of this manager, with the types and default values of its data.
+     * @warning Changing it changes the default values of the next subscriptions.
+     */
+    std::shared_ptr<Component> getReference();
+
     /**
      * @brief Return a string which give the type of the data.
      * @details Wrapper of the component's method for the save action.
      * @param data Data's name.
      */
     const std::string& getType(const std::string& data);
+
+    /**
+     * @brief Return the type ID of the data, resolved once when the component's file was read.
+     * @details Used by the subscriptions to convert their values, see valueToType.
+     * @param data Data's name.
+     */
+    size_t getTypeID(const std::string& data);
     
     /**
      * @brief Subscribe an entity to this component.
@@ -62,12 +137,37 @@ public:
      * @see dataVector
      */
     void subscribe(int entity, dataVector data);
+
+    /**
+     * @brief Subscribe a set of entities to this component with the same values, in one batch.
+     * @details Works like subscribe(entity, data) on each entity, but the manager is locked only twice and its storage is reserved up front.
+     * @param entities The IDs of the entities to subscribe, without duplicates.
+     * @param data A vector with the data's names and values.
+     * @see dataVector
+     */
+    void subscribe(const std::vector<int>& entities, const dataVector& data);
+
+    /**
+     * @brief Link an existing component to an entity, with the given state.
+     * @details If the entity already has a component, it is replaced.
+     * @details Mostly used to restore a component previously removed (e.g.: rollbacks).
+     * @param entity The ID of the entity.
+     * @param component The component to link, it should come from this manager.
+     * @param state The state of the component.
+     */
+    void attach(int entity, std::shared_ptr<Component> component, bool state = true);
     
     /**
      * @brief Remove the link between an entity and its component.
      * @param entity The ID of the entity to unsubscribe.
      */
     void unsubscribe(int entity);
+
+    /**
+     * @brief Unsubscribe a set of entities in one batch, the manager is locked once.
+     * @param entities The IDs of the entities to unsubscribe, the ones not subscribed are ignored.
+     */
+    void unsubscribe(const std::vector<int>& entities);
     
     /**
      * @brief Return the list of entities linked in this component's manager.
@@ -101,6 +201,13 @@ public:
      * @param newState The entity's component new state.
      */
     void setState(int entity, bool newState);
+
+    /**
+     * @brief Set the state of the components of a set of entities in one batch, the manager is locked once.
+     * @param entities The IDs of the entities, the ones not subscribed are ignored.
+     * @param newState The components' new state.
+     */
+    void setState(const std::vector<int>& entities, bool newState);
     
     /**
      * @brief Give the ownership, or make a copy, of an entity's component to another component. 
@@ -116,6 +223,28 @@ public:
      */
     void toString(std::ostream& stream);
 
+    /**
+     * @brief Change the data of the managed component, the subscribed components keep the values of their remaining data.
+     * @details The new data, and the ones whose type changed, get the default value of the given reference. The removed ones are erased.
+     * @warning The listeners are not informed, the change is not a data write.
+     * @param reference A component with the new data, its types and default values.
+     */
+    void reshape(std::shared_ptr<Component> reference);
+
+    /**
+     * @brief Add a listener which will be informed of every change in this manager.
+     * @details Adding the same listener twice does nothing.
+     * @param listener The listener to add.
+     * @see ComponentListener
+     */
+    void addListener(std::shared_ptr<ComponentListener> listener);
+
+    /**
+     * @brief Remove a listener previously added.
+     * @param listener The listener to remove.
+     */
+    void removeListener(std::shared_ptr<ComponentListener> listener);
+
 private: 
     /**
      * A map which with the entities' IDs linked to the entity's component and state.
@@ -131,6 +260,36 @@ private:
      * Mutex to protect the modification on the ComponentManager, make it usable in thread.
      */
     std::mutex mtx;
+
+    typedef std::vector<std::shared_ptr<ComponentListener>> listenerVector;
+
+    /**
+     * Listeners informed of the changes of this manager.
+     * Replaced by a copy on each registration (under the lock), the changes iterate a snapshot of them: a listener can register or unregister from a callback.
+     * Atomic, a data write takes its snapshot without locking the manager.
+     */
+    std::atomic<std::shared_ptr<const listenerVector>> listeners = std::make_shared<const listenerVector>();
+
+    /**
+     * @brief Return the current listeners, without locking the manager.
+     */
+    std::shared_ptr<const listenerVector> getListeners();
+
+    /**
+     * @brief Called by a component of this manager before one of its data is written.
+     */
+    void beforeSet(int entity, Component& component, const std::string& name);
+
+    /**
+     * @brief Called by a component of this manager after one of its data is written.
+     */
+    void afterSet(int entity, Component& component, const std::string& name);
+
+    /**
+     * @brief Create a new component for the given entity, with the reference's default values.
+     * @param entity The ID of the entity which will own the component.
+     */
+    std::shared_ptr<Component> makeComponent(int entity);
 };
 
 #endif //_COMPONENTMANAGER_H
\ No newline at end of file
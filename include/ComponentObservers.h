@@ -0,0 +1,134 @@
+/**
+ * @file ComponentObservers.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _COMPONENTOBSERVERS_H
+#define _COMPONENTOBSERVERS_H
+
+#include <ComponentManager.h>
+#include <span>
+#include <functional>
+#include <mutex>
+
+/**
+ * Events of the entities of a ComponentManager, observed by batches.
+ */
+enum class ComponentEvent {
+    /// The entity subscribed to the component.
+    Add,
+    /// The entity unsubscribed from the component.
+    Remove,
+    /// A data of the entity's component was written through Component::set.
+    Set,
+    /// The entity's component was enabled or disabled.
+    StateChange
+};
+
+/// Observer of an event, called with the batch of the entities concerned.
+using ComponentObserver = std::function<void(std::span<const int> entities)>;
+
+ /**
+ * @file ComponentObservers.h
+ * @brief ComponentObservers implementation
+ *
+ * @details This ComponentObservers class gathers the events of the entities of a ComponentManager, and gives them by batches to the observers when flushed (e.g.: once per frame).
+ * @details The events are coalesced between two flushes: an entity is given once per event, an entity added then removed is not given, and the Set/StateChange of an entity added in the batch are part of its Add.
+ * @details The batches are given in the order Remove, Add, Set, StateChange. An entity removed then added again is in both Remove and Add.
+ * @details The observers are called outside of any lock, they can write components (the events go in the next batch) and register or unregister observers (taken into account at the next flush).
+ * @details Unlike the environment's notifiers, which call every system per entity, an observer is only called for the events it observes.
+ */
+
+class ComponentObservers : public ComponentListener {
+public:
+    /**
+     * @brief Constructor of the ComponentObservers, the observers should then be added to the manager's listeners (see Environment::observe, which does both).
+     * @param manager The observed manager.
+     */
+    ComponentObservers(std::shared_ptr<ComponentManager> manager);
+
+    ComponentObservers(const ComponentObservers&) = delete;
+    ComponentObservers& operator=(const ComponentObservers&) = delete;
+
+    /**
+     * @brief Register an observer of an event.
+     * @return The observer's ID, to unregister it.
+     */
+    size_t observe(ComponentEvent event, ComponentObserver observer);
+
+    /**
+     * @brief Unregister an observer, nothing is done if the ID is unknown.
+     */
+    void unobserve(size_t ID);
+
+    /**
+     * @brief Return the number of registered observers.
+     */
+    size_t size();
+
+    /**
+     * @brief Give the batches of the events gathered since the previous flush to their observers.
+     * @details Called at the sync point chosen by the user, from one thread at a time.
+     */
+    void flush();
+
+    /**
+     * @brief Add a Set event for a subscribed entity (e.g.: after writing its data without Component::set).
+     */
+    void touch(int entity);
+
+    /**
+     * @brief Return the observed manager, nullptr if it doesn't exist anymore.
+     */
+    std::shared_ptr<ComponentManager> getManager();
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void onStateChange(ComponentManager& manager, int entity, bool oldState) override;
+    void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+private:
+    typedef struct Observer {
+        size_t ID;
+        ComponentEvent event;
+        ComponentObserver function;
+    } Observer;
+
+    /**
+     * Events of an entity since the previous flush, as bits.
+     */
+    enum Pending : uint8_t {
+        Added = 1,
+        Removed = 2,
+        Written = 4,
+        Switched = 8
+    };
+
+    /**
+     * The observed manager, weak as the manager keeps its listeners.
+     */
+    std::weak_ptr<ComponentManager> manager;
+
+    /**
+     * The observers, replaced by a copy on each registration so a flush can use them without lock.
+     */
+    std::shared_ptr<const std::vector<Observer>> observers;
+    size_t nextID = 0;
+
+    /**
+     * The entities with events since the previous flush with their events, in the order of their first event, and their index in it.
+     */
+    std::vector<std::pair<int, uint8_t>> events;
+    std::unordered_map<int, size_t> positions;
+
+    std::mutex mtx;
+
+    /**
+     * @brief Add an event of an entity to its pending events, the observers should be locked.
+     */
+    void add(int entity, ComponentEvent event);
+};
+
+#endif //_COMPONENTOBSERVERS_H
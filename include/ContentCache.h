@@ -0,0 +1,103 @@
+/**
+ * @file ContentCache.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _CONTENTCACHE_H
+#define _CONTENTCACHE_H
+
+#include <Subscription.h>
+
+class Environment;
+
+ /**
+ * @file ContentCache.h
+ * @brief ContentCache implementation
+ *
+ * @details This ContentCache class turns the entities, components and subscriptions directories into one binary image, which can be loaded without reading any JSON.
+ * @details The image stores the result of the loading: the entities in their IDs' order (the generated ones already expanded) with their tags, the components' types and default values, and the subscriptions already resolved on their entities.
+ * @details Every name is written once in a table of strings, the rest of the image refers to it by index.
+ * @details The image keeps a hash of the sources' files, it is not used anymore once one of them changes.
+ * @warning The image is written in the native endianness, it is not portable between architectures.
+ */
+
+class ContentCache {
+public:
+    /**
+     * @brief Map the image's file in memory, nothing is read yet.
+     * @details A missing file gives an empty cache, never valid.
+     * @param path Path of the image's file.
+     */
+    ContentCache(const std::string& path);
+
+    /**
+     * @brief Unmap the image's file.
+     */
+    ~ContentCache();
+
+    ContentCache(const ContentCache&) = delete;
+    ContentCache& operator=(const ContentCache&) = delete;
+
+    /**
+     * @brief Return true if the image is complete, of this version and made from the sources of the given hash.
+     * @param sourcesHash The hash of the current sources, see ContentCache::hashSources.
+     */
+    bool isValid(uint64_t sourcesHash);
+
+    /**
+     * @brief Fill an empty environment with the content of the image.
+     * @warning The image should be valid, see ContentCache::isValid.
+     * @param environment The environment to fill, it should have no entities nor ComponentManagers.
+     * @param subscriptionsPath The subscriptions' root directory, used to save the entities.
+     */
+    void load(Environment& environment, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Return the hash of the paths and content of every file in the given directories.
+     * @details The files are read and hashed in parallel over the threads of the global ThreadPool.
+     * @param entitiesPath The entities' root directory.
+     * @param componentsPath The components' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     */
+    static uint64_t hashSources(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Write the image of an environment.
+     * @details The image is written in a temporary file first, a crash can't leave a broken image.
+     * @param environment The environment freshly loaded from the sources.
+     * @param sourcesHash The hash of the sources the environment was loaded from.
+     * @param path Path of the image's file, replaced if it exists.
+     */
+    static void write(Environment& environment, uint64_t sourcesHash, const std::string& path);
+
+    /**
+     * @brief Load the given directories from their JSON files and write their image.
+     * @details The "compile" step, the image can then be given to the Environment's constructor.
+     * @param entitiesPath The entities' root directory.
+     * @param componentsPath The components' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     * @param path Path of the image's file, replaced if it exists.
+     */
+    static void compile(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath, const std::string& path);
+
+private:
+    /**
+     * The mapped content of the image, nullptr if the file couldn't be mapped.
+     */
+    const char* data;
+
+    /**
+     * Size in bytes of the image.
+     */
+    size_t size;
+
+    /**
+     * Handles of the mapping, only used on Windows.
+     */
+    void* fileHandle;
+    void* mappingHandle;
+};
+
+#endif //_CONTENTCACHE_H
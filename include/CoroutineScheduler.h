@@ -0,0 +1,370 @@
+/**
+ * @file CoroutineScheduler.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _COROUTINESCHEDULER_H
+#define _COROUTINESCHEDULER_H
+
+#include <Environment.h>
+#include <coroutine>
+#include <optional>
+#include <exception>
+
+class CoroutineScheduler;
+
+ /**
+ * @file CoroutineScheduler.h
+ * @brief Task implementation
+ *
+ * @details This Task class is the type of the coroutines run by a CoroutineScheduler (e.g.: the behaviour of an entity), they can co_await nextFrame(), seconds(x), event<Event>() and another Task.
+ * @details A Task does nothing until it is started by a scheduler, or awaited by a running Task.
+ */
+
+class Task {
+public:
+    struct FinalAwaiter;
+
+    struct promise_type {
+        /**
+         * The scheduler running the task, and the ID of the task started in it (the awaiting one for a nested task).
+         */
+        CoroutineScheduler* scheduler = nullptr;
+        size_t root = 0;
+
+        /**
+         * The task awaiting this one, resumed once it is done.
+         */
+        std::coroutine_handle<> continuation;
+
+        std::exception_ptr error;
+
+        Task get_return_object() noexcept;
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept;
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+        void await_resume() noexcept {}
+    };
+
+    Task(Task&& other) noexcept;
+    Task& operator=(Task&& other) noexcept;
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task();
+
+    /**
+     * A Task awaited by a running Task runs until it is done, its errors are thrown again in the awaiting one.
+     */
+    bool await_ready() noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> awaiting) noexcept;
+    void await_resume();
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {}
+
+    friend class CoroutineScheduler;
+};
+
+/**
+ * Awaited by a Task to be resumed at the next update of its scheduler.
+ */
+struct NextFrameAwaiter {
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<Task::promise_type> handle);
+    void await_resume() noexcept {}
+};
+
+/**
+ * Awaited by a Task to be resumed at the first update of its scheduler once the duration elapsed.
+ */
+struct SecondsAwaiter {
+    double duration;
+
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<Task::promise_type> handle);
+    void await_resume() noexcept {}
+};
+
+/**
+ * Awaited by a Task to be resumed with the first event of a type (accepted by the filter, if any) published on the environment's event bus.
+ */
+template<typename Event>
+struct EventAwaiter {
+    std::function<bool(const Event&)> filter;
+    std::optional<Event> value;
+
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<Task::promise_type> handle);
+    Event await_resume() { return std::move(*value); }
+};
+
+/// Resume the task at the next update.
+inline NextFrameAwaiter nextFrame() {
+    return {};
+}
+
+/// Resume the task once the duration, in seconds of the scheduler, elapsed.
+inline SecondsAwaiter seconds(double duration) {
+    return { duration };
+}
+
+/// Resume the task with the next event of this type, accepted by the filter if given (e.g.: a damage of this entity).
+template<typename Event>
+EventAwaiter<Event> event(std::function<bool(const Event&)> filter = nullptr) {
+    return { std::move(filter), std::nullopt };
+}
+
+ /**
+ * @file CoroutineScheduler.h
+ * @brief CoroutineScheduler implementation
+ *
+ * @details This CoroutineScheduler class runs Tasks, each update resumes by batch the tasks whose frame came, whose timer elapsed and whose event was published.
+ * @details A suspended task is only its coroutine's frame and a handle in one list: the sleeping ones are in a heap by time of wake up and the ones awaiting an event in the list of its type, nothing is done for them at each update.
+ * @details The events are received from the environment's event bus at its dispatch, and given at the next update.
+ * @details A task can be bound to an entity, to cancel every task of the entity at once. They are cancelled when the entity is removed from the environment.
+ * @details The scheduler is updated by one thread (e.g.: a task of the FrameLoop), an error thrown by a task ends it and is written on the error output.
+ * @warning The entities with bound tasks must be removed by the thread updating the scheduler.
+ */
+
+class CoroutineScheduler {
+public:
+    /**
+     * @brief Constructor of the CoroutineScheduler.
+     * @param environment The environment whose event bus gives the awaited events.
+     */
+    CoroutineScheduler(std::shared_ptr<Environment> environment);
+
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    /**
+     * @brief Destroy the tasks not done, the scheduler stops listening to the entities.
+     */
+    ~CoroutineScheduler();
+
+    /**
+     * @brief Start a task, it runs until its first suspension.
+     * @return The task's ID, to cancel it.
+     */
+    size_t start(Task task);
+
+    /**
+     * @brief Start a task bound to an entity.
+     * @see cancelEntity
+     */
+    size_t start(int entity, Task task);
+
+    /**
+     * @brief Cancel a task, its coroutine is destroyed. Nothing is done if it is done or unknown.
+     */
+    void cancel(size_t ID);
+
+    /**
+     * @brief Cancel every task bound to an entity.
+     */
+    void cancelEntity(int entity);
+
+    /**
+     * @brief Advance the time and resume the tasks due, the tasks suspended meanwhile are resumed at a next update.
+     * @param elapsed Time elapsed since the previous update, in seconds.
+     */
+    void update(double elapsed);
+
+    /**
+     * @brief Return the number of tasks not done.
+     */
+    size_t size();
+
+    /**
+     * @brief Return the time of the scheduler, the sum of the elapsed times of the updates.
+     */
+    double getTime();
+
+private:
+    /**
+     * A suspended coroutine, and the ID of the task it belongs to.
+     */
+    typedef struct Waiting {
+        size_t root;
+        std::coroutine_handle<> handle;
+    } Waiting;
+
+    typedef struct Sleeping {
+        double wake;
+        uint64_t order;
+        Waiting waiting;
+    } Sleeping;
+
+    typedef struct Root {
+        std::coroutine_handle<Task::promise_type> handle;
+        int entity;
+        bool bound;
+    } Root;
+
+    /**
+     * The events of a type received from the event bus, and the tasks awaiting them.
+     */
+    class EventQueue {
+    public:
+        virtual ~EventQueue() = default;
+
+        /**
+         * @brief Give the received events to the tasks awaiting them, the ones to resume are added to the batch.
+         */
+        virtual void match(CoroutineScheduler& scheduler, std::vector<Waiting>& batch) = 0;
+
+        size_t subscription = 0;
+    };
+
+    template<typename Event>
+    class TypedEventQueue : public EventQueue {
+    public:
+        /**
+         * The events received since the previous update, filled by the event bus.
+         */
+        std::vector<Event> received;
+        std::vector<Event> matching;
+        std::mutex mtx;
+
+        std::vector<std::pair<Waiting, EventAwaiter<Event>*>> waiters;
+
+        void match(CoroutineScheduler& scheduler, std::vector<Waiting>& batch) override;
+    };
+
+    /**
+     * Listener of the environment's entities, the tasks of a removed entity are cancelled.
+     */
+    class EntityRemovals : public EntityListener {
+    public:
+        EntityRemovals(CoroutineScheduler& scheduler) : scheduler(scheduler) {}
+
+        void onRemove(EntityManager& manager, int entity, const std::string& name) override;
+
+    private:
+        CoroutineScheduler& scheduler;
+    };
+
+    std::shared_ptr<Environment> environment;
+    std::shared_ptr<EntityRemovals> removals;
+
+    /**
+     * The tasks not done, by ID.
+     */
+    std::unordered_map<size_t, Root> tasks;
+    std::unordered_map<int, std::vector<size_t>> entityTasks;
+    size_t nextID;
+
+    /**
+     * The coroutines awaiting the next update, the sleeping ones as a heap by time of wake up.
+     */
+    std::vector<Waiting> nextFrames;
+    std::vector<Sleeping> sleeping;
+    uint64_t sleepOrder;
+
+    /**
+     * The event queues, by type.
+     */
+    std::unordered_map<const void*, std::unique_ptr<EventQueue>> events;
+
+    /**
+     * The coroutines resumed by the current update, kept to not allocate at each update.
+     */
+    std::vector<Waiting> batch;
+
+    double time;
+
+    /**
+     * The tasks being resumed (a task can start another one), and the ones cancelled meanwhile, destroyed once they suspend.
+     */
+    std::vector<size_t> running;
+    std::vector<size_t> cancelled;
+
+    /**
+     * @brief Register a task and run it until its first suspension.
+     */
+    size_t launch(Task task, int entity, bool bound);
+
+    /**
+     * @brief Resume a coroutine of a task, and end the task if it is done.
+     */
+    void resume(const Waiting& waiting);
+
+    /**
+     * @brief Destroy a task and forget it.
+     */
+    void finish(size_t ID);
+
+    template<typename Event>
+    static const void* eventKey();
+
+    template<typename Event>
+    void await(EventAwaiter<Event>* awaiter, const Waiting& waiting);
+
+    friend struct NextFrameAwaiter;
+    friend struct SecondsAwaiter;
+    template<typename Event>
+    friend struct EventAwaiter;
+};
+
+template<typename Event>
+inline void EventAwaiter<Event>::await_suspend(std::coroutine_handle<Task::promise_type> handle) {
+    handle.promise().scheduler->await(this, { handle.promise().root, handle });
+}
+
+template<typename Event>
+inline const void* CoroutineScheduler::eventKey() {
+    static const char key = 0;
+    return &key;
+}
+
+template<typename Event>
+inline void CoroutineScheduler::await(EventAwaiter<Event>* awaiter, const Waiting& waiting) {
+    std::unique_ptr<EventQueue>& queue = events[eventKey<Event>()];
+    if (!queue) {
+        auto typed = std::make_unique<TypedEventQueue<Event>>();
+        TypedEventQueue<Event>* received = typed.get();
+        // Kept until the next update, the event bus may dispatch from another thread.
+        typed->subscription = environment->getEventBus().subscribe<Event>([received](std::span<const Event> published) {
+            std::scoped_lock lock(received->mtx);
+            received->received.insert(received->received.end(), published.begin(), published.end());
+        });
+        queue = std::move(typed);
+    }
+    static_cast<TypedEventQueue<Event>&>(*queue).waiters.push_back({ waiting, awaiter });
+}
+
+template<typename Event>
+inline void CoroutineScheduler::TypedEventQueue<Event>::match(CoroutineScheduler& scheduler, std::vector<Waiting>& batch) {
+    {
+        std::scoped_lock lock(mtx);
+        matching.swap(received);
+    }
+    if (matching.empty()) return;
+
+    // In order of waiting, each task takes the first event it accepts.
+    std::erase_if(waiters, [&](const std::pair<Waiting, EventAwaiter<Event>*>& waiter) {
+        if (!scheduler.tasks.contains(waiter.first.root)) return true;
+        EventAwaiter<Event>& awaiter = *waiter.second;
+        for (const Event& event : matching) {
+            if (!awaiter.filter || awaiter.filter(event)) {
+                awaiter.value.emplace(event);
+                batch.push_back(waiter.first);
+                return true;
+            }
+        }
+        return false;
+    });
+    matching.clear();
+}
+
+#endif //_COROUTINESCHEDULER_H
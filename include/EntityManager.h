@@ -11,6 +11,43 @@
 #include <queue>
 #include <unordered_set>
 #include <TM_Tools.h>
+#include <memory>
+#include <algorithm>
+
+class EntityManager;
+
+/**
+ * @brief Interface to follow the changes made inside an EntityManager.
+ * @details Every method has an empty default implementation, override only the ones you need.
+ */
+class EntityListener {
+public:
+    virtual ~EntityListener() = default;
+
+    /**
+     * @brief Called once an entity has been created.
+     * @param manager The EntityManager which changed.
+     * @param entity The ID of the new entity.
+     * @param name The name of the new entity.
+     */
+    virtual void onCreate(EntityManager& manager, int entity, const std::string& name) {}
+
+    /**
+     * @brief Called once an entity has been removed.
+     * @param manager The EntityManager which changed.
+     * @param entity The ID the entity had.
+     * @param name The name the entity had.
+     */
+    virtual void onRemove(EntityManager& manager, int entity, const std::string& name) {}
+
+    /**
+     * @brief Called once a tag has been added to an entity.
+     * @param manager The EntityManager which changed.
+     * @param entity The ID of the entity.
+     * @param tag The added tag.
+     */
+    virtual void onTag(EntityManager& manager, int entity, const std::string& tag) {}
+};
 
  /**
  * @file EntityManager.h
@@ -31,8 +68,23 @@ public:
     /**
      * @brief Constructor of the EntityManager, take the root directory with the entities as a parameter.
      * @param directory The root directory with all the entities, files in subfolders are include.
+     * @param loadFiles If false, the entities' files are not loaded, the directory is only used to create new entities' files.
+     */
+    EntityManager(const std::string& directory, bool loadFiles = true);
+
+    /**
+     * @brief Create the entities described by the JSON of an entity's file.
+     * @param entityJSON The parsed content of the entity's file.
      */
-    EntityManager(const std::string& directory);
+    void load(const nlohmann::json& entityJSON);
+
+    /**
+     * @brief Create the entities of an entity's file, as its names are parsed.
+     * @details The file is read twice: once for everything but the names, then for the names, each one dropped once its entities are created.
+     * @details The memory used doesn't depend on the number of names, the result is the same as EntityManager::load.
+     * @param file Path of the entity's file.
+     */
+    void stream(const std::string& file);
     
     /**
      * @brief Return the ID of an Entity based on its name.
@@ -96,6 +148,26 @@ public:
      */
     void addTag(int entity, const std::string& tag);
 
+    /**
+     * @brief Return the tags of an entity.
+     * @param entity The ID of the entity.
+     */
+    std::vector<std::string> getTags(int entity);
+
+    /**
+     * @brief Add a listener which will be informed of every change in this manager.
+     * @details Adding the same listener twice does nothing.
+     * @param listener The listener to add.
+     * @see EntityListener
+     */
+    void addListener(std::shared_ptr<EntityListener> listener);
+
+    /**
+     * @brief Remove a listener previously added.
+     * @param listener The listener to remove.
+     */
+    void removeListener(std::shared_ptr<EntityListener> listener);
+
 private: 
     /**
      * Map on the entities' names and IDs.
@@ -135,6 +207,20 @@ private:
      * Store the tags of an entity.
      */
     std::unordered_map<std::string, std::unordered_set<int>> tags;
+
+    /**
+     * Listeners informed of the changes of this manager.
+     * Replaced by a copy on each registration, the changes iterate a snapshot of them: a listener can register or unregister from a callback (e.g.: the timers or the hierarchy added on their first use).
+     */
+    std::shared_ptr<const std::vector<std::shared_ptr<EntityListener>>> listeners = std::make_shared<const std::vector<std::shared_ptr<EntityListener>>>();
+
+    /**
+     * @brief Create the entities of one name of an entity's file, generated ones included, with their tags.
+     * @param name The name from the file.
+     * @param entityJSON The content of the file, only its "generate" field is used.
+     * @param tags The tags of the file.
+     */
+    void createEntities(const std::string& name, const nlohmann::json& entityJSON, const std::vector<std::string>& tags);
 };
 
 #endif //_ENTITYMANAGER_H
\ No newline at end of file
@@ -12,6 +12,23 @@
 #include <ComponentManager.h>
 #include <EntityManager.h>
 #include <Subscription.h>
+#include <Rollback.h>
+#include <Persistence.h>
+#include <Journal.h>
+#include <Recorder.h>
+#include <ContentCache.h>
+#include <HotReload.h>
+#include <GroupStreamer.h>
+#include <SpatialIndex.h>
+#include <ValueIndex.h>
+#include <Aggregate.h>
+#include <ChangeTracker.h>
+#include <ComponentObservers.h>
+#include <EventBus.h>
+#include <TimerWheel.h>
+#include <Hierarchy.h>
+
+class System;
 
 /**
  * Structure of the Snapshot, store the data of the desired components on a subset of entities.
@@ -33,6 +50,9 @@ typedef struct Snapshot {
 
 
 class Environment {
+    friend class ContentCache;
+    friend class HotReload;
+    friend class GroupStreamer;
 public: 
     /**
      * @brief Constructor of an Environment without files, the only need is an EntityManager.
@@ -48,12 +68,30 @@ public:
      * @param subscriptionsPath The subscriptions' root directory.
      */
     Environment(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Constructor which starts from the binary image of the directories, if it is up to date.
+     * @details If the image is missing or the sources changed since it was made, the JSON files are loaded and the image is written again.
+     * @param entitiesPath The entities' root directory.
+     * @param componentsPath The components' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     * @param cachePath Path of the image's file.
+     * @see ContentCache
+     */
+    Environment(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath, const std::string& cachePath);
     
     /**
      * @brief Let you add a ComponentManager from the environment interface.
      * @param manager A shared_ptr towards the ComponentManagers which will be added to the environment.
      */
     void addManager(std::shared_ptr<ComponentManager> manager);
+
+    /**
+     * @brief Remove a ComponentManager from the environment, its entities are unsubscribed first.
+     * @param name The name of the ComponentManager.
+     * @param share Tells the method if you want the update to be shared to the systems. (default : true)
+     */
+    void removeManager(const std::string& name, bool share = true);
     
     /**
      * @brief Return all the ComponentManagers.
@@ -127,6 +165,15 @@ public:
      * @param isPrefix Tells if the first parameter should be considered as a prefix or a tag.
      */
     void setStates(const std::string& prefixOrTag, const std::string& compName, bool state, bool share = true, bool isPrefix = true);
+
+    /**
+     * @brief Set the state of a specific component for a set of entities, in one batch.
+     * @param entities The entities' IDs, the ones without the component are ignored.
+     * @param compName The name of the component.
+     * @param state The new state to apply.
+     * @param share Tells the method if you want the update to be shared to the systems. (default : true)
+     */
+    void setStates(const std::vector<int>& entities, const std::string& compName, bool state, bool share = true);
     
     /**
      * @brief Return the state of an entity's component, with its ID.
@@ -170,6 +217,14 @@ public:
      * @param share Tells the method if you want the update to be shared to the systems. (default : true)
      */
     void removeEntity(const std::string& name, bool share = true);
+
+    /**
+     * @brief Remove a set of entities, each ComponentManager unsubscribes them in one batch.
+     * @warning The removed entities' IDs will be reused.
+     * @param entities The entities' IDs, the unknown ones are ignored.
+     * @param share Tells the method if you want the update to be shared to the systems. (default : true)
+     */
+    void removeEntities(const std::vector<int>& entities, bool share = true);
     
     /**
      * @brief Return all the components from an entity, with its ID.
@@ -254,6 +309,43 @@ public:
      * @param name The name of the entity to save.
      */
     void save(const std::string& name);
+
+    /**
+     * @brief Save the subscriptions of several entities at once, see Subscription::save.
+     * @param entities The IDs of the entities to save.
+     * @param file Path of one combined file for all of them, empty to save each entity in its own file. (default : "")
+     * @param compact If true the JSON is written without spaces nor new lines. (default : false)
+     */
+    void saveEntities(const std::vector<int>& entities, const std::string& file = "", bool compact = false);
+
+    /**
+     * @brief Save the subscriptions of every entity at once, see Subscription::save.
+     * @param file Path of one combined file for all of them, empty to save each entity in its own file. (default : "")
+     * @param compact If true the JSON is written without spaces nor new lines. (default : false)
+     */
+    void saveAll(const std::string& file = "", bool compact = false);
+
+    /**
+     * @brief Save the subscription of an entity on a background thread.
+     * @details Works like Environment::save, but only the copy of the entity's data is done on the caller's thread.
+     * @details Saving again an entity which is still waiting to be written only replaces its data.
+     * @param entity The ID of the entity to save.
+     * @return A future ready once the file is written, it holds the exception if the writing failed.
+     * @see PersistenceService
+     */
+    std::shared_future<void> saveAsync(int entity);
+
+    /**
+     * @brief Save the subscription of an entity on a background thread.
+     * @param name The name of the entity to save.
+     * @see Environment::saveAsync(int)
+     */
+    std::shared_future<void> saveAsync(const std::string& name);
+
+    /**
+     * @brief Wait until every save made with saveAsync is written.
+     */
+    void flushSaves();
     
     /**
      * @brief Let you join the Environment's update list.
@@ -278,6 +370,13 @@ public:
     */
     void notify(size_t ID);
 
+    /**
+     * @brief Return the bus of the application's events (e.g.: damages, collisions), typed and given to their subscribers by batches at each dispatch.
+     * @details Unlike the notifiers, which only carry an entity's ID.
+     * @see EventBus
+     */
+    EventBus& getEventBus();
+
     /**
      * @brief Let you create a new entity, which is a perfect copy of the original.
      * @details The new entity will have the name "copy" and its ID is returned.
@@ -321,6 +420,370 @@ public:
      */
     void clearSnapshot(const std::string& snapshotName);
 
+    /**
+     * @brief Start keeping the last frames of the environment, to be able to rewind them.
+     * @details Lighter than the snapshots, only the components changed during a frame are stored.
+     * @details If the rollback is already enabled, the stored frames are dropped and the new settings are applied.
+     * @param frames Number of frames which can be rewound (e.g.: 60).
+     * @param memoryBudget Approximative maximum size in bytes of the stored frames, the oldest frames are dropped above it. 0 means no limit.
+     * @see RollbackBuffer
+     */
+    void enableRollback(size_t frames, size_t memoryBudget = 0);
+
+    /**
+     * @brief Stop keeping the frames of the environment, the stored frames are dropped.
+     */
+    void disableRollback();
+
+    /**
+     * @brief Seal the current frame, its state can then be restored with rewindTo.
+     * @details Should be called once per tick, returns the frame's number (0 if the rollback is not enabled).
+     */
+    size_t captureFrame();
+
+    /**
+     * @brief Undo every change made on the components since the given frame.
+     * @details The frames after the given one are dropped, the simulation can then be run again from there.
+     * @warning The entities created or removed since this frame are not restored.
+     * @param frame The frame to go back to.
+     * @param share Tells the method if you want the update to be shared to the systems. (default : true)
+     * @return false if the frame is not available, nothing is done then.
+     */
+    bool rewindTo(size_t frame, bool share = true);
+
+    /**
+     * @brief Return the number of the latest captured frame, 0 if none or if the rollback is not enabled.
+     */
+    size_t getFrame();
+
+    /**
+     * @brief Start recording every change of the environment in a binary journal.
+     * @details If a previous journal (and its checkpoint) exists at this path, it is recovered first: the environment is restored to the last recorded state.
+     * @details A checkpoint of the environment is then written and the journal starts empty.
+     * @param path Path of the journal's file, the checkpoint is written in path + ".checkpoint".
+     * @param checkpointSize Size in bytes of the journal above which syncJournal writes a new checkpoint, 0 means never.
+     * @param share Tells the method if you want the recovered entities to be shared to the systems. (default : true)
+     * @return true if a previous state was recovered.
+     * @see Journal
+     */
+    bool enableJournal(const std::string& path, size_t checkpointSize = 0, bool share = true);
+
+    /**
+     * @brief Stop recording the changes in the journal, the journal is flushed.
+     */
+    void disableJournal();
+
+    /**
+     * @brief Write the buffered records of the journal, and a checkpoint if the journal became too big.
+     * @details Should be called regularly (e.g.: once per tick), the records are only durable once written.
+     */
+    void syncJournal();
+
+    /**
+     * @brief Write a checkpoint of the whole environment and empty the journal.
+     */
+    void checkpoint();
+
+    /**
+     * @brief Rewrite the journal without the records made useless by a later one.
+     */
+    void compactJournal();
+
+    /**
+     * @brief Start recording every operation made on this environment in a trace, to replay it later.
+     * @details If a recording is already running, it is stopped first.
+     * @param path Path of the trace's file, replaced if it exists.
+     * @see Recorder
+     * @see Replayer
+     */
+    void startRecording(const std::string& path);
+
+    /**
+     * @brief Stop the current recording, the trace is flushed.
+     */
+    void stopRecording();
+
+    /**
+     * @brief Run a system, and record its run under the given name if a recording is running.
+     * @details The changes made by the system are not recorded, the replay runs it again.
+     * @param system The system to run.
+     * @param name The name of the system in the trace.
+     */
+    void runSystem(std::shared_ptr<System> system, const std::string& name);
+
+    /**
+     * @brief Start watching the definitions' directories, their changes are applied by applyReload.
+     * @details The environment should have been loaded from these directories. If already enabled, the previous watch is stopped.
+     * @warning Only available on Linux (inotify), an error is thrown otherwise.
+     * @param entitiesPath The entities' root directory.
+     * @param componentsPath The components' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     * @see HotReload
+     */
+    void enableHotReload(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Stop watching the definitions' directories.
+     */
+    void disableHotReload();
+
+    /**
+     * @brief Apply the definitions' files changed since the last call, only what they changed is applied.
+     * @details Should be called regularly (e.g.: once per tick), never waits for a change.
+     * @param share Tells the method if you want the updates to be shared to the systems, each changed entity is shared once. (default : true)
+     * @return The number of files applied, 0 if the hot reload is not enabled.
+     */
+    size_t applyReload(bool share = true);
+
+    /**
+     * @brief Load the components' files, and only register the entities' and subscriptions' files: their entities are created by group with loadGroup.
+     * @details The environment should be made from an EntityManager, without files. If already enabled, the registered files are read again, the created entities stay.
+     * @param entitiesPath The entities' root directory.
+     * @param componentsPath The components' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     * @see GroupStreamer
+     */
+    void enableStreaming(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Forget the registered files, the created entities stay.
+     */
+    void disableStreaming();
+
+    /**
+     * @brief Create the entities of a group with their subscriptions, unless the group is already loaded.
+     * @details A group is made of the entities' files with a "group" key, or with a tag, or of the entities with a prefix in their name.
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found. (default : GroupBy::Key)
+     * @param share Tells the method if you want the created entities to be shared to the systems. (default : true)
+     * @return The number of created entities, 0 if the streaming is not enabled.
+     */
+    size_t loadGroup(const std::string& group, GroupBy by = GroupBy::Key, bool share = true);
+
+    /**
+     * @brief Remove the entities of a group, except the ones in another loaded group.
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found. (default : GroupBy::Key)
+     * @param save If true, the removed entities changed since their loading are written back in their subscriptions' files, on a background thread (see flushSaves). (default : true)
+     * @param share Tells the method if you want the removed entities to be shared to the systems. (default : true)
+     * @return The number of removed entities, 0 if the streaming is not enabled.
+     */
+    size_t unloadGroup(const std::string& group, GroupBy by = GroupBy::Key, bool save = true, bool share = true);
+
+    /**
+     * @brief Read the subscriptions' files of a group on a background thread, before it is loaded (e.g.: when the player gets close).
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found. (default : GroupBy::Key)
+     */
+    void prefetchGroup(const std::string& group, GroupBy by = GroupBy::Key);
+
+    /**
+     * @brief Return true if the group is loaded.
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found. (default : GroupBy::Key)
+     */
+    bool isGroupLoaded(const std::string& group, GroupBy by = GroupBy::Key);
+
+    /**
+     * @brief Index the entities of a component by one of its Vector2/Vector3 data, to find them by radius, box or distance.
+     * @details The index follows the changes of the manager. If the data is already indexed, its index is replaced.
+     * @warning An error is thrown if the component doesn't exist or if the data is not a Vector2 or a Vector3.
+     * @param component The component's name.
+     * @param field The data's name (e.g.: "position").
+     * @param layout How the positions are organized. (default : SpatialLayout::Grid)
+     * @param cellSize Size of the grid's cells, about the usual radius of the queries. (default : 1.0)
+     * @see SpatialIndex
+     */
+    std::shared_ptr<SpatialIndex> enableSpatialIndex(const std::string& component, const std::string& field, SpatialLayout layout = SpatialLayout::Grid, float cellSize = 1.0f);
+
+    /**
+     * @brief Remove the index of a component's data, if any.
+     */
+    void disableSpatialIndex(const std::string& component, const std::string& field);
+
+    /**
+     * @brief Return the index of a component's data, nullptr if not enabled.
+     */
+    std::shared_ptr<SpatialIndex> getSpatialIndex(const std::string& component, const std::string& field);
+
+    /**
+     * @brief Index the entities of a component by one of its int, float, string or bool data, to find them by value or by range of values.
+     * @details The index follows the changes of the manager. If the data is already indexed, its index is replaced.
+     * @warning An error is thrown if the component doesn't exist or if the data's type is not indexable.
+     * @param component The component's name.
+     * @param field The data's name (e.g.: "hp").
+     * @param kind How the values are organized, only an ordered index answers the range queries. (default : ValueIndexKind::Ordered)
+     * @see ValueIndex
+     */
+    std::shared_ptr<ValueIndex> enableValueIndex(const std::string& component, const std::string& field, ValueIndexKind kind = ValueIndexKind::Ordered);
+
+    /**
+     * @brief Remove the value index of a component's data, if any.
+     */
+    void disableValueIndex(const std::string& component, const std::string& field);
+
+    /**
+     * @brief Return the value index of a component's data, nullptr if not enabled.
+     */
+    std::shared_ptr<ValueIndex> getValueIndex(const std::string& component, const std::string& field);
+
+    /**
+     * @brief Return the statistics of an int, float or bool data of a component, computed in parallel.
+     * @warning An error is thrown if the component doesn't exist or if the data is not an int, a float or a bool.
+     * @param component The component's name.
+     * @param field The data's name.
+     * @param tag If not empty, only the entities with this tag are read.
+     * @param checkState If true, the entities whose component is disabled are not read.
+     * @see Aggregate
+     */
+    Statistics getStatistics(const std::string& component, const std::string& field, const std::string& tag = "", bool checkState = true);
+
+    /**
+     * @brief Return the statistics of a Vector2/Vector3 data of a component, per coordinate, computed in parallel.
+     * @warning An error is thrown if the component doesn't exist or if the data is not a Vector2 or a Vector3.
+     * @param component The component's name.
+     * @param field The data's name.
+     * @param tag If not empty, only the entities with this tag are read.
+     * @param checkState If true, the entities whose component is disabled are not read.
+     * @see Aggregate
+     */
+    VectorStatistics getVectorStatistics(const std::string& component, const std::string& field, const std::string& tag = "", bool checkState = true);
+
+    /**
+     * @brief Return the number of entities in each of the bins splitting [min, max] evenly, for an int, float or bool data of a component.
+     * @warning An error is thrown if the component doesn't exist, if the data is not an int, a float or a bool, or if the bins are not valid.
+     * @param component The component's name.
+     * @param field The data's name.
+     * @param bins Number of bins.
+     * @param min Lower bound of the first bin.
+     * @param max Upper bound of the last bin (included).
+     * @param tag If not empty, only the entities with this tag are read.
+     * @param checkState If true, the entities whose component is disabled are not read.
+     * @see Aggregate
+     */
+    std::vector<size_t> getHistogram(const std::string& component, const std::string& field, size_t bins, double min, double max, const std::string& tag = "", bool checkState = true);
+
+    /**
+     * @brief Follow the changes of the entities of a component, to find the ones changed since a tick.
+     * @details A component has one tracker, shared by its users: if it is already enabled, it is returned.
+     * @warning An error is thrown if the component doesn't exist.
+     * @param component The component's name.
+     * @see ChangeTracker, System::addChanged
+     */
+    std::shared_ptr<ChangeTracker> enableChangeTracking(const std::string& component);
+
+    /**
+     * @brief Stop following the changes of a component, if followed.
+     */
+    void disableChangeTracking(const std::string& component);
+
+    /**
+     * @brief Return the change tracker of a component, nullptr if not enabled.
+     */
+    std::shared_ptr<ChangeTracker> getChangeTracker(const std::string& component);
+
+    /**
+     * @brief Register an observer of an event of a component's entities, called with the batch of the entities concerned at each flushObservers.
+     * @warning An error is thrown if the component doesn't exist.
+     * @param component The component's name.
+     * @param event The observed event.
+     * @param observer The function called with the batch.
+     * @return The observer's ID, to unregister it.
+     * @see ComponentObservers
+     */
+    size_t observe(const std::string& component, ComponentEvent event, ComponentObserver observer);
+
+    /**
+     * @brief Unregister an observer of a component, the component is not followed anymore once it has no observer.
+     */
+    void unobserve(const std::string& component, size_t ID);
+
+    /**
+     * @brief Give the events gathered since the previous flush to the observers of every component.
+     * @details It's the sync point of the observers (e.g.: once per frame, after the systems).
+     */
+    void flushObservers();
+
+    /**
+     * @brief Return the observers of a component, nullptr if it has none.
+     */
+    std::shared_ptr<ComponentObservers> getObservers(const std::string& component);
+
+    /**
+     * @brief Schedule the removal of an entity, cancelled if the entity is removed before.
+     * @param entity The entity's ID.
+     * @param ticks The number of ticks of advanceTimers before the removal, 0 is the next tick.
+     * @return The timer's ID, to cancel it.
+     * @see TimerWheel
+     */
+    TimerID scheduleRemoval(int entity, uint64_t ticks);
+
+    /**
+     * @brief Schedule a change of state of an entity's component, cancelled if the entity is removed before.
+     * @param entity The entity's ID.
+     * @param compName The name of the component.
+     * @param state The new state to apply.
+     * @param ticks The number of ticks of advanceTimers before the change, 0 is the next tick.
+     */
+    TimerID scheduleState(int entity, const std::string& compName, bool state, uint64_t ticks);
+
+    /**
+     * @brief Schedule a call, cancelled if the entity given is removed before.
+     * @param ticks The number of ticks of advanceTimers before the call, 0 is the next tick.
+     * @param callback The function called.
+     * @param entity The entity of the timer, -1 for none.
+     */
+    TimerID schedule(uint64_t ticks, std::function<void()> callback, int entity = -1);
+
+    /**
+     * @brief Cancel a timer, return false if it expired or was cancelled.
+     */
+    bool cancelTimer(TimerID ID);
+
+    /**
+     * @brief Advance the timers and apply the expired ones by batch: the states by component, then the removals, then the calls.
+     * @param ticks The number of ticks to advance. (default : 1)
+     * @param share Tells the method if you want the updates to be shared to the systems, once per entity. (default : true)
+     * @return The number of expired timers.
+     */
+    size_t advanceTimers(uint64_t ticks = 1, bool share = true);
+
+    /**
+     * @brief Return the timers of the environment, created on its first use.
+     */
+    std::shared_ptr<TimerWheel> getTimers();
+
+    /**
+     * @brief Set the parent of an entity, with their IDs, its children move with it.
+     * @warning An error is thrown if the parent is the entity or one of its descendants.
+     * @param child The child's ID.
+     * @param parent The parent's ID, -1 to make the child a root.
+     * @see Hierarchy
+     */
+    void setParent(int child, int parent);
+
+    /**
+     * @brief Set the parent of an entity, with their names.
+     * @param child The child's name.
+     * @param parent The parent's name, an empty name to make the child a root.
+     */
+    void setParent(const std::string& child, const std::string& parent);
+
+    /**
+     * @brief Return the parent of an entity, -1 if it has none.
+     */
+    int getParent(int entity);
+
+    /**
+     * @brief Return the children of an entity.
+     */
+    std::vector<int> getChildren(int entity);
+
+    /**
+     * @brief Return the hierarchy of the entities, created on its first use.
+     */
+    std::shared_ptr<Hierarchy> getHierarchy();
+
 private: 
     /**
      * Link the ComponentManagers to their names.
@@ -342,10 +805,92 @@ private:
      */
     std::unordered_map<size_t, std::function<void(int)>> notifiers;
 
+    /**
+     * The bus of the application's events.
+     */
+    EventBus eventBus;
+
     /**
      * Link the snapshots to their names.
      */
     std::unordered_map<std::string, Snapshot> snapshots;
+
+    /**
+     * The frames kept for the rollback, nullptr if not enabled.
+     */
+    std::shared_ptr<RollbackBuffer> rollback;
+
+    /**
+     * The background writer of saveAsync, created on its first use.
+     */
+    std::shared_ptr<PersistenceService> persistence;
+
+    /**
+     * The journal of the changes, nullptr if not enabled.
+     */
+    std::shared_ptr<Journal> journal;
+
+    /**
+     * Size of the journal above which syncJournal writes a checkpoint, 0 means never.
+     */
+    size_t checkpointSize = 0;
+
+    /**
+     * The current recording, nullptr if none.
+     */
+    std::shared_ptr<Recorder> recorder;
+
+    /**
+     * The watch of the definitions' directories, nullptr if not enabled.
+     */
+    std::shared_ptr<HotReload> hotReload;
+
+    /**
+     * The registered files of the groups, nullptr if the streaming is not enabled.
+     */
+    std::shared_ptr<GroupStreamer> streamer;
+
+    /**
+     * The spatial indexes, by component's name.
+     */
+    std::unordered_map<std::string, std::vector<std::shared_ptr<SpatialIndex>>> spatialIndexes;
+
+    /**
+     * The value indexes, by component's name.
+     */
+    std::unordered_map<std::string, std::vector<std::shared_ptr<ValueIndex>>> valueIndexes;
+
+    /**
+     * The change trackers, by component's name.
+     */
+    std::unordered_map<std::string, std::shared_ptr<ChangeTracker>> changeTrackers;
+
+    /**
+     * The observers, by component's name.
+     */
+    std::unordered_map<std::string, std::shared_ptr<ComponentObservers>> observers;
+
+    /**
+     * The timers, nullptr until their first use.
+     */
+    std::shared_ptr<TimerWheel> timers;
+
+    /**
+     * The relations between the entities, nullptr until their first use.
+     */
+    std::shared_ptr<Hierarchy> hierarchy;
+
+    /**
+     * @brief Load the entities, components and subscriptions from their JSON files.
+     * @details Errors are thrown.
+     */
+    void loadFiles(const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Load the ComponentManagers from their JSON files.
+     * @details Errors are thrown.
+     */
+    void loadComponents(const std::string& componentsPath);
 };
 
 #endif //_ENVIRONMENT_H
\ No newline at end of file
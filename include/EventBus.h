@@ -0,0 +1,263 @@
+/**
+ * @file EventBus.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _EVENTBUS_H
+#define _EVENTBUS_H
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <span>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <type_traits>
+
+ /**
+ * @file EventBus.h
+ * @brief EventBus implementation
+ *
+ * @details This EventBus class carries the events of the application (e.g.: a damage, a collision, a spawn request), of any type, from the threads which publish them to the subscribers of their type.
+ * @details Each type of event has its own channel of two buffers: the events are published in one while the other is read by the subscribers, so a publisher never waits for a dispatch.
+ * @details The subscribers receive the events by batches, each one the whole batch of its type, when dispatch is called (e.g.: once per frame).
+ * @details The buffers keep their capacity, once they are large enough for a frame, publishing and dispatching do no allocation.
+ */
+
+class EventBus {
+public:
+    EventBus() = default;
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    /**
+     * @brief Publish an event, from any thread, given to the subscribers of its type at the next dispatch.
+     */
+    template<typename Event>
+    void publish(const Event& event);
+
+    /**
+     * @brief Publish a batch of events of the same type, from any thread.
+     */
+    template<typename Event>
+    void publish(std::span<const Event> events);
+
+    /**
+     * @brief Build an event in place in its channel, from any thread.
+     */
+    template<typename Event, typename... Args>
+    void emplace(Args&&... args);
+
+    /**
+     * @brief Register a subscriber of a type of event, called with the events published since the previous dispatch, in their order of publication.
+     * @details Taken into account from the next dispatch.
+     * @return The subscriber's ID, to unregister it.
+     */
+    template<typename Event>
+    size_t subscribe(std::function<void(std::span<const Event> events)> subscriber);
+
+    /**
+     * @brief Unregister a subscriber, nothing is done if the ID is unknown.
+     */
+    void unsubscribe(size_t ID);
+
+    /**
+     * @brief Reserve room for a number of events of a type in both buffers, for the first frames to not allocate either.
+     * @warning Should not be called by a subscriber.
+     */
+    template<typename Event>
+    void reserve(size_t capacity);
+
+    /**
+     * @brief Return the number of events of a type waiting for the next dispatch.
+     */
+    template<typename Event>
+    size_t pending();
+
+    /**
+     * @brief Give the events published since the previous dispatch to their subscribers, type by type.
+     * @details The events published meanwhile (by the subscribers too) are given at the next dispatch.
+     * @warning Should not be called by a subscriber.
+     */
+    void dispatch();
+
+    /**
+     * @brief Drop the events waiting for the next dispatch, of every type.
+     */
+    void clear();
+
+private:
+    /**
+     * The channel of a type of event, without its type.
+     */
+    class Channel {
+    public:
+        virtual ~Channel() = default;
+        virtual void dispatch() = 0;
+        virtual bool unsubscribe(size_t ID) = 0;
+        virtual void clear() = 0;
+    };
+
+    template<typename Event>
+    class TypedChannel : public Channel {
+    public:
+        typedef struct Subscriber {
+            size_t ID;
+            std::function<void(std::span<const Event>)> function;
+        } Subscriber;
+
+        /**
+         * The buffer of the publishers and the one read by the subscribers, swapped at each dispatch.
+         */
+        std::vector<Event> writing;
+        std::vector<Event> reading;
+
+        /**
+         * The subscribers, replaced by a copy on each registration so a dispatch can use them without lock.
+         */
+        std::shared_ptr<const std::vector<Subscriber>> subscribers = std::make_shared<const std::vector<Subscriber>>();
+
+        /**
+         * Lock of the writing buffer and of the subscribers.
+         */
+        std::mutex mtx;
+
+        void dispatch() override;
+        bool unsubscribe(size_t ID) override;
+        void clear() override;
+    };
+
+    /**
+     * The channels, by type ID of their events, nullptr for the types never used on this bus.
+     */
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::shared_mutex mtx;
+
+    /**
+     * The channels of the dispatch in progress, kept to not allocate at each dispatch.
+     */
+    std::vector<Channel*> dispatched;
+    std::mutex dispatchMtx;
+
+    std::atomic<size_t> nextID = 0;
+
+    /**
+     * @brief Return the type ID of a type of event, given on its first use.
+     */
+    template<typename Event>
+    static size_t typeID();
+
+    static size_t nextTypeID();
+
+    /**
+     * @brief Return the channel of a type of event, created on its first use.
+     */
+    template<typename Event>
+    TypedChannel<Event>& channel();
+};
+
+template<typename Event>
+inline size_t EventBus::typeID() {
+    static const size_t ID = nextTypeID();
+    return ID;
+}
+
+template<typename Event>
+inline EventBus::TypedChannel<Event>& EventBus::channel() {
+    static_assert(std::is_same_v<Event, std::remove_cvref_t<Event>>, "An event type should not be a reference or const.");
+    size_t ID = typeID<Event>();
+    {
+        std::shared_lock lock(mtx);
+        if (ID < channels.size() && channels[ID]) return static_cast<TypedChannel<Event>&>(*channels[ID]);
+    }
+    std::unique_lock lock(mtx);
+    if (ID >= channels.size()) channels.resize(ID + 1);
+    if (!channels[ID]) channels[ID] = std::make_unique<TypedChannel<Event>>();
+    return static_cast<TypedChannel<Event>&>(*channels[ID]);
+}
+
+template<typename Event>
+inline void EventBus::publish(const Event& event) {
+    TypedChannel<Event>& typed = channel<Event>();
+    std::scoped_lock lock(typed.mtx);
+    typed.writing.push_back(event);
+}
+
+template<typename Event>
+inline void EventBus::publish(std::span<const Event> events) {
+    TypedChannel<Event>& typed = channel<Event>();
+    std::scoped_lock lock(typed.mtx);
+    typed.writing.insert(typed.writing.end(), events.begin(), events.end());
+}
+
+template<typename Event, typename... Args>
+inline void EventBus::emplace(Args&&... args) {
+    TypedChannel<Event>& typed = channel<Event>();
+    std::scoped_lock lock(typed.mtx);
+    typed.writing.emplace_back(std::forward<Args>(args)...);
+}
+
+template<typename Event>
+inline size_t EventBus::subscribe(std::function<void(std::span<const Event> events)> subscriber) {
+    TypedChannel<Event>& typed = channel<Event>();
+    size_t ID = nextID++;
+    std::scoped_lock lock(typed.mtx);
+    auto copy = *typed.subscribers;
+    copy.push_back({ ID, std::move(subscriber) });
+    typed.subscribers = std::make_shared<const std::vector<typename TypedChannel<Event>::Subscriber>>(std::move(copy));
+    return ID;
+}
+
+template<typename Event>
+inline void EventBus::reserve(size_t capacity) {
+    TypedChannel<Event>& typed = channel<Event>();
+    // The reading buffer is only touched by a dispatch.
+    std::scoped_lock lock(dispatchMtx, typed.mtx);
+    typed.writing.reserve(capacity);
+    typed.reading.reserve(capacity);
+}
+
+template<typename Event>
+inline size_t EventBus::pending() {
+    TypedChannel<Event>& typed = channel<Event>();
+    std::scoped_lock lock(typed.mtx);
+    return typed.writing.size();
+}
+
+template<typename Event>
+inline void EventBus::TypedChannel<Event>::dispatch() {
+    std::shared_ptr<const std::vector<Subscriber>> current;
+    {
+        std::scoped_lock lock(mtx);
+        if (writing.empty()) return;
+        // Left by a subscriber which threw.
+        reading.clear();
+        writing.swap(reading);
+        current = subscribers;
+    }
+    // The publishers write in the other buffer meanwhile.
+    for (const Subscriber& subscriber : *current) {
+        subscriber.function(reading);
+    }
+    reading.clear();
+}
+
+template<typename Event>
+inline bool EventBus::TypedChannel<Event>::unsubscribe(size_t ID) {
+    std::scoped_lock lock(mtx);
+    auto copy = *subscribers;
+    if (std::erase_if(copy, [ID](const Subscriber& subscriber) { return subscriber.ID == ID; }) == 0) return false;
+    subscribers = std::make_shared<const std::vector<Subscriber>>(std::move(copy));
+    return true;
+}
+
+template<typename Event>
+inline void EventBus::TypedChannel<Event>::clear() {
+    std::scoped_lock lock(mtx);
+    writing.clear();
+}
+
+#endif //_EVENTBUS_H
@@ -0,0 +1,176 @@
+/**
+ * @file FrameLoop.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _FRAMELOOP_H
+#define _FRAMELOOP_H
+
+#include <System.h>
+#include <functional>
+#include <chrono>
+
+/**
+ * Phases of a frame, run in this order.
+ */
+enum class FramePhase {
+    /// Once per frame, before the updates (e.g.: inputs, network reception).
+    PreUpdate,
+    /// Once per fixed step, or once per frame without fixed step (e.g.: gameplay, physics).
+    Update,
+    /// Once per frame, after the updates (e.g.: rendering, network sending).
+    PostUpdate,
+    /// Once per frame, at the end (e.g.: saveAsync, journal).
+    Persistence
+};
+
+ /**
+ * @file FrameLoop.h
+ * @brief FrameLoop implementation
+ *
+ * @details This FrameLoop class drives the frames of an Environment: it runs its systems and tasks phase by phase, in their order of addition inside a phase.
+ * @details With a fixed step, the elapsed time is accumulated and the Update phase runs once per step, at most maxSteps times per frame: the time beyond is dropped, so a slow frame doesn't make the next ones slower.
+ * @details A system or task can run every N runs of its phase, the ones with the same rate are spread over the runs so they don't all fall on the same frame.
+ * @details A system can have a time budget per run, its System::overBudget becomes true once spent (see SlicedSystem, which resumes its entities at the next run).
+ * @details The event bus of the environment is dispatched and its observers flushed after the Update phase.
+ */
+
+class FrameLoop {
+public:
+    /**
+     * @brief Constructor of the FrameLoop, without fixed step.
+     * @param environment The environment whose events and observers are flushed each frame.
+     */
+    FrameLoop(std::shared_ptr<Environment> environment);
+
+    FrameLoop(const FrameLoop&) = delete;
+    FrameLoop& operator=(const FrameLoop&) = delete;
+
+    /**
+     * @brief Add a system to a phase.
+     * @param phase The phase of the system.
+     * @param system The system, kept by the loop.
+     * @param every The system runs once every this number of runs of its phase.
+     * @param budget Time budget of each run in milliseconds, 0 for no budget.
+     * @return The ID of the system in the loop, to remove it.
+     */
+    size_t add(FramePhase phase, std::shared_ptr<System> system, size_t every = 1, double budget = 0.0);
+
+    /**
+     * @brief Add a task to a phase (e.g.: environment->flushSaves in Persistence).
+     * @param phase The phase of the task.
+     * @param task The function called.
+     * @param every The task runs once every this number of runs of its phase.
+     * @return The ID of the task in the loop, to remove it.
+     */
+    size_t add(FramePhase phase, std::function<void()> task, size_t every = 1);
+
+    /**
+     * @brief Remove a system or a task, it can be called by a system or a task during a frame.
+     */
+    void remove(size_t ID);
+
+    /**
+     * @brief Set the fixed step of the Update phase.
+     * @param step Duration of a step in seconds, 0 to run the Update phase once per frame.
+     * @param maxSteps Maximum number of steps per frame, the catch-up limit.
+     */
+    void setFixedStep(double step, size_t maxSteps = 4);
+
+    /**
+     * @brief Run one frame, with the time elapsed since the previous one (0 for the first frame).
+     */
+    void frame();
+
+    /**
+     * @brief Run one frame, with the given elapsed time (e.g.: for a replay or a server in lockstep).
+     * @param elapsed Time elapsed since the previous frame, in seconds.
+     */
+    void frame(double elapsed);
+
+    /**
+     * @brief Run frames while the condition is true.
+     * @details With a fixed step, the frames are paced on the step: each one starts one step after the previous one, the lateness is not accumulated.
+     * @param running Called before each frame.
+     */
+    void run(const std::function<bool()>& running);
+
+    /**
+     * @brief Return the number of frames run.
+     */
+    uint64_t getFrame();
+
+    /**
+     * @brief Return the duration of the current update in seconds: the fixed step, or the frame's elapsed time without fixed step.
+     */
+    double getDeltaTime();
+
+    /**
+     * @brief Return the remaining accumulated time over the fixed step, in [0, 1), to interpolate between two steps in PostUpdate.
+     */
+    double getAlpha();
+
+    /**
+     * @brief Return the duration of the last run of a system or a task in milliseconds, 0 if unknown.
+     */
+    double getRunTime(size_t ID);
+
+    /**
+     * @brief Return the number of steps dropped by the catch-up limit since the start.
+     */
+    uint64_t getDroppedSteps();
+
+private:
+    typedef struct Entry {
+        size_t ID;
+        FramePhase phase;
+        std::shared_ptr<System> system;
+        std::function<void()> task;
+        size_t every;
+        size_t offset;
+        std::chrono::steady_clock::duration budget;
+        double runTime;
+        bool removed;
+    } Entry;
+
+    std::shared_ptr<Environment> environment;
+
+    /**
+     * The systems and tasks, in their order of addition.
+     */
+    std::vector<Entry> entries;
+    size_t nextID;
+
+    /**
+     * Number of runs of each phase.
+     */
+    uint64_t runs[4];
+
+    uint64_t frames;
+    uint64_t dropped;
+
+    double step;
+    size_t maxSteps;
+    double accumulator;
+    double deltaTime;
+
+    /**
+     * Start of the previous frame, for frame() without elapsed time.
+     */
+    std::chrono::steady_clock::time_point previous;
+    bool started;
+
+    /**
+     * True during a frame, the removed entries are erased at its end.
+     */
+    bool inFrame;
+
+    /**
+     * @brief Run the entries of a phase due at this run of the phase.
+     */
+    void runPhase(FramePhase phase);
+};
+
+#endif //_FRAMELOOP_H
@@ -0,0 +1,220 @@
+/**
+ * @file GroupStreamer.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _GROUPSTREAMER_H
+#define _GROUPSTREAMER_H
+
+#include <Subscription.h>
+#include <future>
+#include <map>
+#include <set>
+#include <mutex>
+
+class Environment;
+
+/**
+ * How the entities of a group are found in the entities' files.
+ */
+enum class GroupBy {
+    /// The entities' files with this "group" key.
+    Key,
+    /// The entities' files with this tag.
+    Tag,
+    /// The entities whose name starts with this prefix (the generated ones included).
+    Prefix
+};
+
+ /**
+ * @file GroupStreamer.h
+ * @brief GroupStreamer implementation
+ *
+ * @details This GroupStreamer class registers the entities' and subscriptions' files without creating anything, then creates or removes groups of entities on demand.
+ * @details Only the names, tags and "group" keys of the entities' files are kept, and the targets of the subscriptions' files. The components of the subscriptions are read when a group is loaded.
+ * @details A loaded group gets the subscriptions' files which target its entities, in their directory's order, the ones targeting a single entity last so a state written back is found again.
+ * @details An entity can be in several groups, it is removed with the last loaded one.
+ * @details The entities changed since their loading are followed (as a ComponentListener), they can be written back in their subscriptions' files when removed.
+ * @warning A component removed from an entity is not written back, the subscriptions' files give it back on the next loading.
+ */
+
+class GroupStreamer : public ComponentListener {
+public:
+    /**
+     * @brief Constructor of the GroupStreamer, register the entities' and subscriptions' files.
+     * @details The files are read in parallel over the threads of the global ThreadPool, the biggest ones are streamed.
+     * @param entitiesPath The entities' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     */
+    GroupStreamer(const std::string& entitiesPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Wait for the prefetches still running.
+     */
+    ~GroupStreamer();
+
+    GroupStreamer(const GroupStreamer&) = delete;
+    GroupStreamer& operator=(const GroupStreamer&) = delete;
+
+    /**
+     * @brief Create the entities of a group, with their tags and subscriptions.
+     * @details Nothing is done if the group is already loaded.
+     * @param environment The environment to fill.
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found.
+     * @param created Filled with the created entities.
+     */
+    void load(Environment& environment, const std::string& group, GroupBy by, std::vector<int>& created);
+
+    /**
+     * @brief Remove the entities of a group which are in no other loaded group.
+     * @param environment The environment to empty.
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found.
+     * @param save If true, the removed entities changed since their loading are written back in their subscriptions' files, on a background thread.
+     * @param removed Filled with the removed entities.
+     */
+    void unload(Environment& environment, const std::string& group, GroupBy by, bool save, std::vector<int>& removed);
+
+    /**
+     * @brief Read and parse the subscriptions' files of a group on a background thread, its loading doesn't wait for the disk anymore.
+     * @details The parsed files are kept until a group using them is loaded. The biggest files are not prefetched, they are streamed by the loading.
+     * @param environment The environment, its pending saves are written first.
+     * @param group The group's key, tag or prefix.
+     * @param by How the group's entities are found.
+     */
+    void prefetch(Environment& environment, const std::string& group, GroupBy by);
+
+    /**
+     * @brief Return true if the group is loaded.
+     */
+    bool isLoaded(const std::string& group, GroupBy by);
+
+    /**
+     * @brief Return the number of entities currently created by the loaded groups (not the ones created outside of the groups).
+     */
+    size_t getResident();
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void onStateChange(ComponentManager& manager, int entity, bool oldState) override;
+    void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+private:
+    /**
+     * A registered entity, with the index of its file.
+     */
+    typedef struct Definition {
+        std::string name;
+        uint32_t file;
+    } Definition;
+
+    /**
+     * What is kept of an entity's file: its tags, its "group" key, and its entities (indexes in definitions).
+     */
+    typedef struct EntityFile {
+        std::vector<std::string> tags;
+        std::string key;
+        std::vector<uint32_t> members;
+    } EntityFile;
+
+    /**
+     * What is kept of a subscription's file: its path, and its content without the components.
+     */
+    typedef struct SubscriptionFile {
+        std::string path;
+        nlohmann::json header;
+    } SubscriptionFile;
+
+    /**
+     * The registered entities, sorted by name to find the prefixes.
+     */
+    std::vector<Definition> definitions;
+
+    /**
+     * Number of loaded groups holding each definition, the entity exists while it isn't 0.
+     */
+    std::vector<int> holds;
+
+    /**
+     * True for the definitions whose entity was created by the streamer, only these ones are removed with their last group (not an entity created outside of the groups).
+     */
+    std::vector<bool> owned;
+
+    std::vector<EntityFile> entityFiles;
+    std::vector<SubscriptionFile> subscriptionFiles;
+
+    /**
+     * Entities' files by "group" key and by tag.
+     */
+    std::unordered_map<std::string, std::vector<uint32_t>> filesByKey;
+    std::unordered_map<std::string, std::vector<uint32_t>> filesByTag;
+
+    /**
+     * Subscriptions' files by path, by targeted entity, by targeted tag, and the ones targeting a prefix (generated).
+     */
+    std::unordered_map<std::string, size_t> paths;
+    std::unordered_map<std::string, std::vector<size_t>> subscriptionsByEntity;
+    std::unordered_map<std::string, std::vector<size_t>> subscriptionsByTag;
+    std::vector<size_t> generatedFiles;
+
+    /**
+     * The loaded groups, with their definitions.
+     */
+    std::map<std::pair<GroupBy, std::string>, std::vector<uint32_t>> groups;
+
+    /**
+     * A prefetch running on a background thread, with the subscriptions' files it reads (sorted).
+     */
+    typedef struct Prefetch {
+        std::vector<size_t> files;
+        std::future<std::vector<std::pair<size_t, nlohmann::json>>> result;
+    } Prefetch;
+
+    /**
+     * The prefetches not collected yet, and the subscriptions' files already parsed.
+     */
+    std::vector<Prefetch> prefetches;
+    std::unordered_map<size_t, nlohmann::json> prefetched;
+
+    /**
+     * Entities changed since their loading, and whether the changes are the streamer's own (not followed).
+     */
+    std::unordered_set<int> dirty;
+    bool applying = false;
+    std::mutex mtx;
+
+    /**
+     * @brief Return the definitions of a group.
+     */
+    std::vector<uint32_t> find(const std::string& group, GroupBy by);
+
+    /**
+     * @brief Return the subscriptions' files targeting the given definitions, in the order they are applied.
+     */
+    std::vector<size_t> target(const std::vector<uint32_t>& members);
+
+    /**
+     * @brief Register a subscription's file, or return its index if it already is.
+     */
+    size_t addSubscription(const std::string& path, nlohmann::json header);
+
+    /**
+     * @brief Keep the files of the finished prefetches, waiting only for the running ones which read one of the given files.
+     */
+    void collect(const std::vector<size_t>& files);
+
+    /**
+     * @brief Follow or not the changes of the entities.
+     */
+    void setApplying(bool value);
+
+    /**
+     * @brief Mark an entity as changed.
+     */
+    void touch(int entity);
+};
+
+#endif //_GROUPSTREAMER_H
@@ -0,0 +1,255 @@
+/**
+ * @file Hierarchy.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _HIERARCHY_H
+#define _HIERARCHY_H
+
+#include <ComponentManager.h>
+#include <EntityManager.h>
+#include <ThreadPool.h>
+#include <span>
+#include <mutex>
+
+ /**
+ * @file Hierarchy.h
+ * @brief Hierarchy implementation
+ *
+ * @details This Hierarchy class keeps the parent/child relations of the entities (e.g.: a weapon held by a character), and a depth-first order of them where each subtree is contiguous and each parent is before its children.
+ * @details The relations are linked in place (parent, first and last children, siblings), the order is kept in sync with them: a reparenting moves the block of the subtree in the order, only the entities between its old and new places are updated. Past about the size of the hierarchy moved between two propagations (e.g.: a level loaded), the order is built again in one pass once needed.
+ * @details A value can then be propagated from the parents to their children (e.g.: a world position from the local offsets) in one linear pass over arrays in the order, the big subtrees being split over the global ThreadPool.
+ * @details The entities are added as roots by their first relation. The children of a removed entity are given to its parent (they become roots if it was a root), getSubtree gives the entities to remove with it.
+ * @details It follows the EntityManager as an EntityListener, a removed entity leaves the hierarchy (the IDs of the entities are reused).
+ */
+
+class Hierarchy : public EntityListener {
+public:
+    Hierarchy();
+
+    Hierarchy(const Hierarchy&) = delete;
+    Hierarchy& operator=(const Hierarchy&) = delete;
+
+    /**
+     * @brief Set the parent of an entity, its subtree moves with it. The entities not in the hierarchy are added.
+     * @warning An error is thrown if the parent is the entity or one of its descendants.
+     * @param child The child's ID.
+     * @param parent The parent's ID, -1 to make the child a root.
+     */
+    void setParent(int child, int parent);
+
+    /**
+     * @brief Add an entity as a root, nothing is done if it is already in the hierarchy.
+     */
+    void add(int entity);
+
+    /**
+     * @brief Remove an entity from the hierarchy, its children are given to its parent.
+     */
+    void remove(int entity);
+
+    /**
+     * @brief Return the parent of an entity, -1 for a root or an entity not in the hierarchy.
+     */
+    int getParent(int entity);
+
+    /**
+     * @brief Return the children of an entity, in their order.
+     */
+    std::vector<int> getChildren(int entity);
+
+    /**
+     * @brief Return an entity and its descendants, in the order (e.g.: to remove them with Environment::removeEntities).
+     */
+    std::vector<int> getSubtree(int entity);
+
+    /**
+     * @brief Return the depth of an entity, 0 for a root, -1 for an entity not in the hierarchy.
+     */
+    int getDepth(int entity);
+
+    /**
+     * @brief Return the position of an entity in the order, -1 if it is not in the hierarchy.
+     * @details The positions change with the relations, the arrays given to propagate are indexed by them.
+     */
+    int getPosition(int entity);
+
+    /**
+     * @brief Return the entities of the hierarchy, in the order.
+     */
+    std::vector<int> getOrder();
+
+    /**
+     * @brief Return true if the entity is in the hierarchy.
+     */
+    bool contains(int entity);
+
+    /**
+     * @brief Return the number of entities in the hierarchy.
+     */
+    size_t size();
+
+    /**
+     * @brief Propagate a value from the parents to the children: world[i] = combine(world[parent], local[i]), world[i] = local[i] for a root.
+     * @details The arrays are indexed by the positions of the order (see getOrder), the hierarchy is locked during the pass.
+     * @details The combine function is called from the threads of the global ThreadPool, it should only read its parameters.
+     * @warning An error is thrown if the sizes of the arrays are not the size of the hierarchy.
+     * @param local The values relative to the parents (e.g.: the local offsets).
+     * @param world The propagated values, written.
+     * @param combine The function combining a parent's propagated value and a child's local value.
+     */
+    template<typename Value, typename Combine>
+    void propagate(std::span<const Value> local, std::span<Value> world, Combine combine);
+
+    /**
+     * @brief Propagate the Vector3 offsets of a component's data to another of its data: world = parent's world + local.
+     * @details The components are read and written in parallel over the global ThreadPool, only the positions which changed are written. An entity without the component passes its parent's position to its children.
+     * @details Each component is read and written through its lock: for big hierarchies propagated each frame, the span overload is much faster.
+     * @warning An error is thrown if one of the data is not a Vector3.
+     * @param manager The manager of the component.
+     * @param localField The name of the offset from the parent.
+     * @param worldField The name of the propagated position, written.
+     */
+    void propagate(ComponentManager& manager, const std::string& localField, const std::string& worldField);
+
+    void onRemove(EntityManager& manager, int entity, const std::string& name) override;
+
+private:
+    /**
+     * By position in the order: the entity, the position of its parent (-1 for a root), the size of its subtree (itself included) and its depth.
+     */
+    std::vector<int> order;
+    std::vector<int> parents;
+    std::vector<int> sizes;
+    std::vector<int> depths;
+
+    /**
+     * The links of an entity: its parent (-1 for a root, absent if not in the hierarchy), its first and last children, its previous and next siblings (the roots are siblings), and its position in the order.
+     */
+    typedef struct Node {
+        int parent;
+        int first;
+        int last;
+        int previous;
+        int next;
+        int position;
+    } Node;
+
+    static constexpr int absent = -2;
+
+    /**
+     * The nodes, by entity.
+     */
+    std::vector<Node> nodes;
+
+    /**
+     * The first and last roots, -1 if none.
+     */
+    int firstRoot;
+    int lastRoot;
+    size_t count;
+
+    /**
+     * True if the arrays by position are not in sync with the relations anymore.
+     */
+    bool dirty;
+
+    /**
+     * The number of entities moved in place in the order since it was built or propagated.
+     */
+    size_t moved;
+
+    /**
+     * The split of the order for propagate, computed again after a change: the nodes of the big subtrees, done first on the calling thread, then the ranges done over the pool.
+     */
+    std::vector<int> serial;
+    std::vector<std::pair<int, int>> ranges;
+    bool planned;
+
+    std::mutex mtx;
+
+    /**
+     * @brief Return true if the entity is in the hierarchy, the hierarchy should be locked.
+     */
+    bool known(int entity);
+
+    /**
+     * @brief Add an entity as a root, the hierarchy should be locked.
+     */
+    void insert(int entity);
+
+    /**
+     * @brief Move a subtree from the position c to the position destination (counted without it) in the order, the hierarchy should be locked.
+     */
+    void move(int child, int parent, size_t c, size_t destination);
+
+    /**
+     * @brief Unlink an entity from its siblings, the hierarchy should be locked.
+     */
+    void unlink(int entity);
+
+    /**
+     * @brief Link an entity as the last child of a parent (the last root for -1), the hierarchy should be locked.
+     */
+    void link(int entity, int parent);
+
+    /**
+     * @brief Return true if a change moving this number of entities in the order should be done in place, the hierarchy should be locked.
+     */
+    bool inPlace(size_t moved);
+
+    /**
+     * @brief Build the order again from the relations if it is not in sync, the hierarchy should be locked.
+     */
+    void sync();
+
+    /**
+     * @brief Update the parents' positions of the entities after end whose parent moved in [begin, end), the hierarchy should be locked.
+     */
+    void follow(int begin, int end);
+
+    /**
+     * @brief Split the order for propagate, the hierarchy should be locked.
+     */
+    void plan();
+
+    /**
+     * @brief Propagate over the split order, the hierarchy should be locked.
+     */
+    template<typename Value, typename Combine>
+    void propagateLocked(std::span<const Value> local, std::span<Value> world, Combine& combine);
+};
+
+template<typename Value, typename Combine>
+inline void Hierarchy::propagate(std::span<const Value> local, std::span<Value> world, Combine combine) {
+    std::scoped_lock lock(mtx);
+    propagateLocked(local, world, combine);
+}
+
+template<typename Value, typename Combine>
+inline void Hierarchy::propagateLocked(std::span<const Value> local, std::span<Value> world, Combine& combine) {
+    sync();
+    moved = 0;
+    if (local.size() != order.size() || world.size() != order.size()) throw std::runtime_error("Error : the propagated arrays should have one value per entity of the hierarchy.");
+    plan();
+
+    // Each parent is before its children, and the parents of a range are in it or done before it.
+    auto propagateOne = [&](size_t i) {
+        int parent = parents[i];
+        world[i] = parent < 0 ? local[i] : combine(world[parent], local[i]);
+    };
+    for (int i : serial) {
+        propagateOne(i);
+    }
+    ThreadPool::global().parallelFor(ranges.size(), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            for (size_t i = ranges[r].first; i < static_cast<size_t>(ranges[r].second); ++i) {
+                propagateOne(i);
+            }
+        }
+    });
+}
+
+#endif //_HIERARCHY_H
@@ -0,0 +1,156 @@
+/**
+ * @file HotReload.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _HOTRELOAD_H
+#define _HOTRELOAD_H
+
+#include <Subscription.h>
+#include <set>
+
+class Environment;
+
+ /**
+ * @file HotReload.h
+ * @brief HotReload implementation
+ *
+ * @details This HotReload class watches the entities, components and subscriptions directories (inotify, Linux only) and applies their changes to a live environment.
+ * @details It remembers what each file brought (entities, component, subscribed entities), a changed file is read again and only the difference is applied.
+ * @details An edited subscription's file is applied again on its entities, the ones it doesn't target anymore are unsubscribed unless another file still subscribes them.
+ * @details A new entity, or a new tag, gets the subscriptions' files which target it. An edited component keeps the data of its entities, the new data get their default value then the values of the subscriptions' files.
+ * @warning A tag removed from an entity's file stays on its entities until the environment is loaded again.
+ */
+
+class HotReload {
+public:
+    /**
+     * @brief Constructor of the HotReload, read the current files and start watching the directories.
+     * @details The environment should have been loaded from these directories.
+     * @warning An error is thrown if the directories can't be watched, or outside of Linux.
+     * @param environment The environment loaded from the directories.
+     * @param entitiesPath The entities' root directory.
+     * @param componentsPath The components' root directory.
+     * @param subscriptionsPath The subscriptions' root directory.
+     */
+    HotReload(Environment& environment, const std::string& entitiesPath, const std::string& componentsPath, const std::string& subscriptionsPath);
+
+    /**
+     * @brief Stop watching the directories.
+     */
+    ~HotReload();
+
+    HotReload(const HotReload&) = delete;
+    HotReload& operator=(const HotReload&) = delete;
+
+    /**
+     * @brief Apply the files changed since the last call, never waits for a change.
+     * @details A file changed several times is applied once. The components' files are applied first, then the entities' files, then the subscriptions' files.
+     * @details A file which can't be parsed (e.g.: saved while being edited) is skipped, its previous content stays applied.
+     * @param environment The watched environment.
+     * @param touched Filled with the entities whose components or tags changed.
+     * @return The number of files applied.
+     */
+    size_t poll(Environment& environment, std::unordered_set<int>& touched);
+
+private:
+    /**
+     * Kind of a definition's file, from its root directory.
+     */
+    enum class Kind { Component, Entity, Subscription };
+
+    /**
+     * What an entity's file brought: its entities (the generated ones expanded) and their tags.
+     */
+    typedef struct EntityFile {
+        std::vector<std::string> names;
+        std::vector<std::string> tags;
+    } EntityFile;
+
+    /**
+     * What a subscription's file brought: how it finds its entities, and the entities subscribed to each of its components.
+     */
+    typedef struct SubscriptionFile {
+        std::string entity;
+        bool generated = false;
+        std::vector<std::string> tags;
+        bool state = true;
+        std::unordered_map<std::string, std::unordered_set<std::string>> targets;
+    } SubscriptionFile;
+
+    /**
+     * The inotify's descriptor, -1 if not watching.
+     */
+    int fd;
+
+    /**
+     * The watched directories, and the kind of their files, by watch descriptor.
+     */
+    std::unordered_map<int, std::pair<Kind, std::string>> watches;
+
+    /**
+     * Files of each kind.
+     */
+    std::unordered_map<std::string, EntityFile> entityFiles;
+    std::unordered_map<std::string, std::string> componentFiles;
+    std::unordered_map<std::string, SubscriptionFile> subscriptionFiles;
+
+    /**
+     * Number of entities' files defining each entity, an entity is removed with its last file.
+     */
+    std::unordered_map<std::string, int> definitions;
+
+    /**
+     * Number of subscriptions' files subscribing each entity to each component, the entity is unsubscribed with its last file.
+     */
+    std::unordered_map<std::string, std::unordered_map<std::string, int>> covers;
+
+    /**
+     * Subscriptions' files by targeted entity, targeted tag, mentioned component, and the ones targeting a prefix (generated).
+     */
+    std::unordered_map<std::string, std::set<std::string>> byEntity;
+    std::unordered_map<std::string, std::set<std::string>> byTag;
+    std::unordered_map<std::string, std::set<std::string>> byComponent;
+    std::set<std::string> generatedFiles;
+
+    /**
+     * @brief Watch a directory and its sub-directories.
+     */
+    void watch(Kind kind, const std::string& directory);
+
+    /**
+     * @brief Apply an entity's file, or its removal if it doesn't exist anymore.
+     */
+    void reloadEntities(Environment& environment, const std::string& file, std::unordered_set<int>& touched);
+
+    /**
+     * @brief Apply a component's file, or its removal if it doesn't exist anymore.
+     */
+    void reloadComponent(Environment& environment, const std::string& file, std::unordered_set<int>& touched);
+
+    /**
+     * @brief Apply a subscription's file, or its removal if it doesn't exist anymore.
+     * @param component If not empty, only this component of the file is applied.
+     * @param changed If true the values are applied on every entity of the file, otherwise only on the entities it didn't target yet.
+     */
+    void reloadSubscription(Environment& environment, const std::string& file, const std::string& component, bool changed, std::unordered_set<int>& touched);
+
+    /**
+     * @brief Apply the subscriptions' files targeting the given entities, on them.
+     */
+    void subscribeNew(Environment& environment, const std::vector<std::string>& names, std::unordered_set<int>& touched);
+
+    /**
+     * @brief Add or remove a subscription's file from the indexes.
+     */
+    void index(const std::string& file, const SubscriptionFile& record, bool add);
+
+    /**
+     * @brief Return the entities of an entity's file, the generated ones expanded, and its tags.
+     */
+    static EntityFile readEntities(const nlohmann::json& entityJSON);
+};
+
+#endif //_HOTRELOAD_H
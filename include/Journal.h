@@ -0,0 +1,122 @@
+/**
+ * @file Journal.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#include <Operation.h>
+
+ /**
+ * @file Journal.h
+ * @brief Journal implementation
+ *
+ * @details This Journal class appends every change of an environment to a binary file, as it happens.
+ * @details Entities' creations, removals and tags, subscriptions, states and data writes are recorded as operations.
+ * @details A checkpoint writes the whole state in a second file and empties the journal, the recovery loads the last checkpoint and replays the journal on top of it.
+ * @see OperationListener
+ * @details Every record has a checksum, a record cut by a crash is detected and the replay stops there.
+ */
+
+class Journal : public OperationListener {
+public:
+    /**
+     * @brief Constructor of the Journal.
+     * @details The journal is written in path, the checkpoint in path + ".checkpoint".
+     * @details Nothing is recorded before the first checkpoint, so a previous journal can be recovered first.
+     * @param path Path of the journal's file.
+     * @param entityManager The EntityManager used to get the names of the entities.
+     */
+    Journal(const std::string& path, std::shared_ptr<EntityManager> entityManager);
+
+    /**
+     * @brief Flush the journal before its destruction.
+     */
+    ~Journal();
+
+    /**
+     * @brief Write the buffered records to the file.
+     */
+    void flush();
+
+    /**
+     * @brief Return the size in bytes of the journal since the last checkpoint.
+     */
+    size_t getSize();
+
+    /**
+     * @brief Write the whole state of the environment in the checkpoint's file, then empty the journal.
+     * @details The checkpoint is written in a temporary file first, a crash can't leave a broken checkpoint.
+     * @param environment The environment to save.
+     */
+    void checkpoint(Environment& environment);
+
+    /**
+     * @brief Rewrite the journal without the records made useless by a later one.
+     * @details A data write (or a state change) followed by another one on the same data is dropped.
+     */
+    void compact();
+
+    /**
+     * @brief Load the last checkpoint, if any, and replay the journal on top of it.
+     * @details Must be called before the journal listens to the environment, or the replay would be recorded again.
+     * @param environment The environment to restore, it should already have its ComponentManagers.
+     * @return true if something was recovered.
+     */
+    bool recover(Environment& environment);
+
+protected:
+    /**
+     * @brief Append the record to the file, with its size and checksum.
+     */
+    void write(const std::string& record) override;
+
+private:
+    /**
+     * Path of the journal's file.
+     */
+    std::string path;
+
+    /**
+     * The journal's file.
+     */
+    std::ofstream file;
+
+    /**
+     * Generation of the current checkpoint, the journal is only replayed on the checkpoint of its generation.
+     */
+    uint64_t generation;
+
+    /**
+     * Size of the journal since the last checkpoint.
+     */
+    size_t size;
+
+    /**
+     * Mutex to protect the file, the components can be written from threads.
+     */
+    std::mutex mtx;
+
+    /**
+     * @brief Write the header of a new journal's file.
+     */
+    void writeHeader(std::ostream& stream);
+
+    /**
+     * @brief Read the records of the journal's file, stops at the first broken one.
+     * @param generation Filled with the generation of the journal.
+     * @return The content of every valid record.
+     */
+    std::vector<std::string> readRecords(uint64_t& generation);
+
+    /**
+     * @brief Load the checkpoint's file in the environment.
+     * @return false if there is no valid checkpoint.
+     */
+    bool loadCheckpoint(Environment& environment);
+};
+
+#endif //_JOURNAL_H
@@ -0,0 +1,82 @@
+/**
+ * @file Operation.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _OPERATION_H
+#define _OPERATION_H
+
+#include <ComponentManager.h>
+#include <EntityManager.h>
+
+class Environment;
+
+ /**
+ * @file Operation.h
+ * @brief OperationListener implementation
+ *
+ * @details An operation is the binary record of one change of an environment, the entities and components are identified by their names.
+ * @details The OperationListener class turns the changes of the managers into operations, the Journal and the Recorder only decide where they are written.
+ * @details applyOperation plays an operation back on an environment.
+ */
+
+/**
+ * Type of an operation, first byte of its record.
+ */
+enum class Operation : uint8_t { CreateEntity = 1, RemoveEntity, AddTag, Subscribe, Unsubscribe, SetState, Set, RunSystem };
+
+/**
+ * Number of operation's types, plus one (the types start at 1).
+ */
+constexpr size_t operationCount = static_cast<size_t>(Operation::RunSystem) + 1;
+
+/**
+ * @brief Return the name of an operation's type (e.g.: "Set").
+ * @param operation The operation's type.
+ */
+const char* operationName(Operation operation);
+
+/**
+ * @brief Apply the given operation's record on an environment.
+ * @details The operations on unknown entities or components are ignored, a RunSystem operation does nothing here.
+ * @warning An error is thrown if the record is broken.
+ * @param environment The environment to modify.
+ * @param record The record of the operation.
+ * @return The type of the applied operation.
+ */
+Operation applyOperation(Environment& environment, const std::string& record);
+
+class OperationListener : public ComponentListener, public EntityListener {
+public:
+    /**
+     * @brief Constructor of the OperationListener.
+     * @param entityManager The EntityManager used to get the names of the entities.
+     */
+    OperationListener(std::shared_ptr<EntityManager> entityManager);
+
+    void onCreate(EntityManager& manager, int entity, const std::string& name) override;
+    void onRemove(EntityManager& manager, int entity, const std::string& name) override;
+    void onTag(EntityManager& manager, int entity, const std::string& tag) override;
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void onStateChange(ComponentManager& manager, int entity, bool oldState) override;
+    void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+protected:
+    /**
+     * @brief Called with the record of every operation, in the order they happened.
+     * @details Can be called from the threads writing the components.
+     * @param record The record of the operation.
+     */
+    virtual void write(const std::string& record) = 0;
+
+    /**
+     * The EntityManager used to get the names of the entities.
+     */
+    std::shared_ptr<EntityManager> entityManager;
+};
+
+#endif //_OPERATION_H
@@ -0,0 +1,109 @@
+/**
+ * @file Persistence.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _PERSISTENCE_H
+#define _PERSISTENCE_H
+
+#include <Subscription.h>
+#include <future>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+
+ /**
+ * @file Persistence.h
+ * @brief PersistenceService implementation
+ *
+ * @details This PersistenceService class writes the entities' images on a background thread, the simulation's thread only pays for the copy of the data.
+ * @details The queue is bounded: when it is full, submit waits for a slot.
+ * @details Saving an entity which is still waiting in the queue only replaces its image, the file is written once.
+ */
+
+class PersistenceService {
+public:
+    /**
+     * @brief Constructor of the PersistenceService, start the background thread.
+     * @param maxPending Maximum number of images waiting to be written.
+     */
+    PersistenceService(size_t maxPending = 256);
+
+    /**
+     * @brief Write every pending image, then stop the background thread.
+     */
+    ~PersistenceService();
+
+    /**
+     * @brief Queue an image to be written, and return a future ready once it is written.
+     * @details If an image with the same path is already waiting, it is replaced and the same future is returned.
+     * @details If the writing fails, the future holds the exception.
+     * @param image The image to write.
+     * @see EntityImage
+     */
+    std::shared_future<void> submit(EntityImage image);
+
+    /**
+     * @brief Wait until every queued image is written.
+     */
+    void flush();
+
+    /**
+     * @brief Return the number of images waiting to be written.
+     */
+    size_t getPending();
+
+private:
+    /**
+     * An image waiting to be written, with the promise of its writers.
+     */
+    typedef struct Job {
+        EntityImage image;
+        std::promise<void> promise;
+        std::shared_future<void> future;
+    } Job;
+
+    /**
+     * The images waiting to be written, by path.
+     */
+    std::unordered_map<std::string, Job> pending;
+
+    /**
+     * Order of arrival of the pending paths.
+     */
+    std::deque<std::string> order;
+
+    /**
+     * Maximum number of pending images.
+     */
+    size_t maxPending;
+
+    /**
+     * True while the background thread writes an image.
+     */
+    bool busy;
+
+    /**
+     * True once the service is stopping.
+     */
+    bool stop;
+
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::condition_variable idle;
+
+    /**
+     * The background thread.
+     */
+    std::thread worker;
+
+    /**
+     * @brief Loop of the background thread.
+     */
+    void run();
+};
+
+#endif //_PERSISTENCE_H
@@ -0,0 +1,104 @@
+/**
+ * @file Recorder.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <Operation.h>
+#include <atomic>
+
+ /**
+ * @file Recorder.h
+ * @brief Recorder implementation
+ *
+ * @details This Recorder class writes every operation made on an environment in a binary trace, to replay it later with the Replayer.
+ * @details The systems run through Environment::runSystem are recorded by their name, the changes they make are not: the replay runs them again instead.
+ * @see OperationListener
+ */
+
+class Recorder : public OperationListener {
+public:
+    /**
+     * @brief Constructor of the Recorder, create the trace's file.
+     * @param path Path of the trace's file, replaced if it exists.
+     * @param entityManager The EntityManager used to get the names of the entities.
+     */
+    Recorder(const std::string& path, std::shared_ptr<EntityManager> entityManager);
+
+    /**
+     * @brief Flush the trace before its destruction.
+     */
+    ~Recorder();
+
+    /**
+     * @brief Record the run of a system.
+     * @param system The name under which the system will be found by the Replayer.
+     */
+    void recordRun(const std::string& system);
+
+    /**
+     * @brief Stop recording the changes until resume is called, calls can be nested.
+     * @details Used while a system runs, its changes come from the run itself.
+     */
+    void suspend();
+
+    /**
+     * @brief Record the changes again, after a call to suspend.
+     */
+    void resume();
+
+    /**
+     * @brief Write the buffered operations to the file.
+     */
+    void flush();
+
+    /**
+     * @brief Return the number of recorded operations.
+     */
+    size_t getCount();
+
+protected:
+    /**
+     * @brief Append the record to the trace, with its size.
+     */
+    void write(const std::string& record) override;
+
+private:
+    /**
+     * The trace's file.
+     */
+    std::ofstream file;
+
+    /**
+     * Number of recorded operations.
+     */
+    size_t count;
+
+    /**
+     * Number of nested suspend calls.
+     */
+    std::atomic<int> suspended;
+
+    /**
+     * Mutex to protect the file, the components can be written from threads.
+     */
+    std::mutex mtx;
+
+    /**
+     * @brief Append a record, even while suspended.
+     */
+    void append(const std::string& record);
+};
+
+/**
+ * @brief Read every operation's record of a trace written by a Recorder.
+ * @warning An error is thrown if the file is not a valid trace, or if a record is cut or doesn't match its checksum.
+ * @param path Path of the trace's file.
+ */
+std::vector<std::string> readTrace(const std::string& path);
+
+#endif //_RECORDER_H
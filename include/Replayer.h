@@ -0,0 +1,95 @@
+/**
+ * @file Replayer.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _REPLAYER_H
+#define _REPLAYER_H
+
+#include <System.h>
+#include <Recorder.h>
+#include <array>
+
+/**
+ * Structure of the measures of one type of operation during a replay, the times are in microseconds.
+ */
+typedef struct OperationStats {
+    /// Number of operations of this type.
+    size_t count = 0;
+    /// Total time spent in these operations.
+    double total = 0.0;
+    /// Median latency.
+    double p50 = 0.0;
+    /// 90th percentile of the latency.
+    double p90 = 0.0;
+    /// 99th percentile of the latency.
+    double p99 = 0.0;
+    /// Maximum latency.
+    double max = 0.0;
+} OperationStats;
+
+/**
+ * Structure of the result of a replay.
+ */
+typedef struct ReplayReport {
+    /// Measures by type of operation, indexed by Operation.
+    std::array<OperationStats, operationCount> operations;
+    /// Number of replayed operations.
+    size_t count = 0;
+    /// Duration of the whole replay, in seconds.
+    double duration = 0.0;
+
+    /**
+     * @brief Append to the given stream the throughput and latencies of each type of operation.
+     * @param stream The stream on which the report is append.
+     */
+    void toString(std::ostream& stream) const;
+} ReplayReport;
+
+ /**
+ * @file Replayer.h
+ * @brief Replayer implementation
+ *
+ * @details This Replayer class drives an environment through the operations of a trace, as fast as possible, and measures them.
+ * @details The environment should start in the same state as the recorded one (e.g.: loaded from the same files).
+ * @details The systems are found by the names given to Environment::runSystem, a system not added to the Replayer is skipped.
+ * @see Recorder
+ */
+
+class Replayer {
+public:
+    /**
+     * @brief Constructor of the Replayer.
+     * @param environment The environment on which the trace is replayed.
+     */
+    Replayer(std::shared_ptr<Environment> environment);
+
+    /**
+     * @brief Add a system to run when the trace asks for it.
+     * @param name The name given to Environment::runSystem during the recording.
+     * @param system The system to run.
+     */
+    void addSystem(const std::string& name, std::shared_ptr<System> system);
+
+    /**
+     * @brief Replay every operation of the trace and return the measures.
+     * @details The trace is fully read before the replay, the reading is not measured.
+     * @param path Path of the trace's file.
+     */
+    ReplayReport run(const std::string& path);
+
+private:
+    /**
+     * The environment on which the traces are replayed.
+     */
+    std::shared_ptr<Environment> environment;
+
+    /**
+     * The systems, by name.
+     */
+    std::unordered_map<std::string, std::shared_ptr<System>> systems;
+};
+
+#endif //_REPLAYER_H
@@ -0,0 +1,192 @@
+/**
+ * @file Rollback.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _ROLLBACK_H
+#define _ROLLBACK_H
+
+#include <ComponentManager.h>
+#include <unordered_set>
+#include <atomic>
+
+ /**
+ * @file Rollback.h
+ * @brief RollbackBuffer implementation
+ *
+ * @details This RollbackBuffer class keeps the last frames of an environment, to rewind them when needed (e.g.: late inputs in a lockstep simulation).
+ * @details Only the components changed during a frame are stored, as undo records: the first write of a component in a frame saves its previous data.
+ * @details Rewinding costs the number of changes to undo, not the size of the environment.
+ * @warning Only the components are rewound (data, states and subscriptions), the entities created or removed are not.
+ */
+
+class RollbackBuffer : public ComponentListener {
+public:
+    /**
+     * @brief Constructor of the RollbackBuffer.
+     * @param capacity Number of frames which can be rewound.
+     * @param memoryBudget Approximative maximum size in bytes of the stored frames, the oldest frames are dropped above it. 0 means no limit.
+     */
+    RollbackBuffer(size_t capacity, size_t memoryBudget = 0);
+
+    /**
+     * @brief Seal the current frame and return its number.
+     * @details The state of the components at this moment can then be restored with rewindTo.
+     * @details Nothing is recorded before the first captured frame.
+     */
+    size_t captureFrame();
+
+    /**
+     * @brief Undo every change made since the given frame.
+     * @details The frames after the given one are dropped, the given frame becomes the latest one.
+     * @warning No other thread should modify the components during a rewind.
+     * @param frame The frame to go back to.
+     * @param touched Filled with the entities whose subscriptions or states changed during the rewind.
+     * @return false if the frame is not in the buffer anymore (or not yet), nothing is done then.
+     */
+    bool rewindTo(size_t frame, std::unordered_set<int>& touched);
+
+    /**
+     * @brief Return the number of the latest captured frame, 0 if none.
+     */
+    size_t getFrame();
+
+    /**
+     * @brief Return the number of the oldest frame which can still be rewound to.
+     */
+    size_t getOldestFrame();
+
+    /**
+     * @brief Return the approximative memory used by the stored frames, in bytes.
+     */
+    size_t getMemoryUsage();
+
+    /**
+     * @brief Change the capacity and the memory budget of the buffer.
+     * @details The stored frames are dropped.
+     * @param capacity Number of frames which can be rewound.
+     * @param memoryBudget Approximative maximum size in bytes of the stored frames, 0 means no limit.
+     */
+    void resize(size_t capacity, size_t memoryBudget = 0);
+
+    /**
+     * @brief Drop every stored frame, the recording starts again at the next captured frame.
+     */
+    void clear();
+
+    /**
+     * @brief Drop every stored record of a component manager, the manager can then be destroyed.
+     * @details The other managers can still be rewound, the dropped changes are just not undone.
+     * @param manager The component manager to forget.
+     */
+    void forget(const ComponentManager* manager);
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void onStateChange(ComponentManager& manager, int entity, bool oldState) override;
+    void beforeSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+private:
+    /**
+     * Kind of change stored in a record, the record holds what is needed to undo it.
+     */
+    enum class RecordType { Data, State, Subscribe, Unsubscribe };
+
+    /**
+     * An undo record.
+     * @warning The manager is a raw pointer, a manager must be forgotten (see forget) before being destroyed.
+     */
+    typedef struct Record {
+        RecordType type;
+        ComponentManager* manager;
+        int entity;
+        std::shared_ptr<Component> component;
+        bool state;
+        dataVector data;
+    } Record;
+
+    /**
+     * The undo records of one frame, in the order they happened.
+     */
+    typedef struct FrameDiff {
+        std::vector<Record> records;
+        /// Components already saved during this frame, only their first write is needed.
+        std::unordered_set<const Component*> written;
+        size_t bytes = 0;
+    } FrameDiff;
+
+    /**
+     * Ring buffer of the sealed frames, frames[head] is the diff between the oldest frame and the next one.
+     */
+    std::vector<FrameDiff> frames;
+
+    /**
+     * The changes since the latest captured frame.
+     */
+    FrameDiff current;
+
+    /**
+     * Index of the oldest diff in frames.
+     */
+    size_t head;
+
+    /**
+     * Number of diffs stored in frames.
+     */
+    size_t count;
+
+    /**
+     * Number of the latest captured frame, 0 if none.
+     */
+    size_t latest;
+
+    /**
+     * Maximum memory for the stored frames, 0 means no limit.
+     */
+    size_t memoryBudget;
+
+    /**
+     * Memory currently used by the stored frames.
+     */
+    size_t memoryUsage;
+
+    /**
+     * True while a rewind is applied, the changes it makes are not recorded.
+     */
+    std::atomic<bool> rewinding;
+
+    /**
+     * Mutex protecting the frames, the components can be written from threads.
+     */
+    std::mutex mtx;
+
+    /**
+     * @brief Add a record to the current frame.
+     */
+    void record(Record&& record);
+
+    /**
+     * @brief Drop the oldest stored frame.
+     */
+    void dropOldest();
+
+    /**
+     * @brief Apply the undo records of a frame, newest first.
+     */
+    static void undo(FrameDiff& diff, std::unordered_set<int>& touched);
+
+    /**
+     * @brief Return the approximative memory used by a record, in bytes.
+     */
+    static size_t sizeOf(const Record& record);
+
+    /**
+     * @brief Remove the records of a component manager from a frame, its size is updated.
+     * @return The number of bytes removed.
+     */
+    static size_t forget(FrameDiff& diff, const ComponentManager* manager);
+};
+
+#endif //_ROLLBACK_H
@@ -0,0 +1,218 @@
+/**
+ * @file SpatialIndex.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _SPATIALINDEX_H
+#define _SPATIALINDEX_H
+
+#include <ComponentManager.h>
+#include <shared_mutex>
+#include <unordered_set>
+#include <atomic>
+
+/**
+ * How the positions of a SpatialIndex are organized.
+ */
+enum class SpatialLayout {
+    /// Uniform hash grid, the moves are cheap, best when the entities are spread over a bounded area.
+    Grid,
+    /// k-d tree, best for sparse worlds or very uneven densities. The moved entities are searched apart until the tree is built again.
+    Tree
+};
+
+ /**
+ * @file SpatialIndex.h
+ * @brief SpatialIndex implementation
+ *
+ * @details This SpatialIndex class indexes the entities of a ComponentManager by the position in one of its Vector2/Vector3 data, to find them by radius, by box or by distance without reading every component.
+ * @details It follows the manager as a ComponentListener: the subscriptions, the states and the writes of the indexed data update it incrementally.
+ * @details The 2D positions are indexed with z = 0.
+ * @details When most entities move at once (e.g.: a movement system), the index can be suspended then rebuilt, the positions are read back in parallel over the global ThreadPool.
+ * @warning The data should be written through Component::set to be followed, a reshape of the manager is not (call rebuild).
+ */
+
+class SpatialIndex : public ComponentListener {
+public:
+    /**
+     * @brief Constructor of the SpatialIndex, index the entities already subscribed to the manager.
+     * @details The index should then be added to the manager's listeners (see Environment::enableSpatialIndex, which does both).
+     * @warning An error is thrown if the data is not a Vector2 or a Vector3.
+     * @param manager The indexed manager.
+     * @param field Name of the indexed data.
+     * @param layout How the positions are organized.
+     * @param cellSize Size of the grid's cells, about the usual radius of the queries (unused by the tree).
+     */
+    SpatialIndex(std::shared_ptr<ComponentManager> manager, const std::string& field, SpatialLayout layout = SpatialLayout::Grid, float cellSize = 1.0f);
+
+    SpatialIndex(const SpatialIndex&) = delete;
+    SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+    /**
+     * @brief Return the entities within the radius of the center (bounds included), in no specific order.
+     * @param checkState If true, the entities whose component is disabled are not returned.
+     */
+    std::vector<int> queryRadius(const Vector3& center, float radius, bool checkState = true);
+    std::vector<int> queryRadius(const Vector2& center, float radius, bool checkState = true);
+
+    /**
+     * @brief Return the entities inside the box (bounds included), in no specific order.
+     * @param checkState If true, the entities whose component is disabled are not returned.
+     */
+    std::vector<int> queryBox(const Vector3& min, const Vector3& max, bool checkState = true);
+    std::vector<int> queryBox(const Vector2& min, const Vector2& max, bool checkState = true);
+
+    /**
+     * @brief Return the k entities nearest to the point, from the nearest.
+     * @param checkState If true, the entities whose component is disabled are not returned.
+     */
+    std::vector<int> queryNearest(const Vector3& point, size_t k, bool checkState = true);
+    std::vector<int> queryNearest(const Vector2& point, size_t k, bool checkState = true);
+
+    /**
+     * @brief Stop following the writes of the indexed data until the next rebuild, the subscriptions and the states are still followed.
+     * @details Used before moving most entities at once, a rebuild is then cheaper than updating each of them.
+     */
+    void suspend();
+
+    /**
+     * @brief Read the positions and the states of every entity again, rebuild the index and follow the writes again.
+     * @details The positions are read and the tree is built in parallel over the global ThreadPool. Only the entities which changed of cell are moved in the grid.
+     * @warning An error is thrown if the manager doesn't exist anymore, or if the data is not a Vector2 or a Vector3 anymore (e.g.: after a reshape).
+     */
+    void rebuild();
+
+    /**
+     * @brief Return the number of indexed entities, the disabled ones included.
+     */
+    size_t size();
+
+    /**
+     * @brief Return the name of the indexed data.
+     */
+    const std::string& getField();
+
+    /**
+     * @brief Return the indexed manager, nullptr if it doesn't exist anymore.
+     */
+    std::shared_ptr<ComponentManager> getManager();
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void onStateChange(ComponentManager& manager, int entity, bool oldState) override;
+    void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+private:
+    /**
+     * An indexed entity: its position and state, its grid's cell and its index in it, or its index in the tree if the tree has its current position.
+     */
+    typedef struct Entry {
+        Vector3 position;
+        bool active;
+        bool inTree;
+        uint32_t slot;
+        uint64_t cell;
+    } Entry;
+
+    /**
+     * A copy of an entry in a cell or in the tree, to scan them without looking for the entries. The entity is -1 if the tree's position is outdated.
+     */
+    typedef struct Item {
+        Vector3 position;
+        int entity;
+        bool active;
+    } Item;
+
+    /**
+     * The indexed manager, weak as the manager keeps its listeners.
+     */
+    std::weak_ptr<ComponentManager> manager;
+    std::string field;
+    SpatialLayout layout;
+    float cellSize;
+    bool is3D;
+
+    std::unordered_map<int, Entry> entries;
+
+    /**
+     * The grid's cells, with their entities.
+     */
+    std::unordered_map<uint64_t, std::vector<Item>> cells;
+
+    /**
+     * The tree (the median of a range splits it on the axis of its depth), the entities added or moved since it was built, and the number of its positions still current.
+     */
+    std::vector<Item> tree;
+    std::unordered_set<int> pending;
+    size_t current = 0;
+
+    std::atomic<bool> suspended = false;
+    std::atomic<bool> outdated = false;
+    std::shared_mutex mtx;
+
+    /**
+     * @brief Read the indexed data of a component, z = 0 for a Vector2.
+     */
+    Vector3 read(Component& component);
+
+    /**
+     * @brief Return the key of the grid's cell containing the position.
+     */
+    uint64_t cellOf(const Vector3& position);
+
+    /**
+     * @brief Add, move, enable/disable or remove an entity, the index should be locked.
+     */
+    void insert(int entity, const Vector3& position, bool active);
+    void move(int entity, Entry& entry, const Vector3& position);
+    void setActive(Entry& entry, bool active);
+    void remove(int entity);
+
+    /**
+     * @brief Put an entity in its grid's cell, or take it out.
+     */
+    void link(int entity, Entry& entry);
+    void unlink(Entry& entry);
+
+    /**
+     * @brief Take an entity out of the tree, it is searched apart until the tree is built again.
+     */
+    void detach(int entity, Entry& entry);
+
+    /**
+     * @brief Build the tree from the entries, the index should be locked.
+     */
+    void buildTree();
+
+    /**
+     * @brief Build the tree again if it was marked as outdated, called by the queries before locking the index.
+     */
+    void refresh();
+
+    /**
+     * @brief Mark the tree as outdated if too many of its positions are, the index should be locked.
+     */
+    void checkOutdated();
+
+    /**
+     * @brief Call visit(entity, position, active) on every entity which may be in the box, the index should be locked.
+     * @return True if every entity was visited.
+     */
+    template<typename Visit>
+    bool visitBox(const Vector3& min, const Vector3& max, Visit visit);
+
+    /**
+     * @brief Call visit on the tree's positions of the range [begin, end) which may be in the box.
+     */
+    template<typename Visit>
+    void visitTree(size_t begin, size_t end, size_t depth, const Vector3& min, const Vector3& max, Visit& visit);
+
+    /**
+     * @brief Keep the k entities of the tree's range [begin, end) nearest to the point in a max-heap of (squared distance, entity).
+     */
+    void nearestInTree(size_t begin, size_t end, size_t depth, const Vector3& point, size_t k, bool checkState, std::vector<std::pair<float, int>>& heap);
+};
+
+#endif //_SPATIALINDEX_H
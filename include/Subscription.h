@@ -21,6 +21,19 @@
 
 using unorMapCM = std::unordered_map<std::string, std::shared_ptr<ComponentManager>>;
 
+/**
+ * Structure of an entity's image, a copy of its components' data taken at one moment.
+ * It can be written later, on another thread, without touching the environment.
+ */
+typedef struct EntityImage {
+    /// Name of the entity.
+    std::string name;
+    /// Path of the subscription's file to write.
+    std::string path;
+    /// Names and data of the entity's components.
+    std::vector<std::pair<std::string, dataUnMap>> components;
+} EntityImage;
+
 class Subscription {
 public: 
     /**
@@ -31,6 +44,41 @@ public:
      * @param compManagers The environment ComponentManagers.
      */
     Subscription(const std::string& directory, std::shared_ptr<EntityManager> entityManager, std::shared_ptr<unorMapCM> compManagers);
+
+    /**
+     * @brief Constructor of the Subscription class for subscriptions already applied, nothing is read.
+     * @details Used when the environment is loaded from a ContentCache.
+     * @param directory The root directory of the subscription's files.
+     * @param entityManager The environment EntityManager.
+     * @param compManagers The environment ComponentManagers.
+     * @param files The paths of the subscriptions' files of the entities, see Subscription::getFiles.
+     */
+    Subscription(const std::string& directory, std::shared_ptr<EntityManager> entityManager, std::shared_ptr<unorMapCM> compManagers, std::unordered_map<std::string, std::string> files);
+
+    /**
+     * @brief Apply the subscription described by the JSON of a subscription's file.
+     * @details A combined file (an array of subscriptions, see Subscription::save) is applied entry by entry, its entities are then saved in their own files.
+     * @param file Path of the subscription's file, used to save its entity back in it.
+     * @param subsJSON The parsed content of the subscription's file.
+     */
+    void load(const std::string& file, const nlohmann::json& subsJSON);
+
+    /**
+     * @brief Apply the subscription of a subscription's file, as its components are parsed.
+     * @details The file is read twice: once for everything but the components, to know the targeted entities, then for the components, each one dropped once applied.
+     * @details The memory used doesn't depend on the number of components, the result is the same as Subscription::load.
+     * @param file Path of the subscription's file.
+     */
+    void stream(const std::string& file);
+
+    /**
+     * @brief Apply the components of a subscription's file on the given entities, as they are parsed.
+     * @details Only the components are read, the targets of the file are not used.
+     * @param file Path of the subscription's file.
+     * @param IDs The targeted entities.
+     * @param defaultState The state to give to the components.
+     */
+    void stream(const std::string& file, const std::vector<int>& IDs, bool defaultState);
     
     /**
      * @brief Let you save the subscription of an entity in a file, it will preserve the current values of the components, therefore it can be used as a saving system.
@@ -39,6 +87,82 @@ public:
      */
     void save(int entity);
 
+    /**
+     * @brief Save the subscriptions of several entities, their managers are visited once for the whole batch.
+     * @details The JSON is written as it goes, without building a JSON object for each entity.
+     * @details Without a file, each entity is saved in its own subscription's file (see Subscription::save(int)), the files are written in parallel over the threads of the global ThreadPool.
+     * @details With a file, every entity is saved in it as an array of subscriptions, which is loaded back like the other subscriptions' files.
+     * @param entities The IDs of the entities to save.
+     * @param file Path of the combined file, empty to save each entity in its own file. (default : "")
+     * @param compact If true the JSON is written without spaces nor new lines. (default : false)
+     */
+    void save(const std::vector<int>& entities, const std::string& file = "", bool compact = false);
+
+    /**
+     * @brief Return an image of the entity's components, ready to be written with Subscription::write.
+     * @details Only copies the data, fast enough to be done on the simulation's thread.
+     * @param entity The ID of the entity to capture.
+     */
+    EntityImage capture(int entity);
+
+    /**
+     * @brief Return the images of several entities, in the same order, each manager is visited once.
+     * @param entities The IDs of the entities to capture.
+     */
+    std::vector<EntityImage> capture(const std::vector<int>& entities);
+
+    /**
+     * @brief Write the given image in its subscription's file.
+     * @details Do not use the environment, can be called from any thread.
+     * @param image The image of the entity to write.
+     * @param compact If true the JSON is written without spaces nor new lines. (default : false)
+     */
+    static void write(const EntityImage& image, bool compact = false);
+
+    /**
+     * @brief Write the given images in one combined file, as an array of subscriptions.
+     * @details Do not use the environment, can be called from any thread.
+     * @param images The images of the entities to write.
+     * @param file Path of the combined file, replaced if it exists.
+     * @param compact If true the JSON is written without spaces nor new lines. (default : false)
+     */
+    static void write(const std::vector<EntityImage>& images, const std::string& file, bool compact = false);
+
+    /**
+     * @brief Return the paths of the subscriptions' files, for each entity with its own file.
+     */
+    const std::unordered_map<std::string, std::string>& getFiles();
+
+    /**
+     * @brief Find the entities targeted by a subscription's file, and its default state.
+     * @param file Path of the subscription's file.
+     * @param subsJSON The content of the file, its components are not used.
+     * @param IDs Filled with the targeted entities, sorted and without duplicates.
+     * @param defaultState Set to the state given by the file, if any.
+     * @return false if the subscription should be skipped.
+     */
+    bool resolve(const std::string& file, const nlohmann::json& subsJSON, std::vector<int>& IDs, bool& defaultState);
+
+    /**
+     * @brief Subscribe the targeted entities to one component of a subscription's file, with its data.
+     * @param component The component's entry of the file, with its name and data.
+     * @param IDs The targeted entities.
+     * @param defaultState The state to give to the components.
+     */
+    void apply(const nlohmann::json& component, const std::vector<int>& IDs, bool defaultState);
+
+    /**
+     * @brief Let the subscriptions use a ComponentManager added after the construction.
+     * @param manager The new ComponentManager.
+     */
+    void addManager(std::shared_ptr<ComponentManager> manager);
+
+    /**
+     * @brief Stop using a ComponentManager.
+     * @param name The name of the ComponentManager.
+     */
+    void removeManager(const std::string& name);
+
 private: 
     /**
      * Name of the root directory of the subscription's files.
@@ -59,6 +183,12 @@ private:
      * Shared_ptr toward the ComponentManagers of the environment.
      */
     std::shared_ptr<unorMapCM> managers;
+
+    /**
+     * @brief Write the subscription of an entity in the stream.
+     * @param indent The indentation of the entity's lines, unused if compact.
+     */
+    static void writeEntity(std::ostream& stream, const EntityImage& image, bool compact, int indent);
 };
 
 #endif //_SUBSCRIPTION_H
\ No newline at end of file
@@ -10,7 +10,10 @@
 #define _SYSTEM_H
 
 #include <Environment.h>
+#include <UpdateLOD.h>
 #include <unordered_set>
+#include <span>
+#include <chrono>
 
 class System {
 public:  
@@ -106,6 +109,45 @@ protected:
     */
     void addTags(std::vector<std::string> names);
 
+    /**
+     * Return the given entities which are entities of this System, in the same order (e.g.: the result of a ValueIndex's query).
+     * @param candidates
+     */
+    std::vector<int> select(std::span<const int> candidates);
+
+    /**
+     * Let you follow the changes of a component, the entities of this System whose component changed are then returned by getChanged.
+     * The change tracking of the component is enabled in the Environment if it exists.
+     * @param name
+     */
+    void addChanged(const std::string& name);
+
+    /**
+     * Return the entities of this System whose followed components changed since the previous call (all of them at the first call), each once.
+     * Called once per run, the System only processes the modified entities (e.g.: a synchronization over the network).
+     */
+    std::vector<int> getChanged();
+
+    /**
+     * Return true once the time budget of the current run is spent (see FrameLoop), false if the run has no budget.
+     * A heavy System can stop there and resume with the next entities at its next run (see SlicedSystem).
+     */
+    bool overBudget();
+
+    /**
+     * Let you update the entities of this System by level of detail (see UpdateLOD), the far or unimportant ones are then returned by getLOD only every few runs.
+     * @param priority Return the priority of an entity, the lower the more important (e.g.: UpdateLOD::distance).
+     * @param thresholds The increasing priorities separating the levels.
+     * @param periods The number of runs between two updates of an entity, per level (one more than the thresholds).
+     */
+    void setLOD(std::function<float(int)> priority, std::vector<float> thresholds, std::vector<size_t> periods);
+
+    /**
+     * Return the entities of this System to update at this run according to their level of detail, each new entity at its first run.
+     * Called once per run, all the entities if setLOD wasn't called.
+     */
+    std::vector<int> getLOD();
+
 private:
     /**
      * Boolean variable which tell if a change of the entities occured, accessible via the getChange() method, which will automatically flipped it back if true. 
@@ -122,8 +164,67 @@ private:
      * Value incremented to get the next ID.
      */
     static size_t nextID;
+
+    /**
+     * A followed component, with its change tracker and the tick of the previous call of getChanged.
+     */
+    typedef struct Followed {
+        std::string component;
+        std::weak_ptr<ChangeTracker> tracker;
+        uint64_t tick;
+    } Followed;
+
+    /**
+     * The components whose changes are followed.
+     */
+    std::vector<Followed> followedChanges;
+
+    /**
+     * The levels of detail of the entities, nullptr if not set.
+     */
+    std::shared_ptr<UpdateLOD> lod;
+
+    /**
+     * End of the time budget of the current run, set by the FrameLoop.
+     */
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+    friend class FrameLoop;
 };
 
 inline size_t System::nextID = 0; // Initialize the nextID at 0.
 
+/**
+ * A System which processes its entities one by one, and spreads them over several runs when its time budget is spent.
+ * Each run resumes after the last entity processed, a new pass over the entities starts once all of them were processed.
+ */
+class SlicedSystem : public System {
+public:
+    SlicedSystem(std::shared_ptr<Environment> environment, bool autoUpdate = true);
+
+    /**
+     * Process the entities of the current pass until the time budget is spent.
+     */
+    void run() override;
+
+    /**
+     * Return true if the last run finished its pass over the entities.
+     */
+    bool isPassDone();
+
+protected:
+    /**
+     * The logic of the System for one of its entities.
+     * @param entity
+     */
+    virtual void process(int entity) = 0;
+
+private:
+    /**
+     * The entities of the current pass, and the index of the next one to process.
+     */
+    std::vector<int> pass;
+    size_t cursor;
+};
+
 #endif //_SYSTEM_H
\ No newline at end of file
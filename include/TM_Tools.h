@@ -18,6 +18,12 @@
 #include <string>
 #include <filesystem>
 #include <sstream>
+#include <cstdint>
+#include <type_traits>
+#include <charconv>
+#include <cmath>
+#include <ThreadPool.h>
+#include <TypeRegistry.h>
 
 /*
  * Types definitions and tools to use them inside TailorMade
@@ -45,13 +51,17 @@ typedef struct Vector2 { float x; float y;
     }
 
     /// Scalar product
-    Vector2 operator*=(const float s) const {
-        return { x * s, y * s };
+    Vector2& operator*=(const float s) {
+        x *= s;
+        y *= s;
+        return *this;
     }
 
     /// Scalar division
-    Vector2 operator/=(const float s) const {
-        return { x / s, y / s };
+    Vector2& operator/=(const float s) {
+        x /= s;
+        y /= s;
+        return *this;
     }
 
     /// Norm
@@ -59,9 +69,10 @@ typedef struct Vector2 { float x; float y;
         return sqrt(x * x + y * y);
     }
 
-    /// Normalization
+    /// Normalization, the null vector stays null
     Vector2 operator~() const {
         float norm = !(*this);
+        if (norm == 0.0f) return { 0.0f, 0.0f };
         return { x / norm, y / norm };
     }
 
@@ -72,12 +83,12 @@ typedef struct Vector2 { float x; float y;
         return acos(((*this) * v2) / (norm1 * norm2));
     }
 
-    /// Projection
+    /// Projection on v2, null if v2 is null
     Vector2 operator>>(const Vector2 v2) const {
-        float norm2 = !v2;
-        norm2 *= norm2; // Squared the norm
-        float dotProd = (*this) * v2;
-        return (*this) *= (dotProd / norm2);
+        float norm2 = v2 * v2; // Squared norm
+        if (norm2 == 0.0f) return {};
+        Vector2 projection = v2;
+        return projection *= ((*this) * v2) / norm2;
     }
 } Vector2;
 
@@ -100,13 +111,19 @@ typedef struct Vector3 { float x; float y; float z;
     }
 
     /// Scalar product
-    Vector3 operator*=(const float s) const {
-        return { x * s, y * s, z * s };
+    Vector3& operator*=(const float s) {
+        x *= s;
+        y *= s;
+        z *= s;
+        return *this;
     }
     
     /// Scalar division
-    Vector3 operator/=(const float s) const {
-        return { x / s, y / s, z / s };
+    Vector3& operator/=(const float s) {
+        x /= s;
+        y /= s;
+        z /= s;
+        return *this;
     }
 
     /// Cross product
@@ -119,9 +136,10 @@ typedef struct Vector3 { float x; float y; float z;
         return sqrt(x * x + y * y + z * z);
     }
 
-    /// Normalization
+    /// Normalization, the null vector stays null
     Vector3 operator~() const {
         float norm = !(*this);
+        if (norm == 0.0f) return { 0.0f, 0.0f, 0.0f };
         return { x / norm, y / norm, z / norm };
     }
 
@@ -132,12 +150,12 @@ typedef struct Vector3 { float x; float y; float z;
         return acos(((*this) * v2) / (norm1 * norm2));
     }
 
-    /// Projection
+    /// Projection on v2, null if v2 is null
     Vector3 operator>>(const Vector3 v2) const {
-        float norm2 = !v2;
-        norm2 *= norm2; // Squared the norm
-        float dotProd = (*this) * v2;
-        return (*this) *= (dotProd / norm2);
+        float norm2 = v2 * v2; // Squared norm
+        if (norm2 == 0.0f) return {};
+        Vector3 projection = v2;
+        return projection *= ((*this) * v2) / norm2;
     }
 } Vector3;
 
@@ -154,7 +172,8 @@ inline std::ostream& operator<<(std::ostream& os, const Vector3& v) {
 }
 
 /// Definitions of the types in TailorMade.
-#define ECS_Types int, float, std::string, bool, Vector2, Vector3
+// CustomValue holds every registered custom type (see TypeRegistry), it stays the last one.
+#define ECS_Types int, float, std::string, bool, Vector2, Vector3, CustomValue
 
 /// Map of dataName -> {dataType, value}
 using dataUnMap = std::unordered_map<std::string, std::pair<std::string, std::variant<ECS_Types>>>;
@@ -162,6 +181,20 @@ using dataUnMap = std::unordered_map<std::string, std::pair<std::string, std::va
 /// Vector of {dataType, value}.
 using dataVector = std::vector<std::pair<std::string, std::variant<ECS_Types>>>;
 
+/**
+ * @brief Return the type ID of the given type's name: the index of the type in variant<ECS_Types>.
+ * @details The names are resolved once, the type ID is then used to convert the values without comparing strings (see valueToType).
+ * @warning If the type is unknown an error is thrown.
+ * @param type The string version of the type. (e.g.: "Integer")
+ */
+size_t typeToID(const std::string& type);
+
+/**
+ * @brief Return the type ID of a value: the index of its type in variant<ECS_Types>, or the type ID of its custom type.
+ * @param value The value.
+ */
+size_t valueTypeID(const std::variant<ECS_Types>& value);
+
 /**
  * @brief Return a variant<ECS_Types> with the default value of the given type.
  * @details You can give a string of one of the supported types of TailorMade and it will return the associated variant with its default value.
@@ -179,6 +212,15 @@ std::variant<ECS_Types> strToType(std::string type);
  */
 std::variant<ECS_Types> valueToType(const nlohmann::json& value, std::string type);
 
+/**
+ * @brief Return a variant<ECS_Types> with the given value, of the type of the given type ID.
+ * @details The value is read by the decoder of its type, without any comparison of strings.
+ * @warning If the type ID is unknown an error is thrown.
+ * @param value A JSON object with the desired value in it.
+ * @param typeID The type ID, see typeToID (or the index of a value of this type).
+ */
+std::variant<ECS_Types> valueToType(const nlohmann::json& value, size_t typeID);
+
 /**
  * @brief Serialize the data in an ordered_json.
  * @see dataUnMap
@@ -193,65 +235,160 @@ nlohmann::ordered_json serializeType(const dataUnMap& data);
  */
 void valueToStream(std::ostream& stream, std::variant<ECS_Types> value);
 
+/**
+ * @brief Append a string to the given stream as a JSON string, quoted and escaped.
+ * @param stream The stream on which the string should be append.
+ * @param str The string to write.
+ */
+void stringToJSON(std::ostream& stream, const std::string& str);
+
+/**
+ * @brief Append the JSON text of the given variant value to the stream, the same value as serializeType without building a JSON object.
+ * @details The floats are written with the shortest text giving them back, the vectors as arrays.
+ * @param stream The stream on which the value should be append.
+ * @param value The variant to write.
+ * @param indent The indentation of the vectors' coordinates, their closing bracket is 4 spaces less. -1 to write them compact, on one line.
+ */
+void valueToJSON(std::ostream& stream, const std::variant<ECS_Types>& value, int indent = -1);
+
 /**
  * @brief Return every files from the given directory, includes all subfolders.
  * @param directory The directory in which the research starts.
  */
 std::vector<std::string> getAllFilesFromDirectory(const std::string& directory);
 
-inline std::variant<ECS_Types> strToType(std::string type) {
-    // This function return the default value for the given type.
+/// Vector of parsed JSON files, with the error of the file if it couldn't be read or parsed.
+using parsedFiles = std::vector<std::pair<nlohmann::json, std::exception_ptr>>;
+
+/// Size in bytes above which a definition's file is streamed instead of being parsed at once.
+constexpr uintmax_t streamingFileSize = 4 * 1024 * 1024;
+
+/**
+ * @brief Read and parse the given JSON files over the threads of the global ThreadPool.
+ * @details The results are in the same order as the files, the errors are kept with their file to be thrown when the file is used.
+ * @param files The paths of the files to parse.
+ * @param maxSize Files bigger than this size in bytes are not parsed, their result is a discarded JSON (see is_discarded) to let the caller stream them. 0 means no limit.
+ */
+parsedFiles parseFiles(const std::vector<std::string>& files, uintmax_t maxSize = 0);
+
+/**
+ * @brief Append the raw bytes of a trivially copyable value to the given stream.
+ * @warning The bytes are written in the native endianness, binary files are not portable between architectures.
+ * @param stream The stream on which the value should be append.
+ * @param value The value to write.
+ */
+template<typename Type>
+void writeBinary(std::ostream& stream, const Type& value);
+
+/**
+ * @brief Read a trivially copyable value written by writeBinary.
+ * @warning An error is thrown if the stream ends before the value.
+ * @param stream The stream to read from.
+ */
+template<typename Type>
+Type readBinary(std::istream& stream);
+
+/**
+ * @brief Append a string to the given stream, prefixed by its length.
+ * @param stream The stream on which the string should be append.
+ * @param str The string to write.
+ */
+void stringToBinary(std::ostream& stream, const std::string& str);
+
+/**
+ * @brief Read a string written by stringToBinary.
+ * @param stream The stream to read from.
+ */
+std::string binaryToString(std::istream& stream);
+
+/**
+ * @brief Append the binary version of the given variant value, prefixed by its type's index.
+ * @details A custom value is written as the hash of its type's name, then its raw bytes.
+ * @param stream The stream on which the value should be append.
+ * @param value The variant you want to serialize and append to the stream.
+ */
+void valueToBinary(std::ostream& stream, const std::variant<ECS_Types>& value);
+
+/**
+ * @brief Read a variant value written by valueToBinary.
+ * @warning If the type's index is unknown, or the custom type not registered, an error is thrown.
+ * @param stream The stream to read from.
+ */
+std::variant<ECS_Types> binaryToValue(std::istream& stream);
+
+/**
+ * @brief Return the 64 bits FNV-1a hash of the given bytes.
+ * @details Used as a checksum for the binary files.
+ * @param data The bytes to hash.
+ * @param size The number of bytes.
+ * @param hash The initial value, let you hash data in multiple parts.
+ */
+uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+inline size_t typeToID(const std::string& type) {
     // We authorize the first letter to be an upper or lower case, the others must be lower case exclusively.
     // There is the common variations for most of the types.
+    static const std::unordered_map<std::string, size_t> typeIDs = {
+        { "integer", 0 }, { "int", 0 },
+        { "float", 1 },
+        { "string", 2 }, { "str", 2 },
+        { "boolean", 3 }, { "bool", 3 },
+        { "vector2", 4 },
+        { "vector3", 5 }
+    };
+
+    std::string name = type;
+    if (!name.empty()) name[0] = tolower(static_cast<unsigned char>(name[0]));
+
+    auto found = typeIDs.find(name);
+    if (found != typeIDs.end()) return found->second;
+
+    // Otherwise, a registered custom type.
+    size_t typeID = TypeRegistry::global().find(name);
+    if (typeID == std::variant_npos) {
+        throw std::runtime_error("Error : invalid type \"" + name + "\".");
+    }
+    return typeID;
+}
 
-    type[0] = tolower(static_cast<unsigned char>(type[0]));
+inline size_t valueTypeID(const std::variant<ECS_Types>& value) {
+    if (const CustomValue* custom = std::get_if<CustomValue>(&value)) return custom->getTypeID();
+    return value.index();
+}
 
-    if (type == "integer" || type == "int") {
-        return 0;
-    }
-    else if (type == "float") {
-        return 0.0f;
-    }
-    else if (type == "string" || type == "str") {
-        return "";
-    }
-    else if (type == "boolean" || type == "bool") {
-        return false;
-    }
-    else if (type == "vector2") {
-        return Vector2({ 0.0f, 0.0f });
-    }
-    else if (type == "vector3") {
-        return Vector3({ 0.0f, 0.0f, 0.0f });
-    }
+/// Decoder of a JSON value into one type of variant<ECS_Types>.
+using typeDecoder = std::variant<ECS_Types>(*)(const nlohmann::json&);
 
-    throw std::runtime_error("Error : invalid type \"" + type + "\".");
+/// Decoders of each type of ECS_Types, by type ID, the custom types use their TypeInfo.
+inline const typeDecoder typeDecoders[] = {
+    [](const nlohmann::json& value) -> std::variant<ECS_Types> { return value.get<int>(); },
+    [](const nlohmann::json& value) -> std::variant<ECS_Types> { return value.get<float>(); },
+    [](const nlohmann::json& value) -> std::variant<ECS_Types> { return value.get<std::string>(); },
+    [](const nlohmann::json& value) -> std::variant<ECS_Types> { return value.get<bool>(); },
+    [](const nlohmann::json& value) -> std::variant<ECS_Types> { return Vector2{ value[0].get<float>(), value[1].get<float>() }; },
+    [](const nlohmann::json& value) -> std::variant<ECS_Types> { return Vector3{ value[0].get<float>(), value[1].get<float>(), value[2].get<float>() }; }
+};
+static_assert(std::size(typeDecoders) == std::variant_size_v<std::variant<ECS_Types>> - 1, "Every type of ECS_Types needs a decoder.");
+
+inline std::variant<ECS_Types> strToType(std::string type) {
+    // This function return the default value for the given type.
+    // Each type's default value, by type ID.
+    static const std::variant<ECS_Types> defaults[] = { 0, 0.0f, std::string(), false, Vector2({ 0.0f, 0.0f }), Vector3({ 0.0f, 0.0f, 0.0f }) };
+    static_assert(std::size(defaults) == std::variant_size_v<std::variant<ECS_Types>> - 1, "Every type of ECS_Types needs a default value.");
+
+    size_t typeID = typeToID(type);
+    if (typeID < std::size(defaults)) return defaults[typeID];
+    return CustomValue(typeID);
 }
 
 inline std::variant<ECS_Types> valueToType(const nlohmann::json& value, std::string type) {
     // This function return the variant from the given type with the given value.
-    type[0] = tolower(static_cast<unsigned char>(type[0]));
-
-    if (type == "integer" || type == "int") {
-        return value.get<int>();
-    }
-    else if (type == "float") {
-        return value.get<float>();
-    }
-    else if (type == "string" || type == "str") {
-        return value.get<std::string>();
-    }
-    else if (type == "boolean" || type == "bool") {
-        return value.get<bool>();
-    }
-    else if (type == "vector2") {
-        return Vector2{ value[0].get<float>(), value[1].get<float>() };
-    }
-    else if (type == "vector3") {
-        return Vector3{ value[0].get<float>(), value[1].get<float>(), value[2].get<float>() };
-    }
+    return valueToType(value, typeToID(type));
+}
 
-    throw std::runtime_error("Error : invalid type \"" + type + "\".");
+inline std::variant<ECS_Types> valueToType(const nlohmann::json& value, size_t typeID) {
+    if (typeID < std::size(typeDecoders)) return typeDecoders[typeID](value);
+    return CustomValue(typeID, value); // An error is thrown if it isn't a custom type.
 }
 
 inline nlohmann::ordered_json serializeType(const dataUnMap& dataMap) {
@@ -276,6 +413,9 @@ inline nlohmann::ordered_json serializeType(const dataUnMap& dataMap) {
             else if constexpr (std::is_same_v<T, Vector3>) {
                 dict[key] = { val.x, val.y, val.z };
             }
+            else if constexpr (std::is_same_v<T, CustomValue>) {
+                dict[key] = TypeRegistry::global().get(val.getTypeID()).toJSON(val.data());
+            }
         }, data);
     }
     return dict;
@@ -288,6 +428,100 @@ inline void valueToStream(std::ostream& stream, std::variant<ECS_Types> value) {
     }, value);
 }
 
+inline void stringToJSON(std::ostream& stream, const std::string& str) {
+    static const char hex[] = "0123456789abcdef";
+
+    stream.put('"');
+    for (unsigned char c : str) {
+        switch (c) {
+        case '"': stream << "\\\""; break;
+        case '\\': stream << "\\\\"; break;
+        case '\b': stream << "\\b"; break;
+        case '\f': stream << "\\f"; break;
+        case '\n': stream << "\\n"; break;
+        case '\r': stream << "\\r"; break;
+        case '\t': stream << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                stream << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+            }
+            else {
+                stream.put(static_cast<char>(c));
+            }
+        }
+    }
+    stream.put('"');
+}
+
+inline void valueToJSON(std::ostream& stream, const std::variant<ECS_Types>& value, int indent) {
+    auto writeFloat = [&stream](float val) {
+        // Same as nlohmann: no number for the infinities and NaN.
+        if (!std::isfinite(val)) {
+            stream << "null";
+            return;
+        }
+
+        char buffer[32];
+        char* end = std::to_chars(buffer, buffer + sizeof(buffer), val).ptr;
+        stream.write(buffer, end - buffer);
+
+        // Still read back as a float.
+        if (std::find_if(buffer, end, [](char c) { return c == '.' || c == 'e'; }) == end) stream << ".0";
+    };
+
+    auto writeCoordinates = [&](std::initializer_list<float> coordinates) {
+        std::string separator = indent < 0 ? "," : ",\n" + std::string(indent, ' ');
+        stream << '[';
+        if (indent >= 0) stream << '\n' << std::string(indent, ' ');
+        bool first = true;
+        for (float coordinate : coordinates) {
+            if (!first) stream << separator;
+            writeFloat(coordinate);
+            first = false;
+        }
+        if (indent >= 0) stream << '\n' << std::string(std::max(indent - 4, 0), ' ');
+        stream << ']';
+    };
+
+    std::visit([&](auto&& val) {
+        using T = std::decay_t<decltype(val)>;
+
+        if constexpr (std::is_same_v<T, int>) {
+            stream << val;
+        }
+        else if constexpr (std::is_same_v<T, float>) {
+            writeFloat(val);
+        }
+        else if constexpr (std::is_same_v<T, std::string>) {
+            stringToJSON(stream, val);
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            stream << (val ? "true" : "false");
+        }
+        else if constexpr (std::is_same_v<T, Vector2>) {
+            writeCoordinates({ val.x, val.y });
+        }
+        else if constexpr (std::is_same_v<T, Vector3>) {
+            writeCoordinates({ val.x, val.y, val.z });
+        }
+        else if constexpr (std::is_same_v<T, CustomValue>) {
+            nlohmann::json json = TypeRegistry::global().get(val.getTypeID()).toJSON(val.data());
+            if (indent < 0) {
+                stream << json.dump();
+                return;
+            }
+
+            // Indented like the dump of the whole object.
+            std::string text = json.dump(4);
+            std::string padding(std::max(indent - 4, 0), ' ');
+            for (char c : text) {
+                stream.put(c);
+                if (c == '\n') stream << padding;
+            }
+        }
+    }, value);
+}
+
 inline std::vector<std::string> getAllFilesFromDirectory(const std::string& directory) {
     std::vector<std::string> result;
 
@@ -305,4 +539,120 @@ inline std::vector<std::string> getAllFilesFromDirectory(const std::string& dire
     return result;
 }
 
+inline parsedFiles parseFiles(const std::vector<std::string>& files, uintmax_t maxSize) {
+    parsedFiles result(files.size());
+
+    ThreadPool::global().parallelFor(files.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            try {
+                if (maxSize != 0 && std::filesystem::file_size(files[i]) > maxSize) {
+                    result[i].first = nlohmann::json(nlohmann::json::value_t::discarded);
+                    continue;
+                }
+
+                std::ifstream file(files[i]);
+                if (!file) {
+                    throw std::runtime_error("Error : Can't read the file \"" + files[i] + "\"");
+                }
+                result[i].first = nlohmann::json::parse(file);
+            }
+            catch (...) {
+                result[i].second = std::current_exception();
+            }
+        }
+    });
+
+    return result;
+}
+
+template<typename Type>
+inline void writeBinary(std::ostream& stream, const Type& value) {
+    static_assert(std::is_trivially_copyable_v<Type>, "writeBinary only accepts trivially copyable types.");
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(Type));
+}
+
+template<typename Type>
+inline Type readBinary(std::istream& stream) {
+    static_assert(std::is_trivially_copyable_v<Type>, "readBinary only accepts trivially copyable types.");
+    Type value;
+    if (!stream.read(reinterpret_cast<char*>(&value), sizeof(Type))) {
+        throw std::runtime_error("Error : unexpected end of the binary stream.");
+    }
+    return value;
+}
+
+inline void stringToBinary(std::ostream& stream, const std::string& str) {
+    writeBinary<uint32_t>(stream, static_cast<uint32_t>(str.size()));
+    stream.write(str.data(), str.size());
+}
+
+inline std::string binaryToString(std::istream& stream) {
+    uint32_t size = readBinary<uint32_t>(stream);
+    std::string str(size, '\0');
+    if (!stream.read(str.data(), size)) {
+        throw std::runtime_error("Error : unexpected end of the binary stream.");
+    }
+    return str;
+}
+
+inline void valueToBinary(std::ostream& stream, const std::variant<ECS_Types>& value) {
+    writeBinary<uint8_t>(stream, static_cast<uint8_t>(value.index()));
+
+    std::visit([&](auto&& val) {
+        using T = std::decay_t<decltype(val)>;
+
+        if constexpr (std::is_same_v<T, std::string>) {
+            stringToBinary(stream, val);
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            writeBinary<uint8_t>(stream, val ? 1 : 0);
+        }
+        else if constexpr (std::is_same_v<T, CustomValue>) {
+            // Identified by its name's hash, the type IDs depend on the registration's order.
+            const TypeInfo& info = TypeRegistry::global().get(val.getTypeID());
+            writeBinary<uint64_t>(stream, info.hash);
+            stream.write(static_cast<const char*>(val.data()), info.size);
+        }
+        else {
+            writeBinary(stream, val); // int, float, Vector2, Vector3
+        }
+    }, value);
+}
+
+inline std::variant<ECS_Types> binaryToValue(std::istream& stream) {
+    uint8_t index = readBinary<uint8_t>(stream);
+
+    switch (index) {
+    case 0: return readBinary<int>(stream);
+    case 1: return readBinary<float>(stream);
+    case 2: return binaryToString(stream);
+    case 3: return readBinary<uint8_t>(stream) != 0;
+    case 4: return readBinary<Vector2>(stream);
+    case 5: return readBinary<Vector3>(stream);
+    case 6: {
+        uint64_t hash = readBinary<uint64_t>(stream);
+        size_t typeID = TypeRegistry::global().findHash(hash);
+        if (typeID == std::variant_npos) {
+            throw std::runtime_error("Error : unregistered custom type in the binary stream.");
+        }
+
+        CustomValue value(typeID);
+        if (!stream.read(static_cast<char*>(value.data()), TypeRegistry::global().get(typeID).size)) {
+            throw std::runtime_error("Error : unexpected end of the binary stream.");
+        }
+        return value;
+    }
+    }
+
+    throw std::runtime_error("Error : invalid type index " + std::to_string(index) + " in the binary stream.");
+}
+
+inline uint64_t hashBytes(const char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
 #endif //_TM_TOOLS_H
\ No newline at end of file
@@ -8,12 +8,35 @@
 #ifndef _TAILOR_MADE_H
 #define _TAILOR_MADE_H
 
+#include <ThreadPool.h>
+#include <TypeRegistry.h>
 #include <TM_Tools.h>
+#include <VectorMath.h>
 #include <Component.h>
 #include <EntityManager.h>
 #include <Subscription.h>
 #include <System.h>
 #include <ComponentManager.h>
 #include <Environment.h>
+#include <Rollback.h>
+#include <Persistence.h>
+#include <Operation.h>
+#include <Journal.h>
+#include <Recorder.h>
+#include <Replayer.h>
+#include <ContentCache.h>
+#include <HotReload.h>
+#include <GroupStreamer.h>
+#include <SpatialIndex.h>
+#include <ValueIndex.h>
+#include <Aggregate.h>
+#include <ChangeTracker.h>
+#include <ComponentObservers.h>
+#include <EventBus.h>
+#include <FrameLoop.h>
+#include <UpdateLOD.h>
+#include <CoroutineScheduler.h>
+#include <TimerWheel.h>
+#include <Hierarchy.h>
 
 #endif //_TAILOR_MADE_H
\ No newline at end of file
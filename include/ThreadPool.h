@@ -0,0 +1,119 @@
+/**
+ * @file ThreadPool.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <cstdint>
+
+ /**
+ * @file ThreadPool.h
+ * @brief ThreadPool implementation
+ *
+ * @details This ThreadPool class keeps a set of threads alive to split loops over them, without creating threads for each loop.
+ * @details The calling thread works too, a loop called from inside a loop of the same pool runs on the calling thread only.
+ */
+
+class ThreadPool {
+public:
+    /**
+     * @brief Constructor of the ThreadPool, start the threads.
+     * @param threads Number of threads, 0 means one per hardware thread minus the calling one.
+     */
+    ThreadPool(size_t threads = 0);
+
+    /**
+     * @brief Stop and join the threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Return the pool shared by the whole library, created on its first use.
+     */
+    static ThreadPool& global();
+
+    /**
+     * @brief Return the number of threads which can work on a loop, the calling thread included.
+     */
+    size_t getSize();
+
+    /**
+     * @brief Split the range [0, count) in chunks of grain elements and call function(begin, end) on each chunk, over the threads.
+     * @details Return once every chunk is done. Only one loop runs at a time on a pool, the other callers wait.
+     * @details If a chunk throws, the first exception is thrown again by this method once the loop is over.
+     * @param count Number of elements.
+     * @param function Function called on each chunk, with the first and the last (excluded) indexes.
+     * @param grain Number of elements of a chunk.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& function, size_t grain = 1);
+
+private:
+    /**
+     * The threads of the pool.
+     */
+    std::vector<std::thread> workers;
+
+    /**
+     * The loop currently running, nullptr if none.
+     */
+    const std::function<void(size_t, size_t)>* job;
+
+    /**
+     * Size and chunks' size of the current loop.
+     */
+    size_t count;
+    size_t grain;
+
+    /**
+     * First index of the next chunk to take.
+     */
+    std::atomic<size_t> next;
+
+    /**
+     * Number of threads still working on the current loop.
+     */
+    size_t active;
+
+    /**
+     * Incremented for each new loop, to wake the threads.
+     */
+    uint64_t generation;
+
+    /**
+     * True once the pool is stopping.
+     */
+    bool stop;
+
+    /**
+     * First exception thrown by the current loop.
+     */
+    std::exception_ptr error;
+
+    std::mutex mtx;
+    std::mutex jobMtx;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    /**
+     * @brief Loop of the threads.
+     */
+    void run();
+
+    /**
+     * @brief Take and process chunks of the current loop until there is none left.
+     */
+    void work();
+};
+
+#endif //_THREADPOOL_H
@@ -0,0 +1,199 @@
+/**
+ * @file TimerWheel.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _TIMERWHEEL_H
+#define _TIMERWHEEL_H
+
+#include <EntityManager.h>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+/**
+ * What a timer does when it expires.
+ */
+enum class TimerAction {
+    /// Remove the entity.
+    Remove,
+    /// Set the state of a component of the entity.
+    State,
+    /// Call a function.
+    Callback
+};
+
+/// ID of a timer, 0 is never a timer.
+typedef uint64_t TimerID;
+
+/**
+ * The timers expired by an advance, by action.
+ */
+typedef struct ExpiredTimers {
+    /// The entities to remove.
+    std::vector<int> removed;
+    /// The state changes {entity, component, state}.
+    std::vector<std::tuple<int, std::string, bool>> states;
+    /// The functions to call, in order of expiration.
+    std::vector<std::function<void()>> callbacks;
+
+    /// Return the number of expired timers.
+    size_t size() const { return removed.size() + states.size() + callbacks.size(); }
+} ExpiredTimers;
+
+ /**
+ * @file TimerWheel.h
+ * @brief TimerWheel implementation
+ *
+ * @details This TimerWheel class keeps timers expiring at a future tick (e.g.: the lifetime of an effect), in a hierarchical timing wheel: 4 levels of 256 slots, each slot of a level lasting 256 slots of the level below.
+ * @details A timer is put in the level of its distance, and moved to the lower levels as the ticks come: insertion and cancellation are O(1), an advance only visits the slots of the elapsed ticks and skips the empty levels.
+ * @details The timers are kept in a pool, linked in their slot and in the list of their entity: the timers of an entity are cancelled when it is removed from the EntityManager (the IDs of the entities are reused).
+ * @details The expired timers are returned by batch, to be applied with the bulk methods of the Environment (see Environment::advanceTimers).
+ */
+
+class TimerWheel : public EntityListener {
+public:
+    TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief Schedule the removal of an entity.
+     * @param entity The entity's ID.
+     * @param ticks The number of ticks before the removal, 0 is the next tick.
+     */
+    TimerID removeAfter(int entity, uint64_t ticks);
+
+    /**
+     * @brief Schedule a change of state of an entity's component.
+     * @param entity The entity's ID.
+     * @param component The name of the component.
+     * @param state The new state.
+     * @param ticks The number of ticks before the change, 0 is the next tick.
+     */
+    TimerID setStateAfter(int entity, const std::string& component, bool state, uint64_t ticks);
+
+    /**
+     * @brief Schedule a call, optionally bound to an entity (cancelled with it).
+     * @param ticks The number of ticks before the call, 0 is the next tick.
+     * @param callback The function called.
+     * @param entity The entity of the timer, -1 for none.
+     */
+    TimerID callAfter(uint64_t ticks, std::function<void()> callback, int entity = -1);
+
+    /**
+     * @brief Cancel a timer, return false if it expired, was cancelled or doesn't exist.
+     */
+    bool cancel(TimerID ID);
+
+    /**
+     * @brief Cancel every timer of an entity.
+     */
+    void cancelEntity(int entity);
+
+    /**
+     * @brief Advance the wheel and return the timers expired, in order of tick.
+     * @param ticks The number of ticks to advance.
+     */
+    ExpiredTimers advance(uint64_t ticks = 1);
+
+    /**
+     * @brief Return the current tick.
+     */
+    uint64_t getTick();
+
+    /**
+     * @brief Return the number of timers pending.
+     */
+    size_t size();
+
+    void onRemove(EntityManager& manager, int entity, const std::string& name) override;
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+    static constexpr size_t levels = 4;
+    static constexpr size_t slotBits = 8;
+    static constexpr size_t slotCount = size_t(1) << slotBits;
+
+    /**
+     * The list of the timers beyond the last level, after the slots.
+     */
+    static constexpr uint32_t overflow = levels * slotCount;
+
+    typedef struct Timer {
+        uint64_t deadline;
+        /// The previous and next timers of its slot, and of its entity.
+        uint32_t previous;
+        uint32_t next;
+        uint32_t entityPrevious;
+        uint32_t entityNext;
+        /// The list of its slot, none when free.
+        uint32_t list;
+        /// Incremented at each reuse, the IDs of the previous timers don't match anymore.
+        uint32_t generation;
+        int entity;
+        uint32_t component;
+        TimerAction action;
+        bool state;
+        std::function<void()> callback;
+    } Timer;
+
+    std::vector<Timer> timers;
+    std::vector<uint32_t> freeTimers;
+
+    /**
+     * First timer of each slot of each level, then of the overflow.
+     */
+    std::vector<uint32_t> heads;
+
+    /**
+     * Number of timers in each level, then in the overflow.
+     */
+    std::vector<size_t> sizes;
+
+    /**
+     * First timer of each entity with timers.
+     */
+    std::unordered_map<int, uint32_t> entityHeads;
+
+    /**
+     * The names of the components of the timers, kept once.
+     */
+    std::vector<std::string> components;
+    std::unordered_map<std::string, uint32_t> componentIDs;
+
+    uint64_t tick;
+    size_t pending;
+
+    std::mutex mtx;
+
+    /**
+     * @brief Take a timer from the pool and insert it, the wheel should be locked.
+     */
+    TimerID add(uint64_t ticks, TimerAction action, int entity, uint32_t component, bool state, std::function<void()> callback);
+
+    /**
+     * @brief Link a timer in the slot of its deadline, the wheel should be locked.
+     */
+    void link(uint32_t index);
+
+    /**
+     * @brief Unlink a timer from its slot, the wheel should be locked.
+     */
+    void unlink(uint32_t index);
+
+    /**
+     * @brief Unlink a timer from its slot and its entity, and give it back to the pool, the wheel should be locked.
+     */
+    void release(uint32_t index);
+
+    /**
+     * @brief Move the timers of a slot to the slots of their deadlines, the wheel should be locked.
+     */
+    void cascade(uint32_t list);
+};
+
+#endif //_TIMERWHEEL_H
@@ -0,0 +1,266 @@
+/**
+ * @file TypeRegistry.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _TYPEREGISTRY_H
+#define _TYPEREGISTRY_H
+
+#include <json.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+#include <new>
+
+/**
+ * @brief Trait describing a custom type of data, specialize it then register the type (see TM_REGISTER_TYPE).
+ * @details The type should be trivially copyable (e.g.: a struct of floats), it is copied and written in binary as raw bytes.
+ * @details Example :
+ * @code
+ * typedef struct Color { float r, g, b, a; } Color;
+ *
+ * template<>
+ * struct TypeTraits<Color> {
+ *     static constexpr const char* name = "color";
+ *     static Color defaultValue() { return { 0.0f, 0.0f, 0.0f, 1.0f }; }
+ *     static nlohmann::json toJSON(const Color& value) { return { value.r, value.g, value.b, value.a }; }
+ *     static Color fromJSON(const nlohmann::json& value) { return { value[0], value[1], value[2], value[3] }; }
+ * };
+ * TM_REGISTER_TYPE(Color);
+ * @endcode
+ */
+template<typename Type>
+struct TypeTraits;
+
+/**
+ * A type with its TypeTraits, which can be used as a custom type of data.
+ */
+template<typename Type>
+concept CustomType = requires(const Type& value, const nlohmann::json& json) {
+    { TypeTraits<Type>::name } -> std::convertible_to<const char*>;
+    { TypeTraits<Type>::defaultValue() } -> std::same_as<Type>;
+    { TypeTraits<Type>::toJSON(value) } -> std::convertible_to<nlohmann::json>;
+    { TypeTraits<Type>::fromJSON(json) } -> std::same_as<Type>;
+};
+
+/**
+ * Structure of a registered custom type, its size and its codecs, used to dispatch by type ID.
+ */
+typedef struct TypeInfo {
+    /// Name of the type in the components' files, in lower case.
+    std::string name;
+    /// Size and alignment in bytes of the type.
+    size_t size;
+    size_t alignment;
+    /// Hash of the name, identifies the type in the binary files whatever the registration's order.
+    uint64_t hash;
+    /// Write the default value in the given bytes.
+    void (*construct)(void* bytes);
+    /// Return the JSON of the value in the given bytes.
+    nlohmann::json (*toJSON)(const void* bytes);
+    /// Write the value of the JSON in the given bytes.
+    void (*fromJSON)(const nlohmann::json& value, void* bytes);
+} TypeInfo;
+
+/**
+ * @file TypeRegistry.h
+ * @brief TypeRegistry implementation
+ *
+ * @details This TypeRegistry class keeps the custom types of data, added on top of the types of ECS_Types without changing the variant.
+ * @details A custom type gets a type ID after the ones of ECS_Types, its values are stored in a CustomValue and converted through the function pointers of its TypeInfo.
+ * @warning The types should be registered before being used (e.g.: with TM_REGISTER_TYPE, at the program's start), the registration is not thread safe.
+ */
+
+class TypeRegistry {
+public:
+    /**
+     * @brief Return the registry shared by the whole program.
+     */
+    static TypeRegistry& global();
+
+    /**
+     * @brief Register a custom type and return its type ID, or its type ID if already registered.
+     * @warning An error is thrown if another type already has this name.
+     */
+    template<CustomType Type>
+    size_t add();
+
+    /**
+     * @brief Return the information of a custom type from its type ID.
+     * @warning An error is thrown if the type ID is not one of a custom type.
+     * @param typeID The type ID.
+     */
+    const TypeInfo& get(size_t typeID);
+
+    /**
+     * @brief Return the type ID of a custom type from its name, std::variant_npos if unknown.
+     * @param name The type's name, in lower case.
+     */
+    size_t find(const std::string& name);
+
+    /**
+     * @brief Return the type ID of a custom type from the hash of its name, std::variant_npos if unknown.
+     * @param hash The hash of the type's name, see TypeInfo.
+     */
+    size_t findHash(uint64_t hash);
+
+    /**
+     * @brief Return the type ID of the first custom type, the number of the types of ECS_Types.
+     */
+    static size_t getFirstID();
+
+private:
+    std::vector<TypeInfo> types;
+    std::unordered_map<std::string, size_t> names;
+    std::unordered_map<uint64_t, size_t> hashes;
+
+    size_t insert(TypeInfo info);
+};
+
+/**
+ * @brief Return the type ID of a custom type, registered on its first use.
+ */
+template<CustomType Type>
+size_t customTypeID() {
+    static const size_t typeID = TypeRegistry::global().add<Type>();
+    return typeID;
+}
+
+/**
+ * Register a custom type when the program starts, to be usable in the components' files.
+ * To use once per type, in a source file.
+ */
+#define TM_REGISTER_TYPE(Type) \
+    static const size_t TM_CONCAT(tmTypeRegistration, __LINE__) = customTypeID<Type>()
+
+#define TM_CONCAT(a, b) TM_CONCAT_IMPL(a, b)
+#define TM_CONCAT_IMPL(a, b) a##b
+
+/**
+ * @file TypeRegistry.h
+ * @brief CustomValue implementation
+ *
+ * @details This CustomValue class holds a value of any registered custom type, it is the alternative of variant<ECS_Types> for all of them.
+ * @details The values up to 24 bytes (and aligned on 8 bytes at most) are stored inline, the variant doesn't grow. The bigger ones (e.g.: a 4x4 matrix) are stored on the heap.
+ */
+
+class CustomValue {
+public:
+    /**
+     * @brief Constructor of a CustomValue with the given value.
+     */
+    template<CustomType Type>
+    CustomValue(const Type& value);
+
+    /**
+     * @brief Constructor of a CustomValue with the default value of the type.
+     * @param typeID The custom type's ID.
+     */
+    explicit CustomValue(size_t typeID);
+
+    /**
+     * @brief Constructor of a CustomValue with the value of the given JSON.
+     * @param typeID The custom type's ID.
+     * @param value The JSON of the value, read by the type's TypeTraits::fromJSON.
+     */
+    CustomValue(size_t typeID, const nlohmann::json& value);
+
+    CustomValue(const CustomValue& other);
+    CustomValue(CustomValue&& other) noexcept;
+    CustomValue& operator=(const CustomValue& other);
+    CustomValue& operator=(CustomValue&& other) noexcept;
+    ~CustomValue();
+
+    /**
+     * @brief Return the type ID of the value.
+     */
+    size_t getTypeID() const;
+
+    /**
+     * @brief Return the value, an error is thrown if it is not of this type.
+     */
+    template<CustomType Type>
+    const Type& get() const;
+
+    /**
+     * @brief Return the bytes of the value.
+     */
+    const void* data() const;
+    void* data();
+
+    /**
+     * @brief Return true if both values are of the same type with the same bytes.
+     */
+    bool operator==(const CustomValue& other) const;
+
+private:
+    static constexpr size_t inlineSize = 24;
+
+    uint32_t typeID;
+
+    union {
+        alignas(8) unsigned char bytes[inlineSize];
+        void* heap;
+    };
+
+    /**
+     * @brief Return true if the values of this type are on the heap.
+     */
+    static bool onHeap(const TypeInfo& info);
+
+    /**
+     * @brief Make room for a value of the type, uninitialized.
+     */
+    void allocate(size_t typeID);
+
+    /**
+     * @brief Free the heap's room, if any.
+     */
+    void release();
+};
+
+/// Print a custom value, as its JSON.
+std::ostream& operator<<(std::ostream& os, const CustomValue& value);
+
+template<CustomType Type>
+inline size_t TypeRegistry::add() {
+    static_assert(std::is_trivially_copyable_v<Type>, "A custom type should be trivially copyable.");
+
+    TypeInfo info;
+    info.name = TypeTraits<Type>::name;
+    info.size = sizeof(Type);
+    info.alignment = alignof(Type);
+    info.hash = 0;
+    info.construct = [](void* bytes) {
+        new (bytes) Type(TypeTraits<Type>::defaultValue());
+    };
+    info.toJSON = [](const void* bytes) -> nlohmann::json {
+        return TypeTraits<Type>::toJSON(*static_cast<const Type*>(bytes));
+    };
+    info.fromJSON = [](const nlohmann::json& value, void* bytes) {
+        new (bytes) Type(TypeTraits<Type>::fromJSON(value));
+    };
+    return insert(std::move(info));
+}
+
+template<CustomType Type>
+inline CustomValue::CustomValue(const Type& value) {
+    allocate(customTypeID<Type>());
+    std::memcpy(data(), &value, sizeof(Type));
+}
+
+template<CustomType Type>
+inline const Type& CustomValue::get() const {
+    if (typeID != customTypeID<Type>()) {
+        throw std::runtime_error("Error : the value is not a \"" + std::string(TypeTraits<Type>::name) + "\".");
+    }
+    return *static_cast<const Type*>(data());
+}
+
+#endif //_TYPEREGISTRY_H
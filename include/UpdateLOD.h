@@ -0,0 +1,113 @@
+/**
+ * @file UpdateLOD.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _UPDATELOD_H
+#define _UPDATELOD_H
+
+#include <ComponentManager.h>
+#include <functional>
+#include <mutex>
+
+ /**
+ * @file UpdateLOD.h
+ * @brief UpdateLOD implementation
+ *
+ * @details This UpdateLOD class spreads the updates of entities by level of detail: a user's function gives the priority of an entity (the lower the more important, e.g.: its distance to the camera), and the thresholds split the priorities in levels.
+ * @details An entity of a level is updated once every period of its level. Each level has one slot per run of its period, the entities are spread over the slots so each run updates about the same number of entities.
+ * @details The priority of an entity is evaluated again each time it is updated: it moves to its new level then, without evaluating the other entities.
+ * @details The new entities are updated at the next run whatever their level.
+ */
+
+class UpdateLOD {
+public:
+    /**
+     * @brief Constructor of the UpdateLOD.
+     * @warning An error is thrown if the thresholds are not increasing, if there isn't one period more than thresholds or if a period is 0.
+     * @param priority Return the priority of an entity.
+     * @param thresholds The increasing priorities separating the levels, an entity is of level L if its priority is below thresholds[L] (and not below the previous ones).
+     * @param periods The number of runs between two updates of an entity, per level.
+     */
+    UpdateLOD(std::function<float(int)> priority, std::vector<float> thresholds, std::vector<size_t> periods);
+
+    UpdateLOD(const UpdateLOD&) = delete;
+    UpdateLOD& operator=(const UpdateLOD&) = delete;
+
+    /**
+     * @brief Add an entity, updated at the next run. Can be called from any thread.
+     */
+    void add(int entity);
+
+    /**
+     * @brief Return the entities to update at this run, and move them to the level of their current priority.
+     * @details Called by one thread at a time, the priority function is called for the returned entities.
+     * @details If the priority or alive function throws, no entity is dropped: the error is given back and the entities stay followed.
+     * @param alive Return false for an entity which should not be followed anymore, it is then dropped.
+     */
+    std::vector<int> next(const std::function<bool(int)>& alive);
+
+    /**
+     * @brief Return the level of an entity, std::string::npos if it isn't followed.
+     */
+    size_t getLevel(int entity);
+
+    /**
+     * @brief Return the number of entities of a level.
+     */
+    size_t count(size_t level);
+
+    /**
+     * @brief Return a priority function giving the distance between a Vector3 data of the entities and a point (e.g.: the camera's position).
+     * @details The entities without the component are given an infinite priority.
+     * @param manager The manager of the component.
+     * @param field The name of the Vector3 data.
+     * @param origin Return the point, called for each evaluated entity.
+     */
+    static std::function<float(int)> distance(std::shared_ptr<ComponentManager> manager, const std::string& field, std::function<Vector3()> origin);
+
+private:
+    typedef struct Place {
+        size_t level;
+        size_t slot;
+    } Place;
+
+    std::function<float(int)> priority;
+    std::vector<float> thresholds;
+    std::vector<size_t> periods;
+
+    /**
+     * The entities by level then by slot, the slot of the run r of a level of period p is r % p.
+     */
+    std::vector<std::vector<std::vector<int>>> slots;
+
+    /**
+     * The level and slot of each followed entity.
+     */
+    std::unordered_map<int, Place> places;
+
+    /**
+     * The number of runs.
+     */
+    uint64_t run;
+
+    /**
+     * The added entities not followed yet, and their lock.
+     */
+    std::vector<int> pending;
+    std::mutex mtx;
+
+    /**
+     * @brief Return the level of a priority.
+     */
+    size_t levelOf(float priority);
+
+    /**
+     * @brief Put an entity in a level, in its slot if it stays in its level, else in the slot with the least entities.
+     */
+    void put(int entity, size_t level, size_t slot);
+};
+
+#endif //_UPDATELOD_H
@@ -0,0 +1,206 @@
+/**
+ * @file ValueIndex.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _VALUEINDEX_H
+#define _VALUEINDEX_H
+
+#include <ComponentManager.h>
+#include <span>
+#include <mutex>
+#include <unordered_set>
+
+/**
+ * How the values of a ValueIndex are organized.
+ */
+enum class ValueIndexKind {
+    /// Entities grouped by value, for the equality queries (e.g.: level == "hard").
+    Hash,
+    /// Values kept sorted, for the range queries (e.g.: hp < 20) and the equality queries.
+    Ordered
+};
+
+/// A value of an indexed data, the scalar types of ECS_Types in the same order (the index of its type is the type ID).
+using IndexValue = std::variant<int, float, std::string, bool>;
+
+/**
+ * IDs of entities returned by a ValueIndex.
+ * The IDs are shared with the index and not copied, they stay valid (and unchanged) as long as the span is kept, even if the index changes.
+ */
+class EntitySpan {
+public:
+    EntitySpan() = default;
+    EntitySpan(std::shared_ptr<const std::vector<int>> storage, size_t begin, size_t end) : storage(std::move(storage)), ids(this->storage->data() + begin, end - begin) {}
+
+    const int* begin() const { return ids.data(); }
+    const int* end() const { return ids.data() + ids.size(); }
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+    int operator[](size_t i) const { return ids[i]; }
+    operator std::span<const int>() const { return ids; }
+
+private:
+    std::shared_ptr<const std::vector<int>> storage;
+    std::span<const int> ids;
+};
+
+ /**
+ * @file ValueIndex.h
+ * @brief ValueIndex implementation
+ *
+ * @details This ValueIndex class indexes the entities of a ComponentManager by the value of one of its int, float, string or bool data, to find them without reading every component.
+ * @details It follows the manager as a ComponentListener: the subscriptions and the writes of the indexed data update it incrementally.
+ * @details A hash index is updated in place. An ordered index keeps the entities changed since its last query apart, and merges them in its sorted values at the next query.
+ * @details The results are EntitySpan, which can be given to System::select to keep the entities of a System.
+ * @details The states of the components are not checked, the entities whose component is disabled are returned. The NaN values are not indexed.
+ * @warning The data should be written through Component::set to be followed, a reshape of the manager is not (call rebuild).
+ */
+
+class ValueIndex : public ComponentListener {
+public:
+    /**
+     * @brief Constructor of the ValueIndex, index the entities already subscribed to the manager.
+     * @details The index should then be added to the manager's listeners (see Environment::enableValueIndex, which does both).
+     * @warning An error is thrown if the data is not an int, a float, a string or a bool.
+     * @param manager The indexed manager.
+     * @param field Name of the indexed data.
+     * @param kind How the values are organized.
+     */
+    ValueIndex(std::shared_ptr<ComponentManager> manager, const std::string& field, ValueIndexKind kind = ValueIndexKind::Ordered);
+
+    ValueIndex(const ValueIndex&) = delete;
+    ValueIndex& operator=(const ValueIndex&) = delete;
+
+    /**
+     * @brief Return the entities whose data is equal to the value, in no specific order.
+     * @warning An error is thrown if the value is not of the data's type (an int is accepted for a float).
+     */
+    EntitySpan equal(const IndexValue& value);
+
+    /**
+     * @brief Return the entities whose data is in [min, max], by increasing value.
+     * @warning An error is thrown for a hash index, or if the values are not of the data's type (an int is accepted for a float).
+     */
+    EntitySpan range(const IndexValue& min, const IndexValue& max);
+
+    /**
+     * @brief Return the entities whose data is lower than the value (or equal if inclusive), by increasing value.
+     * @warning An error is thrown for a hash index, or if the value is not of the data's type (an int is accepted for a float).
+     */
+    EntitySpan below(const IndexValue& value, bool inclusive = false);
+
+    /**
+     * @brief Return the entities whose data is greater than the value (or equal if inclusive), by increasing value.
+     * @warning An error is thrown for a hash index, or if the value is not of the data's type (an int is accepted for a float).
+     */
+    EntitySpan above(const IndexValue& value, bool inclusive = false);
+
+    /**
+     * @brief Read the values of every entity again and rebuild the index.
+     * @warning An error is thrown if the manager doesn't exist anymore, or if the data's type is not indexable anymore (e.g.: after a reshape).
+     */
+    void rebuild();
+
+    /**
+     * @brief Return the number of indexed entities.
+     */
+    size_t size();
+
+    /**
+     * @brief Return the name of the indexed data.
+     */
+    const std::string& getField();
+
+    /**
+     * @brief Return how the values are organized.
+     */
+    ValueIndexKind getKind();
+
+    /**
+     * @brief Return the indexed manager, nullptr if it doesn't exist anymore.
+     */
+    std::shared_ptr<ComponentManager> getManager();
+
+    void onSubscribe(ComponentManager& manager, int entity) override;
+    void onUnsubscribe(ComponentManager& manager, int entity, std::shared_ptr<Component> component, bool state) override;
+    void afterSet(ComponentManager& manager, int entity, Component& component, const std::string& name) override;
+
+private:
+    /**
+     * An indexed entity: its value and, for a hash index, its index in the entities of this value.
+     */
+    typedef struct Entry {
+        IndexValue value;
+        uint32_t slot;
+    } Entry;
+
+    /**
+     * The indexed manager, weak as the manager keeps its listeners.
+     */
+    std::weak_ptr<ComponentManager> manager;
+    std::string field;
+    ValueIndexKind kind;
+    size_t typeID;
+
+    std::unordered_map<int, Entry> entries;
+
+    /**
+     * The hash index's entities by value. The vectors shared with an EntitySpan are copied before being changed.
+     */
+    std::unordered_map<IndexValue, std::shared_ptr<std::vector<int>>> buckets;
+
+    /**
+     * The ordered index's sorted values and their entities, and the entities added, changed or removed since they were sorted.
+     */
+    std::vector<IndexValue> values;
+    std::shared_ptr<const std::vector<int>> ids;
+    std::unordered_set<int> changed;
+
+    std::mutex mtx;
+
+    /**
+     * @brief Read the indexed data of a component.
+     */
+    IndexValue read(Component& component);
+
+    /**
+     * @brief Return the value converted to the data's type, an error is thrown if it can't be.
+     */
+    IndexValue convert(const IndexValue& value);
+
+    /**
+     * @brief Throw an error if the index is not ordered.
+     */
+    void checkOrdered();
+
+    /**
+     * @brief Set or remove the value of an entity, the index should be locked.
+     */
+    void update(int entity, IndexValue value);
+    void remove(int entity);
+
+    /**
+     * @brief Return the entities of a value, copied first if shared with an EntitySpan, the index should be locked.
+     */
+    std::vector<int>& bucket(const IndexValue& value);
+
+    /**
+     * @brief Take an entity out of the entities of its value, the index should be locked.
+     */
+    void unlink(const Entry& entry);
+
+    /**
+     * @brief Merge the changed entities in the sorted values, the index should be locked.
+     */
+    void merge();
+
+    /**
+     * @brief Return the ordered index's entities of the sorted values' range [begin, end).
+     */
+    EntitySpan slice(size_t begin, size_t end);
+};
+
+#endif //_VALUEINDEX_H
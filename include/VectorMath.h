@@ -0,0 +1,141 @@
+/**
+ * @file VectorMath.h
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#ifndef _VECTORMATH_H
+#define _VECTORMATH_H
+
+#include <TM_Tools.h>
+#include <span>
+
+/**
+ * Instruction sets of the VectorMath's kernels.
+ */
+enum class SimdLevel {
+    /// Plain C++, on every CPU.
+    Scalar,
+    /// 4 floats at once, on every x86-64 CPU.
+    SSE,
+    /// 8 floats at once, on the x86-64 CPUs supporting it.
+    AVX2
+};
+
+/**
+ * Vectors split in an array per coordinate (structure of arrays), z is null for 2D vectors.
+ * The arrays of an input are only read.
+ */
+typedef struct VectorColumns {
+    float* x;
+    float* y;
+    float* z;
+    size_t size;
+} VectorColumns;
+
+/**
+ * Sum, minimum and maximum of an array of floats.
+ */
+typedef struct FloatReduction {
+    float sum;
+    float min;
+    float max;
+} FloatReduction;
+
+ /**
+ * @file VectorMath.h
+ * @brief VectorMath implementation
+ *
+ * @details This VectorMath class applies the operators of Vector2 and Vector3 to whole arrays of vectors, for the systems updating many entities per tick.
+ * @details The kernels are written for SSE and AVX2, and in plain C++ for the other CPUs. The best supported ones are chosen when first used, from the CPU's features.
+ * @details The results are the same whatever the instruction set (no fused multiply-add, no approximated square root), so a replay gives the same states on another CPU.
+ * @details The vectors can be given as spans of Vector2/Vector3, or as VectorColumns (faster, nothing to reorder).
+ * @details The output can be one of the inputs. An error is thrown if the sizes don't match.
+ * @details Like the operators, a null vector is normalized to a null vector, and the projection on a null vector is null.
+ * @warning Built with -ffast-math, or with the contraction of the floating-point operations in FMA instructions, the results can differ between the instruction sets.
+ */
+
+class VectorMath {
+public:
+    /**
+     * @brief Return the instruction set used by the kernels.
+     */
+    static SimdLevel getLevel();
+
+    /**
+     * @brief Use another instruction set, limited to the best one supported by the CPU (e.g.: to compare them).
+     * @warning Not thread safe, to call while no kernel is running.
+     * @return The instruction set actually used.
+     */
+    static SimdLevel setLevel(SimdLevel level);
+
+    /**
+     * @brief Return the best instruction set supported by the CPU.
+     */
+    static SimdLevel detect();
+
+    /**
+     * @brief out[i] = a[i] + b[i]
+     */
+    static void add(std::span<const Vector2> a, std::span<const Vector2> b, std::span<Vector2> out);
+    static void add(std::span<const Vector3> a, std::span<const Vector3> b, std::span<Vector3> out);
+    static void add(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out);
+
+    /**
+     * @brief out[i] = a[i] * s
+     */
+    static void scale(std::span<const Vector2> a, float s, std::span<Vector2> out);
+    static void scale(std::span<const Vector3> a, float s, std::span<Vector3> out);
+    static void scale(const VectorColumns& a, float s, const VectorColumns& out);
+
+    /**
+     * @brief out[i] = a[i] + b[i] * s (e.g.: position + velocity * dt)
+     */
+    static void addScaled(std::span<const Vector2> a, std::span<const Vector2> b, float s, std::span<Vector2> out);
+    static void addScaled(std::span<const Vector3> a, std::span<const Vector3> b, float s, std::span<Vector3> out);
+    static void addScaled(const VectorColumns& a, const VectorColumns& b, float s, const VectorColumns& out);
+
+    /**
+     * @brief out[i] = a[i] * b[i] (dot product)
+     */
+    static void dot(std::span<const Vector2> a, std::span<const Vector2> b, std::span<float> out);
+    static void dot(std::span<const Vector3> a, std::span<const Vector3> b, std::span<float> out);
+    static void dot(const VectorColumns& a, const VectorColumns& b, std::span<float> out);
+
+    /**
+     * @brief out[i] = a[i] ^ b[i] (cross product)
+     */
+    static void cross(std::span<const Vector3> a, std::span<const Vector3> b, std::span<Vector3> out);
+    static void cross(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out);
+
+    /**
+     * @brief out[i] = !a[i] (norm)
+     */
+    static void length(std::span<const Vector2> a, std::span<float> out);
+    static void length(std::span<const Vector3> a, std::span<float> out);
+    static void length(const VectorColumns& a, std::span<float> out);
+
+    /**
+     * @brief out[i] = ~a[i] (normalization)
+     */
+    static void normalize(std::span<const Vector2> a, std::span<Vector2> out);
+    static void normalize(std::span<const Vector3> a, std::span<Vector3> out);
+    static void normalize(const VectorColumns& a, const VectorColumns& out);
+
+    /**
+     * @brief out[i] = a[i] >> b[i] (projection of a on b)
+     */
+    static void project(std::span<const Vector2> a, std::span<const Vector2> b, std::span<Vector2> out);
+    static void project(std::span<const Vector3> a, std::span<const Vector3> b, std::span<Vector3> out);
+    static void project(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out);
+
+    /**
+     * @brief Return the sum, the minimum and the maximum of the values (0, +infinity and -infinity if there is none).
+     * @details The values are summed in 8 lanes whatever the instruction set, the sum is the same on every CPU. The NaN values are skipped by the minimum and the maximum.
+     * @details Used on a column of VectorColumns to reduce a coordinate.
+     */
+    static FloatReduction reduce(std::span<const float> values);
+};
+
+#endif //_VECTORMATH_H
@@ -0,0 +1,275 @@
+/**
+ * @file Aggregate.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <Aggregate.h>
+#include <VectorMath.h>
+#include <ThreadPool.h>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Number of components read per block, each block is reduced apart then the blocks are combined in order.
+ */
+constexpr size_t blockSize = 4096;
+
+constexpr float infinity = numeric_limits<float>::infinity();
+
+/**
+ * Number of components read between the prefetch of a component and its reading.
+ */
+constexpr size_t prefetchDistance = 8;
+
+inline void prefetch(const void* address, size_t size) {
+#if defined(__GNUC__) || defined(__clang__)
+	for (size_t line = 0; line < size; line += 64) {
+		__builtin_prefetch(static_cast<const char*>(address) + line);
+	}
+#endif
+}
+
+size_t blocksOf(size_t n) {
+	return (n + blockSize - 1) / blockSize;
+}
+
+}
+
+Statistics Aggregate::statistics(ComponentManager& manager, const string& field, bool checkState) {
+	size_t typeID = scalarType(manager, field);
+	return reduce(gather(manager, nullptr, checkState), field, typeID);
+}
+
+Statistics Aggregate::statistics(ComponentManager& manager, const string& field, span<const int> entities, bool checkState) {
+	size_t typeID = scalarType(manager, field);
+	return reduce(gather(manager, &entities, checkState), field, typeID);
+}
+
+VectorStatistics Aggregate::vectorStatistics(ComponentManager& manager, const string& field, bool checkState) {
+	size_t typeID = manager.getTypeID(field);
+	if (typeID != typeToID("vector2") && typeID != typeToID("vector3")) {
+		throw runtime_error("Error : the data \"" + field + "\" of \"" + manager.getName() + "\" is not a Vector2 or a Vector3.");
+	}
+	return reduceVectors(gather(manager, nullptr, checkState), field);
+}
+
+VectorStatistics Aggregate::vectorStatistics(ComponentManager& manager, const string& field, span<const int> entities, bool checkState) {
+	size_t typeID = manager.getTypeID(field);
+	if (typeID != typeToID("vector2") && typeID != typeToID("vector3")) {
+		throw runtime_error("Error : the data \"" + field + "\" of \"" + manager.getName() + "\" is not a Vector2 or a Vector3.");
+	}
+	return reduceVectors(gather(manager, &entities, checkState), field);
+}
+
+vector<size_t> Aggregate::histogram(ComponentManager& manager, const string& field, size_t bins, double min, double max, bool checkState) {
+	scalarType(manager, field);
+	if (bins == 0 || !(max > min)) throw runtime_error("Error : a histogram needs at least one bin and a range with max > min.");
+	return count(gather(manager, nullptr, checkState), field, bins, min, max);
+}
+
+vector<size_t> Aggregate::histogram(ComponentManager& manager, const string& field, size_t bins, double min, double max, span<const int> entities, bool checkState) {
+	scalarType(manager, field);
+	if (bins == 0 || !(max > min)) throw runtime_error("Error : a histogram needs at least one bin and a range with max > min.");
+	return count(gather(manager, &entities, checkState), field, bins, min, max);
+}
+
+vector<shared_ptr<Component>> Aggregate::gather(ComponentManager& manager, const span<const int>* entities, bool checkState) {
+	vector<shared_ptr<Component>> components;
+	scoped_lock lock(manager.mtx);
+	if (entities) {
+		components.reserve(entities->size());
+		for (int entity : *entities) {
+			auto found = manager.mapEC.find(entity);
+			if (found != manager.mapEC.end() && (found->second.second || !checkState)) components.push_back(found->second.first);
+		}
+	}
+	else {
+		components.reserve(manager.mapEC.size());
+		for (const auto& [_, value] : manager.mapEC) {
+			if (value.second || !checkState) components.push_back(value.first);
+		}
+	}
+	return components;
+}
+
+size_t Aggregate::scalarType(ComponentManager& manager, const string& field) {
+	size_t typeID = manager.getTypeID(field);
+	if (typeID != typeToID("int") && typeID != typeToID("float") && typeID != typeToID("bool")) {
+		throw runtime_error("Error : the data \"" + field + "\" of \"" + manager.getName() + "\" is not an int, a float or a bool.");
+	}
+	return typeID;
+}
+
+template<typename Read>
+void Aggregate::read(const vector<shared_ptr<Component>>& components, size_t begin, size_t end, const string& field, Read read) {
+	for (size_t i = begin; i < end; ++i) {
+		// The components are scattered in memory, the ones read next are prefetched. Their data are not: reaching them would lock the components twice.
+		if (i + prefetchDistance < end) prefetch(components[i + prefetchDistance].get(), sizeof(Component));
+		Component& component = *components[i];
+		scoped_lock lock(component.mtx);
+		auto found = component.dataMap.find(field);
+		if (found != component.dataMap.end()) read(found->second.second);
+	}
+}
+
+Statistics Aggregate::reduce(const vector<shared_ptr<Component>>& components, const string& field, size_t typeID) {
+	typedef struct Partial {
+		size_t count = 0;
+		double sum = 0.0;
+		double min = infinity;
+		double max = -infinity;
+	} Partial;
+
+	bool isFloat = typeID == typeToID("float");
+	vector<Partial> partials(blocksOf(components.size()));
+	ThreadPool::global().parallelFor(partials.size(), [&](size_t first, size_t last) {
+		vector<float> column(blockSize);
+		for (size_t block = first; block < last; ++block) {
+			size_t begin = block * blockSize;
+			size_t end = std::min(begin + blockSize, components.size());
+			Partial& partial = partials[block];
+
+			if (isFloat) {
+				// The floats are gathered in a column for the SIMD reduction.
+				size_t n = 0;
+				read(components, begin, end, field, [&](const variant<ECS_Types>& value) {
+					if (const float* f = get_if<float>(&value)) column[n++] = *f;
+				});
+				FloatReduction reduction = VectorMath::reduce({ column.data(), n });
+				partial = { n, reduction.sum, reduction.min, reduction.max };
+				continue;
+			}
+
+			int64_t sum = 0;
+			int64_t min = numeric_limits<int64_t>::max();
+			int64_t max = numeric_limits<int64_t>::min();
+			read(components, begin, end, field, [&](const variant<ECS_Types>& value) {
+				int64_t v;
+				if (const int* i = get_if<int>(&value)) v = *i;
+				else if (const bool* b = get_if<bool>(&value)) v = *b;
+				else return;
+				sum += v;
+				min = std::min(min, v);
+				max = std::max(max, v);
+				++partial.count;
+			});
+			if (partial.count) partial = { partial.count, static_cast<double>(sum), static_cast<double>(min), static_cast<double>(max) };
+		}
+	}, 1);
+
+	Statistics statistics;
+	double min = infinity, max = -infinity;
+	for (const Partial& partial : partials) {
+		statistics.count += partial.count;
+		statistics.sum += partial.sum;
+		min = std::min(min, partial.min);
+		max = std::max(max, partial.max);
+	}
+	if (statistics.count) {
+		// Only NaN values leave the bounds infinite.
+		statistics.min = min == infinity ? nan("") : min;
+		statistics.max = max == -infinity ? nan("") : max;
+		statistics.mean = statistics.sum / statistics.count;
+	}
+	return statistics;
+}
+
+VectorStatistics Aggregate::reduceVectors(const vector<shared_ptr<Component>>& components, const string& field) {
+	typedef struct Partial {
+		size_t count = 0;
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		float min[3] = { infinity, infinity, infinity };
+		float max[3] = { -infinity, -infinity, -infinity };
+	} Partial;
+
+	vector<Partial> partials(blocksOf(components.size()));
+	ThreadPool::global().parallelFor(partials.size(), [&](size_t first, size_t last) {
+		vector<float> columns[3] = { vector<float>(blockSize), vector<float>(blockSize), vector<float>(blockSize) };
+		for (size_t block = first; block < last; ++block) {
+			size_t begin = block * blockSize;
+			size_t end = std::min(begin + blockSize, components.size());
+
+			size_t n = 0;
+			read(components, begin, end, field, [&](const variant<ECS_Types>& value) {
+				if (const Vector3* v = get_if<Vector3>(&value)) {
+					columns[0][n] = v->x;
+					columns[1][n] = v->y;
+					columns[2][n++] = v->z;
+				}
+				else if (const Vector2* v = get_if<Vector2>(&value)) {
+					columns[0][n] = v->x;
+					columns[1][n] = v->y;
+					columns[2][n++] = 0.0f;
+				}
+			});
+
+			Partial& partial = partials[block];
+			partial.count = n;
+			for (size_t axis = 0; axis < 3; ++axis) {
+				FloatReduction reduction = VectorMath::reduce({ columns[axis].data(), n });
+				partial.sum[axis] = reduction.sum;
+				partial.min[axis] = reduction.min;
+				partial.max[axis] = reduction.max;
+			}
+		}
+	}, 1);
+
+	size_t count = 0;
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	float min[3] = { infinity, infinity, infinity };
+	float max[3] = { -infinity, -infinity, -infinity };
+	for (const Partial& partial : partials) {
+		count += partial.count;
+		for (size_t axis = 0; axis < 3; ++axis) {
+			sum[axis] += partial.sum[axis];
+			min[axis] = std::min(min[axis], partial.min[axis]);
+			max[axis] = std::max(max[axis], partial.max[axis]);
+		}
+	}
+
+	VectorStatistics statistics;
+	if (count == 0) return statistics;
+	statistics.count = count;
+	statistics.sum = { static_cast<float>(sum[0]), static_cast<float>(sum[1]), static_cast<float>(sum[2]) };
+	statistics.min = { min[0], min[1], min[2] };
+	statistics.max = { max[0], max[1], max[2] };
+	statistics.mean = { static_cast<float>(sum[0] / count), static_cast<float>(sum[1] / count), static_cast<float>(sum[2] / count) };
+	return statistics;
+}
+
+vector<size_t> Aggregate::count(const vector<shared_ptr<Component>>& components, const string& field, size_t bins, double min, double max) {
+	vector<vector<size_t>> partials(blocksOf(components.size()));
+	double scale = bins / (max - min);
+	ThreadPool::global().parallelFor(partials.size(), [&](size_t first, size_t last) {
+		for (size_t block = first; block < last; ++block) {
+			size_t begin = block * blockSize;
+			size_t end = std::min(begin + blockSize, components.size());
+			vector<size_t>& counts = partials[block];
+			counts.assign(bins, 0);
+
+			read(components, begin, end, field, [&](const variant<ECS_Types>& value) {
+				double v;
+				if (const float* f = get_if<float>(&value)) v = *f;
+				else if (const int* i = get_if<int>(&value)) v = *i;
+				else if (const bool* b = get_if<bool>(&value)) v = *b;
+				else return;
+				if (!(v >= min && v <= max)) return;
+				size_t bin = static_cast<size_t>((v - min) * scale);
+				++counts[std::min(bin, bins - 1)];
+			});
+		}
+	}, 1);
+
+	vector<size_t> histogram(bins, 0);
+	for (const vector<size_t>& counts : partials) {
+		for (size_t bin = 0; bin < bins; ++bin) {
+			histogram[bin] += counts[bin];
+		}
+	}
+	return histogram;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file ChangeTracker.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <ChangeTracker.h>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Below this number of changes, the log is not worth compacting.
+ */
+constexpr size_t minCompaction = 1024;
+
+}
+
+ChangeTracker::ChangeTracker(shared_ptr<ComponentManager> manager) : manager(manager) {
+	if (!manager) throw runtime_error("Error : a change tracker needs a manager.");
+
+	scoped_lock managerLock(manager->mtx);
+	scoped_lock lock(mtx);
+	ticks.reserve(manager->mapEC.size());
+	log.reserve(manager->mapEC.size());
+	for (const auto& [entity, _] : manager->mapEC) {
+		bump(entity);
+	}
+}
+
+uint64_t ChangeTracker::getTick() {
+	scoped_lock lock(mtx);
+	return tick;
+}
+
+uint64_t ChangeTracker::getTick(int entity) {
+	scoped_lock lock(mtx);
+	auto found = ticks.find(entity);
+	return found == ticks.end() ? 0 : found->second;
+}
+
+vector<int> ChangeTracker::changedSince(uint64_t& since) {
+	scoped_lock lock(mtx);
+	vector<int> changed;
+	auto first = upper_bound(log.begin(), log.end(), since, [](uint64_t tick, const pair<uint64_t, int>& change) {
+		return tick < change.first;
+	});
+	for (auto change = first; change != log.end(); ++change) {
+		// Only the last change of an entity is current, the entity is returned once.
+		auto found = ticks.find(change->second);
+		if (found != ticks.end() && found->second == change->first) changed.push_back(change->second);
+	}
+	since = tick;
+	return changed;
+}
+
+void ChangeTracker::touch(int entity) {
+	scoped_lock lock(mtx);
+	if (ticks.contains(entity)) bump(entity);
+}
+
+shared_ptr<ComponentManager> ChangeTracker::getManager() {
+	return manager.lock();
+}
+
+void ChangeTracker::onSubscribe(ComponentManager& manager, int entity) {
+	scoped_lock lock(mtx);
+	bump(entity);
+}
+
+void ChangeTracker::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	scoped_lock lock(mtx);
+	ticks.erase(entity);
+}
+
+void ChangeTracker::afterSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	scoped_lock lock(mtx);
+	if (ticks.contains(entity)) bump(entity);
+}
+
+void ChangeTracker::bump(int entity) {
+	ticks[entity] = ++tick;
+	log.push_back({ tick, entity });
+	compact();
+}
+
+void ChangeTracker::compact() {
+	if (log.size() < minCompaction || log.size() < 2 * ticks.size()) return;
+
+	// The current changes stay in order of tick.
+	erase_if(log, [this](const pair<uint64_t, int>& change) {
+		auto found = ticks.find(change.second);
+		return found == ticks.end() || found->second != change.first;
+	});
+}
@@ -1,4 +1,5 @@
 #include "Component.h"
+#include "ComponentManager.h"
 
 using namespace std;
 
@@ -49,6 +50,12 @@ const string& Component::getType(const string& name) {
 	return dataMap[name].first;
 }
 
+size_t Component::getTypeID(const string& name) {
+	auto found = dataMap.find(name);
+	if (found == dataMap.end()) return variant_npos;
+	return valueTypeID(found->second.second);
+}
+
 vector<string> Component::getNames() {
 	vector<string> result;
 
@@ -62,6 +69,18 @@ const dataUnMap& Component::getRawData() {
 	return dataMap;
 }
 
+dataUnMap Component::copyRawData() {
+	scoped_lock lock(mtx);
+	return dataMap;
+}
+
+optional<variant<ECS_Types>> Component::copyValue(const string& name) {
+	scoped_lock lock(mtx);
+	auto it = dataMap.find(name);
+	if (it == dataMap.end()) return nullopt;
+	return it->second.second;
+}
+
 void Component::toString(ostream& stream) {
 	stringstream ss;
 	ss << this->getName() << ":" << endl;
@@ -77,4 +96,17 @@ void Component::toString(ostream& stream) {
 
 void Component::add(const string& name, const string& type) {
 	dataMap.insert({ name, {type, strToType(type)} });
+}
+
+void Component::beforeSet(const string& name) {
+	// Read once, the component can be detached meanwhile by another thread.
+	ComponentManager* owner = manager;
+	int owned = entity;
+	if (owner && owned >= 0) owner->beforeSet(owned, *this, name);
+}
+
+void Component::afterSet(const string& name) {
+	ComponentManager* owner = manager;
+	int owned = entity;
+	if (owner && owned >= 0) owner->afterSet(owned, *this, name);
 }
\ No newline at end of file
@@ -15,50 +15,222 @@ const string& ComponentManager::getName() {
 	return referenceComp->getName();
 }
 
+shared_ptr<Component> ComponentManager::getReference() {
+	return referenceComp;
+}
+
 const std::string& ComponentManager::getType(const string& data) {
 	return referenceComp->getType(data);
 }
 
+size_t ComponentManager::getTypeID(const string& data) {
+	return referenceComp->getTypeID(data);
+}
+
 void ComponentManager::subscribe(int entity) {
-	scoped_lock lock(mtx);
-	// Check if the entity is already subscribe, in which case we do nothing.
-	if (!mapEC.contains(entity)) {
-		shared_ptr<Component> component = make_shared<Component>();
-		component->copy(referenceComp);
-		mapEC.insert({ entity, {component, true} });
+	{
+		scoped_lock lock(mtx);
+		// Check if the entity is already subscribe, in which case we do nothing.
+		if (mapEC.contains(entity)) return;
+		mapEC.insert({ entity, {makeComponent(entity), true} });
+	}
+
+	shared_ptr<const listenerVector> current = getListeners();
+	for (const auto& listener : *current) {
+		listener->onSubscribe(*this, entity);
 	}
 }
 
 void ComponentManager::subscribe(int entity, dataVector data) {
-	this->subscribe(entity);
-	scoped_lock lock(mtx);
+	shared_ptr<Component> component;
+	{
+		scoped_lock lock(mtx);
+		if (mapEC.contains(entity)) component = mapEC[entity].first;
+	}
+
+	if (!component) {
+		// New component, filled before being linked so the listeners only see it complete.
+		component = make_shared<Component>();
+		component->copy(referenceComp);
+		for (const auto& [name, value] : data) {
+			component->set(name, value);
+		}
+
+		bool inserted = false;
+		{
+			scoped_lock lock(mtx);
+			if (!mapEC.contains(entity)) {
+				component->entity = entity;
+				component->manager = this;
+				mapEC.insert({ entity, {component, true} });
+				inserted = true;
+			}
+			else {
+				component = mapEC[entity].first; // Subscribed in the meantime by another thread.
+			}
+		}
+
+		if (inserted) {
+			shared_ptr<const listenerVector> current = getListeners();
+			for (const auto& listener : *current) {
+				listener->onSubscribe(*this, entity);
+			}
+			return;
+		}
+	}
+
+	for (const auto& [name, value] : data) {
+		component->set(name, value);
+	}
+}
+
+void ComponentManager::subscribe(const vector<int>& entities, const dataVector& data) {
+	vector<shared_ptr<Component>> existing;
+	vector<int> missing;
+	{
+		scoped_lock lock(mtx);
+		for (int entity : entities) {
+			auto it = mapEC.find(entity);
+			if (it != mapEC.end()) existing.push_back(it->second.first);
+			else missing.push_back(entity);
+		}
+	}
 
-	shared_ptr<Component> component = mapEC[entity].first;
+	// The new components are filled once, then copied for each entity, outside of the lock.
+	vector<int> inserted;
+	if (!missing.empty()) {
+		shared_ptr<Component> filled = make_shared<Component>();
+		filled->copy(referenceComp);
+		for (const auto& [name, value] : data) {
+			filled->set(name, value);
+		}
+
+		vector<shared_ptr<Component>> created;
+		created.reserve(missing.size());
+		for (size_t i = 0; i < missing.size(); ++i) {
+			shared_ptr<Component> component = make_shared<Component>();
+			component->copy(filled);
+			created.push_back(component);
+		}
+
+		scoped_lock lock(mtx);
+		mapEC.reserve(mapEC.size() + missing.size());
+		inserted.reserve(missing.size());
+		for (size_t i = 0; i < missing.size(); ++i) {
+			auto [it, isNew] = mapEC.try_emplace(missing[i], created[i], true);
+			if (isNew) {
+				created[i]->entity = missing[i];
+				created[i]->manager = this;
+				inserted.push_back(missing[i]);
+			}
+			else {
+				existing.push_back(it->second.first); // Subscribed in the meantime by another thread.
+			}
+		}
+	}
+
+	shared_ptr<const listenerVector> current = getListeners();
+	for (int entity : inserted) {
+		for (const auto& listener : *current) {
+			listener->onSubscribe(*this, entity);
+		}
+	}
+
+	for (const auto& component : existing) {
+		for (const auto& [name, value] : data) {
+			component->set(name, value);
+		}
+	}
+}
 
-	for (const auto& [name, data] : data) {
-		component->set(name, data);
+void ComponentManager::attach(int entity, shared_ptr<Component> component, bool state) {
+	shared_ptr<Component> replaced;
+	bool replacedState = false;
+	{
+		scoped_lock lock(mtx);
+		if (mapEC.contains(entity)) {
+			replaced = mapEC[entity].first;
+			replacedState = mapEC[entity].second;
+		}
+		component->entity = entity;
+		component->manager = this;
+		mapEC[entity] = { component, state };
+	}
+
+	shared_ptr<const listenerVector> current = getListeners();
+	if (replaced && replaced != component) {
+		replaced->manager = nullptr;
+		replaced->entity = -1;
+		for (const auto& listener : *current) {
+			listener->onUnsubscribe(*this, entity, replaced, replacedState);
+		}
+	}
+	for (const auto& listener : *current) {
+		listener->onSubscribe(*this, entity);
 	}
 }
 
 void ComponentManager::unsubscribe(int entity) {
-	scoped_lock lock(mtx);
-	mapEC.erase(entity); // Remove the entity, do nothing if entity is not in mapEC.
+	shared_ptr<Component> component;
+	bool state = false;
+	{
+		scoped_lock lock(mtx);
+		auto it = mapEC.find(entity);
+		if (it == mapEC.end()) return; // Do nothing if entity is not in mapEC.
+		component = it->second.first;
+		state = it->second.second;
+		mapEC.erase(it);
+	}
+
+	// The component is free again, its writes are not tracked anymore.
+	component->manager = nullptr;
+	component->entity = -1;
+
+	shared_ptr<const listenerVector> current = getListeners();
+	for (const auto& listener : *current) {
+		listener->onUnsubscribe(*this, entity, component, state);
+	}
+}
+
+void ComponentManager::unsubscribe(const vector<int>& entities) {
+	vector<pair<int, pair<shared_ptr<Component>, bool>>> removed;
+	{
+		scoped_lock lock(mtx);
+		removed.reserve(entities.size());
+		for (int entity : entities) {
+			auto it = mapEC.find(entity);
+			if (it == mapEC.end()) continue;
+			removed.push_back({ entity, it->second });
+			mapEC.erase(it);
+		}
+	}
+
+	shared_ptr<const listenerVector> current = getListeners();
+	for (const auto& [entity, value] : removed) {
+		value.first->manager = nullptr;
+		value.first->entity = -1;
+		for (const auto& listener : *current) {
+			listener->onUnsubscribe(*this, entity, value.first, value.second);
+		}
+	}
 }
 
 vector<int> ComponentManager::getEntities(bool checkState) {
+	scoped_lock lock(mtx);
 	vector<int> subscribedEntities;
+	subscribedEntities.reserve(mapEC.size());
 
 	// We gathered all the keys of the mapEC
-	if (mapEC.empty()) {
-		for (const auto& [key, _] : mapEC) {
-			if (mapEC[key].second || checkState) subscribedEntities.push_back(key); // Append the key according to checkState
-		}
+	for (const auto& [key, value] : mapEC) {
+		if (value.second || !checkState) subscribedEntities.push_back(key); // Append the key according to checkState
 	}
 	return subscribedEntities;
 }
 
 shared_ptr<Component> ComponentManager::getComponent(int entity) {
-	if (!this->hasEntity(entity)) {
+	scoped_lock lock(mtx);
+	// The state is not checked, an inactive component can still be read or restored.
+	if (!mapEC.contains(entity)) {
 		throw runtime_error("Error : The entity " + to_string(entity) + " is not subscribed to the " + referenceComp->getName() + "'s ComponentManager.");
 	}
 	return mapEC[entity].first;
@@ -79,19 +251,62 @@ bool ComponentManager::getState(int entity) {
 }
 
 void ComponentManager::setState(int entity, bool newState) {
-	scoped_lock lock(mtx);
-	if (mapEC.contains(entity)) {
+	{
+		scoped_lock lock(mtx);
+		if (!mapEC.contains(entity) || mapEC[entity].second == newState) return;
 		mapEC[entity].second = newState;
 	}
+
+	shared_ptr<const listenerVector> current = getListeners();
+	for (const auto& listener : *current) {
+		listener->onStateChange(*this, entity, !newState);
+	}
+}
+
+void ComponentManager::setState(const vector<int>& entities, bool newState) {
+	vector<int> changed;
+	{
+		scoped_lock lock(mtx);
+		changed.reserve(entities.size());
+		for (int entity : entities) {
+			auto it = mapEC.find(entity);
+			if (it == mapEC.end() || it->second.second == newState) continue;
+			it->second.second = newState;
+			changed.push_back(entity);
+		}
+	}
+
+	shared_ptr<const listenerVector> current = getListeners();
+	for (int entity : changed) {
+		for (const auto& listener : *current) {
+			listener->onStateChange(*this, entity, !newState);
+		}
+	}
 }
 
 void ComponentManager::give(int giver, int receiver, bool copy) {
-	scoped_lock lock(mtx);
-	if (!mapEC.contains(giver)) return; // Giver do not exist, do nothing.
-	mapEC[receiver] = mapEC[giver]; // Set both the component and state to the receiver.
-	if (!copy) {
-		mapEC.erase(giver); // Erase the giver if its not a copy.
+	if (giver == receiver) return;
+
+	shared_ptr<Component> given;
+	bool state = false;
+	{
+		scoped_lock lock(mtx);
+		if (!mapEC.contains(giver)) return; // Giver do not exist, do nothing.
+		given = mapEC[giver].first;
+		state = mapEC[giver].second;
+	}
+
+	if (copy) {
+		// A real copy, the receiver must not share its data with the giver.
+		shared_ptr<Component> component = make_shared<Component>();
+		component->copy(given);
+		given = component;
+	}
+	else {
+		this->unsubscribe(giver); // Erase the giver if its not a copy.
 	}
+
+	this->attach(receiver, given, state); // Set both the component and state to the receiver.
 }
 
 void ComponentManager::toString(ostream& stream) {
@@ -105,4 +320,71 @@ void ComponentManager::toString(ostream& stream) {
 	}
 
 	stream << ss.str();
+}
+
+void ComponentManager::reshape(shared_ptr<Component> reference) {
+	const dataUnMap& layout = reference->getRawData();
+
+	auto reshapeComponent = [&layout](Component& component) {
+		scoped_lock lock(component.mtx);
+		erase_if(component.dataMap, [&layout](const auto& data) { return !layout.contains(data.first); });
+
+		for (const auto& [name, value] : layout) {
+			auto it = component.dataMap.find(name);
+			if (it == component.dataMap.end() || valueTypeID(it->second.second) != valueTypeID(value.second)) {
+				component.dataMap[name] = value; // New data, or new type.
+			}
+			else {
+				it->second.first = value.first; // Same type under another name (e.g.: "int" and "integer").
+			}
+		}
+	};
+
+	scoped_lock lock(mtx);
+	reshapeComponent(*referenceComp);
+	for (auto& [_, value] : mapEC) {
+		reshapeComponent(*value.first);
+	}
+}
+
+void ComponentManager::addListener(shared_ptr<ComponentListener> listener) {
+	scoped_lock lock(mtx);
+	listenerVector copy = *listeners.load();
+	if (find(copy.begin(), copy.end(), listener) == copy.end()) {
+		copy.push_back(listener);
+		listeners.store(make_shared<const listenerVector>(std::move(copy)));
+	}
+}
+
+void ComponentManager::removeListener(shared_ptr<ComponentListener> listener) {
+	scoped_lock lock(mtx);
+	listenerVector copy = *listeners.load();
+	erase(copy, listener);
+	listeners.store(make_shared<const listenerVector>(std::move(copy)));
+}
+
+void ComponentManager::beforeSet(int entity, Component& component, const string& name) {
+	shared_ptr<const listenerVector> current = getListeners();
+	for (const auto& listener : *current) {
+		listener->beforeSet(*this, entity, component, name);
+	}
+}
+
+void ComponentManager::afterSet(int entity, Component& component, const string& name) {
+	shared_ptr<const listenerVector> current = getListeners();
+	for (const auto& listener : *current) {
+		listener->afterSet(*this, entity, component, name);
+	}
+}
+
+shared_ptr<const ComponentManager::listenerVector> ComponentManager::getListeners() {
+	return listeners.load();
+}
+
+shared_ptr<Component> ComponentManager::makeComponent(int entity) {
+	shared_ptr<Component> component = make_shared<Component>();
+	component->copy(referenceComp);
+	component->entity = entity;
+	component->manager = this;
+	return component;
 }
\ No newline at end of file
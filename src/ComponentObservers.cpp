@@ -0,0 +1,118 @@
+/**
+ * @file ComponentObservers.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <ComponentObservers.h>
+
+using namespace std;
+
+ComponentObservers::ComponentObservers(shared_ptr<ComponentManager> manager) : manager(manager), observers(make_shared<const vector<Observer>>()) {
+	if (!manager) throw runtime_error("Error : the observers need a manager.");
+}
+
+size_t ComponentObservers::observe(ComponentEvent event, ComponentObserver observer) {
+	scoped_lock lock(mtx);
+	vector<Observer> copy = *observers;
+	copy.push_back({ nextID, event, std::move(observer) });
+	observers = make_shared<const vector<Observer>>(std::move(copy));
+	return nextID++;
+}
+
+void ComponentObservers::unobserve(size_t ID) {
+	scoped_lock lock(mtx);
+	vector<Observer> copy = *observers;
+	erase_if(copy, [ID](const Observer& observer) {
+		return observer.ID == ID;
+	});
+	observers = make_shared<const vector<Observer>>(std::move(copy));
+}
+
+size_t ComponentObservers::size() {
+	scoped_lock lock(mtx);
+	return observers->size();
+}
+
+void ComponentObservers::flush() {
+	vector<pair<int, uint8_t>> flushed;
+	shared_ptr<const vector<Observer>> current;
+	{
+		scoped_lock lock(mtx);
+		flushed.swap(events);
+		positions.clear();
+		current = observers;
+	}
+	if (flushed.empty() || current->empty()) return;
+
+	// One batch per event, in the order they are given.
+	constexpr pair<ComponentEvent, uint8_t> kinds[] = { { ComponentEvent::Remove, Removed }, { ComponentEvent::Add, Added }, { ComponentEvent::Set, Written }, { ComponentEvent::StateChange, Switched } };
+	vector<int> batch;
+	batch.reserve(flushed.size());
+	for (const auto& [event, bit] : kinds) {
+		batch.clear();
+		for (const auto& [entity, bits] : flushed) {
+			if (bits & bit) batch.push_back(entity);
+		}
+		if (batch.empty()) continue;
+
+		for (const Observer& observer : *current) {
+			if (observer.event == event) observer.function(batch);
+		}
+	}
+}
+
+void ComponentObservers::touch(int entity) {
+	shared_ptr<ComponentManager> manager = this->manager.lock();
+	if (!manager || !manager->hasEntity(entity, true)) return;
+
+	scoped_lock lock(mtx);
+	add(entity, ComponentEvent::Set);
+}
+
+shared_ptr<ComponentManager> ComponentObservers::getManager() {
+	return manager.lock();
+}
+
+void ComponentObservers::onSubscribe(ComponentManager& manager, int entity) {
+	scoped_lock lock(mtx);
+	add(entity, ComponentEvent::Add);
+}
+
+void ComponentObservers::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	scoped_lock lock(mtx);
+	add(entity, ComponentEvent::Remove);
+}
+
+void ComponentObservers::onStateChange(ComponentManager& manager, int entity, bool oldState) {
+	scoped_lock lock(mtx);
+	add(entity, ComponentEvent::StateChange);
+}
+
+void ComponentObservers::afterSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	scoped_lock lock(mtx);
+	add(entity, ComponentEvent::Set);
+}
+
+void ComponentObservers::add(int entity, ComponentEvent event) {
+	auto [position, inserted] = positions.try_emplace(entity, events.size());
+	if (inserted) events.push_back({ entity, 0 });
+	uint8_t& bits = events[position->second].second;
+
+	switch (event) {
+	case ComponentEvent::Add:
+		bits |= Added;
+		break;
+	case ComponentEvent::Remove:
+		// Added in this batch, the entity was never seen by the observers (unless it was there before and removed first).
+		bits = (bits & Added) ? (bits & Removed) : Removed;
+		break;
+	case ComponentEvent::Set:
+		if (!(bits & (Added | Removed))) bits |= Written;
+		break;
+	case ComponentEvent::StateChange:
+		if (!(bits & (Added | Removed))) bits |= Switched;
+		break;
+	}
+}
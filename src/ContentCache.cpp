@@ -0,0 +1,313 @@
+#include "ContentCache.h"
+#include "Environment.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const char cacheMagic[4] = { 'T', 'M', 'C', 'C' };
+	const uint32_t cacheVersion = 1;
+
+	// Magic, version, sources' hash and content's checksum.
+	const size_t headerSize = 4 + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+	// Read only stream buffer over the mapped image, to use the binary helpers without copying it.
+	class MemoryBuffer : public streambuf {
+	public:
+		MemoryBuffer(const char* data, size_t size) {
+			char* begin = const_cast<char*>(data);
+			setg(begin, begin, begin + size);
+		}
+	};
+
+	// Index of each string in the table, filled while the image is written.
+	class StringTable {
+	public:
+		uint32_t get(const string& str) {
+			auto [it, inserted] = indexes.try_emplace(str, static_cast<uint32_t>(strings.size()));
+			if (inserted) strings.push_back(str);
+			return it->second;
+		}
+
+		void write(ostream& stream) {
+			writeBinary<uint32_t>(stream, static_cast<uint32_t>(strings.size()));
+			for (const auto& str : strings) {
+				stringToBinary(stream, str);
+			}
+		}
+
+	private:
+		unordered_map<string, uint32_t> indexes;
+		vector<string> strings;
+	};
+}
+
+ContentCache::ContentCache(const string& path) : data(nullptr), size(0), fileHandle(nullptr), mappingHandle(nullptr) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) return;
+	mappingHandle = mapping;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) return;
+	data = static_cast<const char*>(view);
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file == -1) return;
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+		void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			data = static_cast<const char*>(view);
+			size = static_cast<size_t>(fileStat.st_size);
+		}
+	}
+	close(file); // The mapping stays valid without the descriptor.
+#endif
+}
+
+ContentCache::~ContentCache() {
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+#else
+	if (data) munmap(const_cast<char*>(data), size);
+#endif
+}
+
+bool ContentCache::isValid(uint64_t sourcesHash) {
+	if (!data || size < headerSize) return false;
+
+	MemoryBuffer buffer(data, headerSize);
+	istream header(&buffer);
+
+	char magic[4];
+	header.read(magic, 4);
+	if (!equal(magic, magic + 4, cacheMagic)) return false;
+	if (readBinary<uint32_t>(header) != cacheVersion) return false;
+	if (readBinary<uint64_t>(header) != sourcesHash) return false;
+
+	// A cut or corrupted image is never loaded.
+	uint64_t checksum = readBinary<uint64_t>(header);
+	return hashBytes(data + headerSize, size - headerSize) == checksum;
+}
+
+void ContentCache::load(Environment& environment, const string& subscriptionsPath) {
+	MemoryBuffer buffer(data + headerSize, size - headerSize);
+	istream image(&buffer);
+
+	vector<string> strings(readBinary<uint32_t>(image));
+	for (auto& str : strings) {
+		str = binaryToString(image);
+	}
+	auto getString = [&strings](uint32_t index) -> const string& {
+		if (index >= strings.size()) throw runtime_error("Error : invalid string index in the content cache.");
+		return strings[index];
+	};
+
+	// Entities, in the order of their IDs so they get the same ones.
+	shared_ptr<EntityManager> entityManager = environment.entityManager;
+	uint32_t nbEntities = readBinary<uint32_t>(image);
+	for (uint32_t i = 0; i < nbEntities; ++i) {
+		int ID = entityManager->createEntity(getString(readBinary<uint32_t>(image)));
+
+		uint32_t nbTags = readBinary<uint32_t>(image);
+		for (uint32_t j = 0; j < nbTags; ++j) {
+			entityManager->addTag(ID, getString(readBinary<uint32_t>(image)));
+		}
+	}
+
+	// Components, then the subscriptions of each one.
+	uint32_t nbManagers = readBinary<uint32_t>(image);
+	for (uint32_t i = 0; i < nbManagers; ++i) {
+		const string& name = getString(readBinary<uint32_t>(image));
+
+		dataUnMap dataMap;
+		uint32_t nbData = readBinary<uint32_t>(image);
+		for (uint32_t j = 0; j < nbData; ++j) {
+			const string& key = getString(readBinary<uint32_t>(image));
+			const string& type = getString(readBinary<uint32_t>(image));
+			dataMap.insert({ key, { type, binaryToValue(image) } });
+		}
+
+		shared_ptr<ComponentManager> manager = make_shared<ComponentManager>(make_shared<Component>(name, dataMap));
+
+		uint32_t nbSubscribed = readBinary<uint32_t>(image);
+		for (uint32_t j = 0; j < nbSubscribed; ++j) {
+			int entity = readBinary<int32_t>(image);
+			bool state = readBinary<uint8_t>(image) != 0;
+
+			dataVector values;
+			uint32_t nbValues = readBinary<uint32_t>(image);
+			for (uint32_t k = 0; k < nbValues; ++k) {
+				const string& key = getString(readBinary<uint32_t>(image));
+				values.emplace_back(key, binaryToValue(image));
+			}
+
+			manager->subscribe(entity, values);
+			if (!state) manager->setState(entity, false);
+		}
+
+		environment.addManager(manager);
+	}
+
+	// Subscriptions' files of the entities, to save them back in it.
+	unordered_map<string, string> files;
+	uint32_t nbFiles = readBinary<uint32_t>(image);
+	for (uint32_t i = 0; i < nbFiles; ++i) {
+		const string& entity = getString(readBinary<uint32_t>(image));
+		files[entity] = getString(readBinary<uint32_t>(image));
+	}
+
+	environment.subscription = make_shared<Subscription>(subscriptionsPath, entityManager, make_shared<unorMapCM>(environment.mapNC), move(files));
+}
+
+uint64_t ContentCache::hashSources(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath) {
+	uint64_t hash = hashBytes(nullptr, 0);
+
+	for (const auto& directory : { entitiesPath, componentsPath, subscriptionsPath }) {
+		vector<string> files = getAllFilesFromDirectory(directory);
+
+		// Each file is hashed on its own, then the hashes are combined in the files' order.
+		vector<uint64_t> hashes(files.size());
+		ThreadPool::global().parallelFor(files.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				ifstream file(files[i], ios::binary);
+				if (!file) {
+					throw runtime_error("Error : Can't read the file \"" + files[i] + "\"");
+				}
+				hashes[i] = hashBytes(files[i].data(), files[i].size());
+
+				// Read by chunks, the biggest files are never held at once.
+				char chunk[64 * 1024];
+				while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0) {
+					hashes[i] = hashBytes(chunk, static_cast<size_t>(file.gcount()), hashes[i]);
+				}
+			}
+		});
+
+		// The number of files splits the directories, moving a file from one to another changes the hash.
+		uint64_t nbFiles = files.size();
+		hash = hashBytes(reinterpret_cast<const char*>(&nbFiles), sizeof(nbFiles), hash);
+		for (uint64_t fileHash : hashes) {
+			hash = hashBytes(reinterpret_cast<const char*>(&fileHash), sizeof(fileHash), hash);
+		}
+	}
+
+	return hash;
+}
+
+void ContentCache::write(Environment& environment, uint64_t sourcesHash, const string& path) {
+	shared_ptr<EntityManager> entityManager = environment.entityManager;
+	StringTable strings;
+	ostringstream content;
+
+	// Entities, in the order of their IDs.
+	vector<pair<int, string>> entities;
+	for (const auto& name : entityManager->getNames()) {
+		entities.emplace_back(entityManager->getEntity(name), name);
+	}
+	sort(entities.begin(), entities.end());
+
+	writeBinary<uint32_t>(content, static_cast<uint32_t>(entities.size()));
+	for (const auto& [ID, name] : entities) {
+		writeBinary<uint32_t>(content, strings.get(name));
+
+		vector<string> tags = entityManager->getTags(ID);
+		writeBinary<uint32_t>(content, static_cast<uint32_t>(tags.size()));
+		for (const auto& tag : tags) {
+			writeBinary<uint32_t>(content, strings.get(tag));
+		}
+	}
+
+	// Components, with their types and default values, then their subscriptions.
+	vector<shared_ptr<ComponentManager>> managers = environment.getManagers();
+	writeBinary<uint32_t>(content, static_cast<uint32_t>(managers.size()));
+	for (const auto& manager : managers) {
+		writeBinary<uint32_t>(content, strings.get(manager->getName()));
+
+		const dataUnMap& reference = manager->getReference()->getRawData();
+		writeBinary<uint32_t>(content, static_cast<uint32_t>(reference.size()));
+		for (const auto& [key, value] : reference) {
+			writeBinary<uint32_t>(content, strings.get(key));
+			writeBinary<uint32_t>(content, strings.get(value.first));
+			valueToBinary(content, value.second);
+		}
+
+		vector<int> subscribed = manager->getEntities(false);
+		writeBinary<uint32_t>(content, static_cast<uint32_t>(subscribed.size()));
+		for (int entity : subscribed) {
+			writeBinary<int32_t>(content, entity);
+			writeBinary<uint8_t>(content, manager->getState(entity) ? 1 : 0);
+
+			const dataUnMap& data = manager->getComponent(entity)->getRawData();
+			writeBinary<uint32_t>(content, static_cast<uint32_t>(data.size()));
+			for (const auto& [key, value] : data) {
+				writeBinary<uint32_t>(content, strings.get(key));
+				valueToBinary(content, value.second);
+			}
+		}
+	}
+
+	// Subscriptions' files of the entities.
+	unordered_map<string, string> files;
+	if (environment.subscription) files = environment.subscription->getFiles();
+	writeBinary<uint32_t>(content, static_cast<uint32_t>(files.size()));
+	for (const auto& [entity, file] : files) {
+		writeBinary<uint32_t>(content, strings.get(entity));
+		writeBinary<uint32_t>(content, strings.get(file));
+	}
+
+	// The table of strings goes first, it is needed to read the rest.
+	ostringstream body;
+	strings.write(body);
+	body << content.str();
+	string bodyBytes = body.str();
+
+	{
+		ofstream imageFile(path + ".tmp", ios::binary | ios::trunc);
+		if (!imageFile) {
+			throw runtime_error("Error : Can't write the file \"" + path + ".tmp\"");
+		}
+
+		imageFile.write(cacheMagic, 4);
+		writeBinary<uint32_t>(imageFile, cacheVersion);
+		writeBinary<uint64_t>(imageFile, sourcesHash);
+		writeBinary<uint64_t>(imageFile, hashBytes(bodyBytes.data(), bodyBytes.size()));
+		imageFile.write(bodyBytes.data(), bodyBytes.size());
+
+		if (!imageFile.flush()) {
+			throw runtime_error("Error : Can't write the file \"" + path + ".tmp\"");
+		}
+	}
+	filesystem::rename(path + ".tmp", path);
+}
+
+void ContentCache::compile(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath, const string& path) {
+	uint64_t sourcesHash = hashSources(entitiesPath, componentsPath, subscriptionsPath);
+
+	// Loaded directly, a broken source must not give an image.
+	Environment environment(make_shared<EntityManager>());
+	environment.loadFiles(entitiesPath, componentsPath, subscriptionsPath);
+
+	write(environment, sourcesHash, path);
+}
@@ -0,0 +1,209 @@
+/**
+ * @file CoroutineScheduler.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <CoroutineScheduler.h>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Order of the sleeping heap: the earliest wake up on top, then the first asleep.
+ */
+template<typename Sleeping>
+bool later(const Sleeping& a, const Sleeping& b) {
+	return a.wake != b.wake ? a.wake > b.wake : a.order > b.order;
+}
+
+}
+
+Task Task::promise_type::get_return_object() noexcept {
+	return Task(coroutine_handle<promise_type>::from_promise(*this));
+}
+
+Task::FinalAwaiter Task::promise_type::final_suspend() noexcept {
+	return {};
+}
+
+coroutine_handle<> Task::FinalAwaiter::await_suspend(coroutine_handle<promise_type> handle) noexcept {
+	// A nested task gives the hand back to the awaiting one, a started task waits for its scheduler.
+	coroutine_handle<> continuation = handle.promise().continuation;
+	return continuation ? continuation : noop_coroutine();
+}
+
+Task::Task(Task&& other) noexcept : handle(exchange(other.handle, nullptr)) {}
+
+Task& Task::operator=(Task&& other) noexcept {
+	if (this != &other) {
+		if (handle) handle.destroy();
+		handle = exchange(other.handle, nullptr);
+	}
+	return *this;
+}
+
+Task::~Task() {
+	if (handle) handle.destroy();
+}
+
+coroutine_handle<> Task::await_suspend(coroutine_handle<promise_type> awaiting) noexcept {
+	promise_type& promise = handle.promise();
+	promise.scheduler = awaiting.promise().scheduler;
+	promise.root = awaiting.promise().root;
+	promise.continuation = awaiting;
+	return handle;
+}
+
+void Task::await_resume() {
+	if (handle.promise().error) rethrow_exception(handle.promise().error);
+}
+
+void NextFrameAwaiter::await_suspend(coroutine_handle<Task::promise_type> handle) {
+	CoroutineScheduler& scheduler = *handle.promise().scheduler;
+	scheduler.nextFrames.push_back({ handle.promise().root, handle });
+}
+
+void SecondsAwaiter::await_suspend(coroutine_handle<Task::promise_type> handle) {
+	CoroutineScheduler& scheduler = *handle.promise().scheduler;
+	scheduler.sleeping.push_back({ scheduler.time + duration, scheduler.sleepOrder++, { handle.promise().root, handle } });
+	push_heap(scheduler.sleeping.begin(), scheduler.sleeping.end(), later<CoroutineScheduler::Sleeping>);
+}
+
+CoroutineScheduler::CoroutineScheduler(shared_ptr<Environment> environment) : environment(environment), nextID(0), sleepOrder(0), time(0.0) {
+	if (!environment) throw runtime_error("Error : the coroutine scheduler needs an environment.");
+	removals = make_shared<EntityRemovals>(*this);
+	environment->getEntityManager()->addListener(removals);
+}
+
+CoroutineScheduler::~CoroutineScheduler() {
+	environment->getEntityManager()->removeListener(removals);
+	for (const auto& [_, queue] : events) {
+		environment->getEventBus().unsubscribe(queue->subscription);
+	}
+	for (const auto& [_, root] : tasks) {
+		root.handle.destroy();
+	}
+}
+
+size_t CoroutineScheduler::start(Task task) {
+	return launch(std::move(task), 0, false);
+}
+
+size_t CoroutineScheduler::start(int entity, Task task) {
+	return launch(std::move(task), entity, true);
+}
+
+void CoroutineScheduler::cancel(size_t ID) {
+	if (!tasks.contains(ID)) return;
+	// A coroutine can't be destroyed while it runs.
+	if (find(running.begin(), running.end(), ID) != running.end()) {
+		if (find(cancelled.begin(), cancelled.end(), ID) == cancelled.end()) cancelled.push_back(ID);
+		return;
+	}
+	finish(ID);
+}
+
+void CoroutineScheduler::cancelEntity(int entity) {
+	auto found = entityTasks.find(entity);
+	if (found == entityTasks.end()) return;
+	vector<size_t> IDs = found->second;
+	for (size_t ID : IDs) {
+		cancel(ID);
+	}
+}
+
+void CoroutineScheduler::update(double elapsed) {
+	time += max(elapsed, 0.0);
+
+	batch.clear();
+	for (const auto& [_, queue] : events) {
+		queue->match(*this, batch);
+	}
+	while (!sleeping.empty() && sleeping.front().wake <= time) {
+		pop_heap(sleeping.begin(), sleeping.end(), later<Sleeping>);
+		batch.push_back(sleeping.back().waiting);
+		sleeping.pop_back();
+	}
+	// The tasks awaiting the next frame from now on wait for the next update.
+	batch.insert(batch.end(), nextFrames.begin(), nextFrames.end());
+	nextFrames.clear();
+
+	// By index, a resumed task can start another one, which doesn't touch the batch.
+	for (size_t i = 0; i < batch.size(); ++i) {
+		resume(batch[i]);
+	}
+	batch.clear();
+}
+
+size_t CoroutineScheduler::size() {
+	return tasks.size();
+}
+
+double CoroutineScheduler::getTime() {
+	return time;
+}
+
+void CoroutineScheduler::resume(const Waiting& waiting) {
+	// Cancelled while suspended.
+	auto found = tasks.find(waiting.root);
+	if (found == tasks.end()) return;
+	coroutine_handle<Task::promise_type> root = found->second.handle;
+
+	running.push_back(waiting.root);
+	waiting.handle.resume();
+	running.pop_back();
+
+	bool cancel = erase(cancelled, waiting.root) > 0;
+	if (root.done() || cancel) {
+		if (root.promise().error) {
+			try {
+				rethrow_exception(root.promise().error);
+			}
+			catch (exception& e) {
+				cerr << "CoroutineScheduler : " << e.what() << endl;
+			}
+			catch (...) {
+				cerr << "CoroutineScheduler : unknown error in a task." << endl;
+			}
+		}
+		finish(waiting.root);
+	}
+}
+
+void CoroutineScheduler::finish(size_t ID) {
+	auto found = tasks.find(ID);
+	if (found == tasks.end()) return;
+	Root root = found->second;
+	tasks.erase(found);
+
+	if (root.bound) {
+		auto bound = entityTasks.find(root.entity);
+		if (bound != entityTasks.end()) {
+			erase(bound->second, ID);
+			if (bound->second.empty()) entityTasks.erase(bound);
+		}
+	}
+	root.handle.destroy();
+}
+
+void CoroutineScheduler::EntityRemovals::onRemove(EntityManager& manager, int entity, const string& name) {
+	scheduler.cancelEntity(entity);
+}
+
+size_t CoroutineScheduler::launch(Task task, int entity, bool bound) {
+	if (!task.handle) throw runtime_error("Error : the task was already started.");
+
+	size_t ID = ++nextID;
+	coroutine_handle<Task::promise_type> handle = exchange(task.handle, nullptr);
+	handle.promise().scheduler = this;
+	handle.promise().root = ID;
+	// Bound before its first run, it can cancel its own entity.
+	tasks[ID] = { handle, entity, bound };
+	if (bound) entityTasks[entity].push_back(ID);
+	resume({ ID, handle });
+	return ID;
+}
@@ -3,61 +3,114 @@
 
 using namespace std;
 
-EntityManager::EntityManager() : directory(directory), count(-1), placeholder("") {
+EntityManager::EntityManager() : count(-1), placeholder("") {
 }
 
-EntityManager::EntityManager(const string& directory) : directory(directory), count(-1), placeholder("") {
+EntityManager::EntityManager(const string& directory, bool loadFiles) : directory(directory), count(-1), placeholder("") {
+	if (!loadFiles) return;
 
 	vector<string> files = getAllFilesFromDirectory(directory); // Return every files in the directory's folder and its sub-folders
 
-	for (const auto& file : files) {
-		ifstream entityFile(file);
+	// The files are read and parsed in parallel, then applied in their order so the IDs are always the same.
+	// The biggest ones are streamed instead, not to hold their whole content.
+	parsedFiles parsed = parseFiles(files, streamingFileSize);
 
-		if (!entityFile) {
-			throw runtime_error("Error : Can't read the file \"" + file + "\"");
-		}
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (parsed[i].second) rethrow_exception(parsed[i].second);
 
-		nlohmann::json entityJSON = nlohmann::json::parse(entityFile); // Parse the JSON of the entity's file
-		vector<string> namesVector;
-		if (entityJSON.contains("name")) {
-			namesVector.push_back(entityJSON["name"]);
-		}
-		else if (entityJSON.contains("names")) {
-			namesVector = entityJSON["names"];
-		}
-		else {
-			continue;
+		if (parsed[i].first.is_discarded()) this->stream(files[i]);
+		else this->load(parsed[i].first);
+	}
+}
+
+void EntityManager::load(const nlohmann::json& entityJSON) {
+	vector<string> namesVector;
+	if (entityJSON.contains("name")) {
+		namesVector.push_back(entityJSON["name"]);
+	}
+	else if (entityJSON.contains("names")) {
+		namesVector = entityJSON["names"];
+	}
+	else {
+		return;
+	}
+
+	vector<string> tags;
+	if (entityJSON.contains("tags")) {
+		tags = entityJSON["tags"];
+	}
+
+	for (const auto& name : namesVector) {
+		this->createEntities(name, entityJSON, tags);
+	}
+}
+
+void EntityManager::stream(const string& file) {
+	using event = nlohmann::json::parse_event_t;
+
+	ifstream entityFile(file);
+	if (!entityFile) {
+		throw runtime_error("Error : Can't read the file \"" + file + "\"");
+	}
+
+	// First pass, everything but the names, which can be too many to be held at once.
+	bool hasNames = false;
+	nlohmann::json header = nlohmann::json::parse(entityFile, [&hasNames](int depth, event type, nlohmann::json& parsed) {
+		if (type == event::key && depth == 1 && parsed == "names") {
+			hasNames = true;
+			return false;
 		}
+		return true;
+	});
+
+	// A single entity, nothing to stream.
+	if (header.contains("name") || !hasNames) {
+		this->load(header);
+		return;
+	}
+
+	vector<string> tags;
+	if (header.contains("tags")) {
+		tags = header["tags"];
+	}
 
-		vector<string> tags;
-		if (entityJSON.contains("tags")) {
-			tags = entityJSON["tags"];
+	// Second pass, each name is applied once parsed, then dropped.
+	entityFile.clear();
+	entityFile.seekg(0);
+	bool inNames = false;
+	std::ignore = nlohmann::json::parse(entityFile, [&](int depth, event type, nlohmann::json& parsed) {
+		if (type == event::key && depth == 1) {
+			inNames = parsed == "names";
+			return inNames;
 		}
+		if (inNames && type == event::value && depth == 2) {
+			this->createEntities(parsed.get<string>(), header, tags);
+			return false;
+		}
+		return true;
+	});
+}
 
-		for (const auto& name : namesVector) {
-			// Check if multiple entities should be generated
-			if (entityJSON.contains("generate")) {
-				int ID = -1;
-				for (int i = 0; i < entityJSON["generate"]; ++i) {
-					ID = this->createEntity(name + to_string(i));
-					if (ID != -1) {
-						for (const auto& tag : tags) {
-							this->addTag(ID, tag);
-						}
-					}
+void EntityManager::createEntities(const string& name, const nlohmann::json& entityJSON, const vector<string>& tags) {
+	// Check if multiple entities should be generated
+	if (entityJSON.contains("generate")) {
+		int ID = -1;
+		for (int i = 0; i < entityJSON["generate"]; ++i) {
+			ID = this->createEntity(name + to_string(i));
+			if (ID != -1) {
+				for (const auto& tag : tags) {
+					this->addTag(ID, tag);
 				}
 			}
-			else {
-				int ID = createEntity(name);
-				if (ID != -1) {
-					for (const auto& tag : tags) {
-						this->addTag(ID, tag);
-					}
-				}
+		}
+	}
+	else {
+		int ID = createEntity(name);
+		if (ID != -1) {
+			for (const auto& tag : tags) {
+				this->addTag(ID, tag);
 			}
 		}
-
-		entityFile.close();
 	}
 }
 
@@ -127,16 +180,24 @@ int EntityManager::createEntity(const string& name, bool createFile) {
 			ofstream newEntityFile(directory + "/" + name + ".json");
 			newEntityFile << newEntityJSON.dump(4);
 		}
+		int ID;
 		if (!availableIDs.empty()) {
-			entities.insert({ name, availableIDs.front() });
-			names[availableIDs.front()] = name;
+			ID = availableIDs.front();
+			entities.insert({ name, ID });
+			names[ID] = name;
 			availableIDs.pop(); // Removed the newly used IDs.
 		}
 		else {
 			names.push_back(name);
-			entities.insert({ name, ++count });
+			ID = ++count;
+			entities.insert({ name, ID });
 		}
-		return count;
+
+		shared_ptr<const vector<shared_ptr<EntityListener>>> current = listeners;
+		for (const auto& listener : *current) {
+			listener->onCreate(*this, ID, name);
+		}
+		return ID;
 	}
 	return -1; // No entity created.
 }
@@ -154,6 +215,11 @@ void EntityManager::removeEntity(const string& name) {
 
 	// Map of entities removal.
 	entities.erase(name);
+
+	shared_ptr<const vector<shared_ptr<EntityListener>>> current = listeners;
+	for (const auto& listener : *current) {
+		listener->onRemove(*this, ID, name);
+	}
 }
 
 void EntityManager::toString(ostream& stream) {
@@ -188,5 +254,33 @@ bool EntityManager::hasTag(int entity, const string& tag) {
 }
 
 void EntityManager::addTag(int entity, const string& tag) {
-	tags[tag].insert(entity);
+	if (!tags[tag].insert(entity).second) return; // Already tagged.
+
+	shared_ptr<const vector<shared_ptr<EntityListener>>> current = listeners;
+	for (const auto& listener : *current) {
+		listener->onTag(*this, entity, tag);
+	}
 }
+
+
+vector<string> EntityManager::getTags(int entity) {
+	vector<string> result;
+	for (const auto& [tag, list] : tags) {
+		if (list.contains(entity)) result.push_back(tag);
+	}
+	return result;
+}
+
+void EntityManager::addListener(shared_ptr<EntityListener> listener) {
+	if (find(listeners->begin(), listeners->end(), listener) == listeners->end()) {
+		vector<shared_ptr<EntityListener>> copy = *listeners;
+		copy.push_back(listener);
+		listeners = make_shared<const vector<shared_ptr<EntityListener>>>(std::move(copy));
+	}
+}
+
+void EntityManager::removeListener(shared_ptr<EntityListener> listener) {
+	vector<shared_ptr<EntityListener>> copy = *listeners;
+	erase(copy, listener);
+	listeners = make_shared<const vector<shared_ptr<EntityListener>>>(std::move(copy));
+}
\ No newline at end of file
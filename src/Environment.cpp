@@ -1,4 +1,5 @@
 #include "Environment.h"
+#include "System.h"
 
 using namespace std;
 
@@ -8,23 +9,117 @@ Environment::Environment(shared_ptr<EntityManager> entityManager) : entityManage
 
 Environment::Environment(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath) {
 	try {
-		entityManager = make_shared<EntityManager>(entitiesPath);
-
-		vector<string> files = getAllFilesFromDirectory(componentsPath); // Return every files in the directory's folder and its sub-folders
+		loadFiles(entitiesPath, componentsPath, subscriptionsPath);
+	}
+	catch (exception& e) {
+		cerr << "Environment : " << e.what() << endl;
+	}
+}
 
-		for (const auto& file : files) {
-			addManager(make_shared<ComponentManager>(file));
+Environment::Environment(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath, const string& cachePath) {
+	try {
+		uint64_t sourcesHash = ContentCache::hashSources(entitiesPath, componentsPath, subscriptionsPath);
+
+		{
+			ContentCache cache(cachePath);
+			if (cache.isValid(sourcesHash)) {
+				entityManager = make_shared<EntityManager>(entitiesPath, false);
+				cache.load(*this, subscriptionsPath);
+				return;
+			}
 		}
 
-		subscription = make_shared<Subscription>(subscriptionsPath, entityManager, make_shared<unorMapCM>(mapNC));
+		// Outdated or missing image, made again from the sources.
+		loadFiles(entitiesPath, componentsPath, subscriptionsPath);
+		ContentCache::write(*this, sourcesHash, cachePath);
 	}
 	catch (exception& e) {
 		cerr << "Environment : " << e.what() << endl;
 	}
 }
 
+void Environment::loadFiles(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath) {
+	entityManager = make_shared<EntityManager>(entitiesPath);
+	loadComponents(componentsPath);
+
+	subscription = make_shared<Subscription>(subscriptionsPath, entityManager, make_shared<unorMapCM>(mapNC));
+}
+
+void Environment::loadComponents(const string& componentsPath) {
+	vector<string> files = getAllFilesFromDirectory(componentsPath); // Return every files in the directory's folder and its sub-folders
+
+	// The managers are built in parallel, then added in the files' order.
+	vector<shared_ptr<ComponentManager>> managers(files.size());
+	vector<exception_ptr> errors(files.size());
+	ThreadPool::global().parallelFor(files.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			try {
+				managers[i] = make_shared<ComponentManager>(files[i]);
+			}
+			catch (...) {
+				errors[i] = current_exception();
+			}
+		}
+	});
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (errors[i]) rethrow_exception(errors[i]);
+		addManager(managers[i]);
+	}
+}
+
 void Environment::addManager(shared_ptr<ComponentManager> manager) {
 	mapNC.insert({manager->getName(), manager});
+	if (rollback) manager->addListener(rollback);
+	if (journal) manager->addListener(journal);
+	if (recorder) manager->addListener(recorder);
+	if (streamer) manager->addListener(streamer);
+	if (subscription) subscription->addManager(manager);
+}
+
+void Environment::removeManager(const string& name, bool share) {
+	if (!mapNC.contains(name)) return;
+	shared_ptr<ComponentManager> manager = mapNC[name];
+
+	// Unsubscribed while still listened, the journal and the recorder see the removals.
+	vector<int> entities = manager->getEntities(false);
+	for (int entity : entities) {
+		manager->unsubscribe(entity);
+	}
+
+	if (rollback) {
+		manager->removeListener(rollback);
+		// The records would keep the manager's address, it could not be rewound anymore.
+		rollback->forget(manager.get());
+	}
+	if (journal) manager->removeListener(journal);
+	if (recorder) manager->removeListener(recorder);
+	if (streamer) manager->removeListener(streamer);
+	for (const auto& index : spatialIndexes[name]) {
+		manager->removeListener(index);
+	}
+	spatialIndexes.erase(name);
+	for (const auto& index : valueIndexes[name]) {
+		manager->removeListener(index);
+	}
+	valueIndexes.erase(name);
+	if (changeTrackers.contains(name)) manager->removeListener(changeTrackers[name]);
+	changeTrackers.erase(name);
+	// The removals are given right away, the observers are dropped with the manager.
+	if (observers.contains(name)) {
+		shared_ptr<ComponentObservers> observed = observers[name];
+		observed->flush();
+		manager->removeListener(observed);
+		observers.erase(name);
+	}
+	mapNC.erase(name);
+	if (subscription) subscription->removeManager(name);
+
+	if (share) {
+		for (int entity : entities) {
+			notify(entity);
+		}
+	}
 }
 
 std::vector<std::shared_ptr<ComponentManager>> Environment::getManagers() {
@@ -38,7 +133,7 @@ std::vector<std::shared_ptr<ComponentManager>> Environment::getManagers() {
 }
 
 shared_ptr<ComponentManager> Environment::getManager(const string& name) {
-	if (!mapNC.contains(name)) {
+	if (mapNC.contains(name)) {
 		return mapNC[name];
 	}
 	return nullptr;
@@ -91,6 +186,19 @@ void Environment::setStates(const string& prefixOrTag, const string& compName, b
 	}
 }
 
+void Environment::setStates(const vector<int>& entities, const string& compName, bool state, bool share) {
+	auto found = mapNC.find(compName);
+	if (found == mapNC.end()) return;
+	shared_ptr<ComponentManager> manager = found->second;
+
+	manager->setState(entities, state);
+
+	if (!share) return;
+	for (int entity : entities) {
+		if (manager->hasEntity(entity, true)) notify(entity);
+	}
+}
+
 bool Environment::getState(int entity, const string& compName) {
 	if (!mapNC.contains(compName) || !mapNC[compName]->hasEntity(entity)) return false;
 	return mapNC[compName]->getState(entity);
@@ -130,6 +238,28 @@ void Environment::removeEntity(const string& name, bool share) {
 	if (share) notify(ID);
 }
 
+void Environment::removeEntities(const vector<int>& entities, bool share) {
+	vector<int> removed;
+	removed.reserve(entities.size());
+	for (int entity : entities) {
+		// Copied, the EntityManager forgets it. An unknown or already removed ID is skipped.
+		string name = entityManager->getName(entity);
+		if (name.empty() || entityManager->getEntity(name) != entity) continue;
+		entityManager->removeEntity(name);
+		removed.push_back(entity);
+	}
+	if (removed.empty()) return;
+
+	for (const auto& [_, manager] : mapNC) {
+		manager->unsubscribe(removed);
+	}
+
+	if (!share) return;
+	for (int entity : removed) {
+		notify(entity);
+	}
+}
+
 vector<shared_ptr<Component>> Environment::getComponents(int entity) {
 	vector<shared_ptr<Component>> result;
 
@@ -182,8 +312,7 @@ void Environment::addTag(int entity, const std::string& tag, bool share) {
 void Environment::addTag(const std::string& name, const std::string& tag, bool share) {
 	int ID = entityManager->getEntity(name);
 	if (ID == -1) return;
-	entityManager->addTag(ID, tag);
-	if (share) notify(ID);
+	this->addTag(ID, tag, share);
 }
 
 void Environment::save(int entity) {
@@ -195,6 +324,35 @@ void Environment::save(const string& name) {
 	this->save(ID);
 }
 
+void Environment::saveEntities(const vector<int>& entities, const string& file, bool compact) {
+	if (!subscription) {
+		throw runtime_error("Error : This environment has no subscriptions' directory to save in.");
+	}
+	subscription->save(entities, file, compact);
+}
+
+void Environment::saveAll(const string& file, bool compact) {
+	this->saveEntities(entityManager->getEntities(""), file, compact);
+}
+
+shared_future<void> Environment::saveAsync(int entity) {
+	if (!subscription) {
+		throw runtime_error("Error : This environment has no subscriptions' directory to save in.");
+	}
+	if (!persistence) persistence = make_shared<PersistenceService>();
+
+	return persistence->submit(subscription->capture(entity));
+}
+
+shared_future<void> Environment::saveAsync(const string& name) {
+	int ID = entityManager->getEntity(name);
+	return this->saveAsync(ID);
+}
+
+void Environment::flushSaves() {
+	if (persistence) persistence->flush();
+}
+
 void Environment::join(function<void(int)> callback, size_t ID) {
 	notifiers[ID] = callback;
 }
@@ -216,6 +374,10 @@ void Environment::notify(size_t ID) {
 	}
 }
 
+EventBus& Environment::getEventBus() {
+	return eventBus;
+}
+
 int Environment::copy(const string& original, const string& copy, bool createFile, bool share) {
 	int newEntity = this->createEntity(copy, createFile, false);
 	int ID = entityManager->getEntity(original);
@@ -308,3 +470,525 @@ void Environment::loadSnapshot(const string& snapshotName) {
 void Environment::clearSnapshot(const string& snapshotName) {
 	snapshots.erase(snapshotName);
 }
+
+
+void Environment::enableRollback(size_t frames, size_t memoryBudget) {
+	if (rollback) {
+		rollback->resize(frames, memoryBudget);
+		return;
+	}
+
+	rollback = make_shared<RollbackBuffer>(frames, memoryBudget);
+	for (const auto& [_, manager] : mapNC) {
+		manager->addListener(rollback);
+	}
+}
+
+void Environment::disableRollback() {
+	if (!rollback) return;
+
+	for (const auto& [_, manager] : mapNC) {
+		manager->removeListener(rollback);
+	}
+	rollback = nullptr;
+}
+
+size_t Environment::captureFrame() {
+	if (!rollback) return 0;
+	return rollback->captureFrame();
+}
+
+bool Environment::rewindTo(size_t frame, bool share) {
+	if (!rollback) return false;
+
+	unordered_set<int> touched;
+	if (!rollback->rewindTo(frame, touched)) return false;
+
+	// Only the structural changes (subscriptions and states) matter for the systems.
+	if (share) {
+		for (int entity : touched) {
+			notify(entity);
+		}
+	}
+	return true;
+}
+
+size_t Environment::getFrame() {
+	if (!rollback) return 0;
+	return rollback->getFrame();
+}
+
+bool Environment::enableJournal(const string& path, size_t checkpointSize, bool share) {
+	disableJournal();
+
+	// Recovered before listening, the replay must not be recorded again.
+	shared_ptr<Journal> newJournal = make_shared<Journal>(path, entityManager);
+	bool recovered = newJournal->recover(*this);
+
+	journal = newJournal;
+	this->checkpointSize = checkpointSize;
+	entityManager->addListener(journal);
+	for (const auto& [_, manager] : mapNC) {
+		manager->addListener(journal);
+	}
+	journal->checkpoint(*this);
+
+	if (recovered && share) {
+		for (int entity : entityManager->getEntities("")) {
+			notify(entity);
+		}
+	}
+	return recovered;
+}
+
+void Environment::disableJournal() {
+	if (!journal) return;
+
+	entityManager->removeListener(journal);
+	for (const auto& [_, manager] : mapNC) {
+		manager->removeListener(journal);
+	}
+	journal->flush();
+	journal = nullptr;
+}
+
+void Environment::syncJournal() {
+	if (!journal) return;
+
+	if (checkpointSize != 0 && journal->getSize() > checkpointSize) {
+		journal->checkpoint(*this);
+	}
+	else {
+		journal->flush();
+	}
+}
+
+void Environment::checkpoint() {
+	if (journal) journal->checkpoint(*this);
+}
+
+void Environment::compactJournal() {
+	if (journal) journal->compact();
+}
+
+void Environment::startRecording(const string& path) {
+	stopRecording();
+
+	recorder = make_shared<Recorder>(path, entityManager);
+	entityManager->addListener(recorder);
+	for (const auto& [_, manager] : mapNC) {
+		manager->addListener(recorder);
+	}
+}
+
+void Environment::stopRecording() {
+	if (!recorder) return;
+
+	entityManager->removeListener(recorder);
+	for (const auto& [_, manager] : mapNC) {
+		manager->removeListener(recorder);
+	}
+	recorder->flush();
+	recorder = nullptr;
+}
+
+void Environment::runSystem(shared_ptr<System> system, const string& name) {
+	if (!recorder) {
+		system->run();
+		return;
+	}
+
+	// The run is recorded, not its changes.
+	recorder->recordRun(name);
+	recorder->suspend();
+	try {
+		system->run();
+	}
+	catch (...) {
+		recorder->resume();
+		throw;
+	}
+	recorder->resume();
+}
+
+void Environment::enableHotReload(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath) {
+	hotReload = nullptr;
+	hotReload = make_shared<HotReload>(*this, entitiesPath, componentsPath, subscriptionsPath);
+}
+
+void Environment::disableHotReload() {
+	hotReload = nullptr;
+}
+
+size_t Environment::applyReload(bool share) {
+	if (!hotReload) return 0;
+
+	unordered_set<int> touched;
+	size_t applied = hotReload->poll(*this, touched);
+
+	// The reshapes of the managers are not followed by the spatial and value indexes.
+	if (applied) {
+		for (auto& [name, indexes] : spatialIndexes) {
+			erase_if(indexes, [this, &name](const shared_ptr<SpatialIndex>& index) {
+				try {
+					index->rebuild();
+					return false;
+				}
+				catch (exception& e) {
+					cerr << "Environment : " << e.what() << endl;
+					mapNC[name]->removeListener(index);
+					return true;
+				}
+			});
+		}
+		for (auto& [name, indexes] : valueIndexes) {
+			erase_if(indexes, [this, &name](const shared_ptr<ValueIndex>& index) {
+				try {
+					index->rebuild();
+					return false;
+				}
+				catch (exception& e) {
+					cerr << "Environment : " << e.what() << endl;
+					mapNC[name]->removeListener(index);
+					return true;
+				}
+			});
+		}
+	}
+
+	// The reloaded data are not written through Component::set.
+	for (const auto& [_, tracker] : changeTrackers) {
+		for (int entity : touched) {
+			tracker->touch(entity);
+		}
+	}
+	for (const auto& [_, observed] : observers) {
+		for (int entity : touched) {
+			observed->touch(entity);
+		}
+	}
+
+	// Coalesced, an entity changed by several files is shared once.
+	if (share) {
+		for (int entity : touched) {
+			notify(entity);
+		}
+	}
+	return applied;
+}
+
+void Environment::enableStreaming(const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath) {
+	if (!streamer && subscription) {
+		throw runtime_error("Error : Only an environment made from an EntityManager can be streamed.");
+	}
+
+	// Registered first, a broken file leaves the environment as it was.
+	shared_ptr<GroupStreamer> newStreamer = make_shared<GroupStreamer>(entitiesPath, subscriptionsPath);
+	disableStreaming();
+
+	if (!subscription) {
+		loadComponents(componentsPath);
+		subscription = make_shared<Subscription>(subscriptionsPath, entityManager, make_shared<unorMapCM>(mapNC), unordered_map<string, string>());
+	}
+
+	streamer = newStreamer;
+	for (const auto& [_, manager] : mapNC) {
+		manager->addListener(streamer);
+	}
+}
+
+void Environment::disableStreaming() {
+	if (!streamer) return;
+
+	for (const auto& [_, manager] : mapNC) {
+		manager->removeListener(streamer);
+	}
+	streamer = nullptr;
+}
+
+size_t Environment::loadGroup(const string& group, GroupBy by, bool share) {
+	if (!streamer) return 0;
+
+	vector<int> created;
+	streamer->load(*this, group, by, created);
+
+	// Shared once their subscriptions are applied.
+	if (share) {
+		for (int entity : created) {
+			notify(entity);
+		}
+	}
+	return created.size();
+}
+
+size_t Environment::unloadGroup(const string& group, GroupBy by, bool save, bool share) {
+	if (!streamer) return 0;
+
+	vector<int> removed;
+	streamer->unload(*this, group, by, save, removed);
+
+	if (share) {
+		for (int entity : removed) {
+			notify(entity);
+		}
+	}
+	return removed.size();
+}
+
+void Environment::prefetchGroup(const string& group, GroupBy by) {
+	if (streamer) streamer->prefetch(*this, group, by);
+}
+
+bool Environment::isGroupLoaded(const string& group, GroupBy by) {
+	return streamer && streamer->isLoaded(group, by);
+}
+
+shared_ptr<SpatialIndex> Environment::enableSpatialIndex(const string& component, const string& field, SpatialLayout layout, float cellSize) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	disableSpatialIndex(component, field);
+	shared_ptr<SpatialIndex> index = make_shared<SpatialIndex>(manager, field, layout, cellSize);
+	manager->addListener(index);
+	spatialIndexes[component].push_back(index);
+	return index;
+}
+
+void Environment::disableSpatialIndex(const string& component, const string& field) {
+	auto found = spatialIndexes.find(component);
+	if (found == spatialIndexes.end()) return;
+
+	erase_if(found->second, [&field](const shared_ptr<SpatialIndex>& index) {
+		if (index->getField() != field) return false;
+		if (shared_ptr<ComponentManager> manager = index->getManager()) manager->removeListener(index);
+		return true;
+	});
+	if (found->second.empty()) spatialIndexes.erase(found);
+}
+
+shared_ptr<SpatialIndex> Environment::getSpatialIndex(const string& component, const string& field) {
+	auto found = spatialIndexes.find(component);
+	if (found == spatialIndexes.end()) return nullptr;
+
+	for (const auto& index : found->second) {
+		if (index->getField() == field) return index;
+	}
+	return nullptr;
+}
+
+shared_ptr<ValueIndex> Environment::enableValueIndex(const string& component, const string& field, ValueIndexKind kind) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	disableValueIndex(component, field);
+	shared_ptr<ValueIndex> index = make_shared<ValueIndex>(manager, field, kind);
+	manager->addListener(index);
+	valueIndexes[component].push_back(index);
+	return index;
+}
+
+void Environment::disableValueIndex(const string& component, const string& field) {
+	auto found = valueIndexes.find(component);
+	if (found == valueIndexes.end()) return;
+
+	erase_if(found->second, [&field](const shared_ptr<ValueIndex>& index) {
+		if (index->getField() != field) return false;
+		if (shared_ptr<ComponentManager> manager = index->getManager()) manager->removeListener(index);
+		return true;
+	});
+	if (found->second.empty()) valueIndexes.erase(found);
+}
+
+shared_ptr<ValueIndex> Environment::getValueIndex(const string& component, const string& field) {
+	auto found = valueIndexes.find(component);
+	if (found == valueIndexes.end()) return nullptr;
+
+	for (const auto& index : found->second) {
+		if (index->getField() == field) return index;
+	}
+	return nullptr;
+}
+
+Statistics Environment::getStatistics(const string& component, const string& field, const string& tag, bool checkState) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	if (tag.empty()) return Aggregate::statistics(*manager, field, checkState);
+	vector<int> entities = entityManager->getEntities(tag, false);
+	return Aggregate::statistics(*manager, field, entities, checkState);
+}
+
+VectorStatistics Environment::getVectorStatistics(const string& component, const string& field, const string& tag, bool checkState) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	if (tag.empty()) return Aggregate::vectorStatistics(*manager, field, checkState);
+	vector<int> entities = entityManager->getEntities(tag, false);
+	return Aggregate::vectorStatistics(*manager, field, entities, checkState);
+}
+
+vector<size_t> Environment::getHistogram(const string& component, const string& field, size_t bins, double min, double max, const string& tag, bool checkState) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	if (tag.empty()) return Aggregate::histogram(*manager, field, bins, min, max, checkState);
+	vector<int> entities = entityManager->getEntities(tag, false);
+	return Aggregate::histogram(*manager, field, bins, min, max, entities, checkState);
+}
+
+shared_ptr<ChangeTracker> Environment::enableChangeTracking(const string& component) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	shared_ptr<ChangeTracker>& tracker = changeTrackers[component];
+	if (!tracker) {
+		tracker = make_shared<ChangeTracker>(manager);
+		manager->addListener(tracker);
+	}
+	return tracker;
+}
+
+void Environment::disableChangeTracking(const string& component) {
+	auto found = changeTrackers.find(component);
+	if (found == changeTrackers.end()) return;
+
+	if (shared_ptr<ComponentManager> manager = found->second->getManager()) manager->removeListener(found->second);
+	changeTrackers.erase(found);
+}
+
+shared_ptr<ChangeTracker> Environment::getChangeTracker(const string& component) {
+	auto found = changeTrackers.find(component);
+	return found == changeTrackers.end() ? nullptr : found->second;
+}
+
+size_t Environment::observe(const string& component, ComponentEvent event, ComponentObserver observer) {
+	shared_ptr<ComponentManager> manager = getManager(component);
+	if (!manager) throw runtime_error("Error : There is no component \"" + component + "\" in this environment.");
+
+	shared_ptr<ComponentObservers>& observed = observers[component];
+	if (!observed) {
+		observed = make_shared<ComponentObservers>(manager);
+		manager->addListener(observed);
+	}
+	return observed->observe(event, std::move(observer));
+}
+
+void Environment::unobserve(const string& component, size_t ID) {
+	auto found = observers.find(component);
+	if (found == observers.end()) return;
+
+	found->second->unobserve(ID);
+	if (found->second->size() == 0) {
+		if (shared_ptr<ComponentManager> manager = found->second->getManager()) manager->removeListener(found->second);
+		observers.erase(found);
+	}
+}
+
+void Environment::flushObservers() {
+	// Copied, an observer can register or unregister observers.
+	vector<shared_ptr<ComponentObservers>> flushed;
+	flushed.reserve(observers.size());
+	for (const auto& [_, observed] : observers) {
+		flushed.push_back(observed);
+	}
+	for (const auto& observed : flushed) {
+		observed->flush();
+	}
+}
+
+shared_ptr<ComponentObservers> Environment::getObservers(const string& component) {
+	auto found = observers.find(component);
+	return found == observers.end() ? nullptr : found->second;
+}
+
+TimerID Environment::scheduleRemoval(int entity, uint64_t ticks) {
+	return getTimers()->removeAfter(entity, ticks);
+}
+
+TimerID Environment::scheduleState(int entity, const string& compName, bool state, uint64_t ticks) {
+	return getTimers()->setStateAfter(entity, compName, state, ticks);
+}
+
+TimerID Environment::schedule(uint64_t ticks, function<void()> callback, int entity) {
+	return getTimers()->callAfter(ticks, std::move(callback), entity);
+}
+
+bool Environment::cancelTimer(TimerID ID) {
+	return timers ? timers->cancel(ID) : false;
+}
+
+size_t Environment::advanceTimers(uint64_t ticks, bool share) {
+	ExpiredTimers expired = getTimers()->advance(ticks);
+	if (expired.size() == 0) return 0;
+
+	// The last state of each entity's component wins, then they are set by batch of component and state.
+	unordered_map<string, unordered_map<int, bool>> states;
+	for (const auto& [entity, compName, state] : expired.states) {
+		states[compName][entity] = state;
+	}
+	vector<int> batches[2];
+	for (const auto& [compName, entities] : states) {
+		batches[0].clear();
+		batches[1].clear();
+		for (const auto& [entity, state] : entities) {
+			batches[state].push_back(entity);
+		}
+		for (bool state : { false, true }) {
+			if (!batches[state].empty()) setStates(batches[state], compName, state, false);
+		}
+	}
+
+	// The removals cancel the timers left of the removed entities.
+	removeEntities(expired.removed, false);
+
+	if (share) {
+		unordered_set<int> changed;
+		for (const auto& [entity, _, __] : expired.states) {
+			changed.insert(entity);
+		}
+		changed.insert(expired.removed.begin(), expired.removed.end());
+		for (int entity : changed) {
+			notify(entity);
+		}
+	}
+
+	for (const auto& callback : expired.callbacks) {
+		callback();
+	}
+	return expired.size();
+}
+
+shared_ptr<TimerWheel> Environment::getTimers() {
+	if (!timers) {
+		timers = make_shared<TimerWheel>();
+		entityManager->addListener(timers);
+	}
+	return timers;
+}
+
+void Environment::setParent(int child, int parent) {
+	getHierarchy()->setParent(child, parent);
+}
+
+void Environment::setParent(const string& child, const string& parent) {
+	int childID = entityManager->getEntity(child);
+	int parentID = parent.empty() ? -1 : entityManager->getEntity(parent);
+	if (childID < 0 || (!parent.empty() && parentID < 0)) throw runtime_error("Error : no entity with the name \"" + (childID < 0 ? child : parent) + "\".");
+	getHierarchy()->setParent(childID, parentID);
+}
+
+int Environment::getParent(int entity) {
+	return hierarchy ? hierarchy->getParent(entity) : -1;
+}
+
+vector<int> Environment::getChildren(int entity) {
+	return hierarchy ? hierarchy->getChildren(entity) : vector<int>();
+}
+
+shared_ptr<Hierarchy> Environment::getHierarchy() {
+	if (!hierarchy) {
+		hierarchy = make_shared<Hierarchy>();
+		entityManager->addListener(hierarchy);
+	}
+	return hierarchy;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file EventBus.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <EventBus.h>
+
+using namespace std;
+
+size_t EventBus::nextTypeID() {
+	static atomic<size_t> next = 0;
+	return next++;
+}
+
+void EventBus::unsubscribe(size_t ID) {
+	shared_lock lock(mtx);
+	for (const auto& channel : channels) {
+		if (channel && channel->unsubscribe(ID)) return;
+	}
+}
+
+void EventBus::dispatch() {
+	scoped_lock dispatchLock(dispatchMtx);
+	{
+		// Copied, a subscriber can publish a type of event never used before.
+		shared_lock lock(mtx);
+		dispatched.clear();
+		for (const auto& channel : channels) {
+			if (channel) dispatched.push_back(channel.get());
+		}
+	}
+	for (Channel* channel : dispatched) {
+		channel->dispatch();
+	}
+}
+
+void EventBus::clear() {
+	shared_lock lock(mtx);
+	for (const auto& channel : channels) {
+		if (channel) channel->clear();
+	}
+}
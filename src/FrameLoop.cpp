@@ -0,0 +1,185 @@
+/**
+ * @file FrameLoop.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <FrameLoop.h>
+#include <thread>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Call a function when leaving its scope, an exception thrown by a system included.
+ */
+template<typename Function>
+class ScopeExit {
+public:
+	explicit ScopeExit(Function function) : function(std::move(function)) {}
+	~ScopeExit() { function(); }
+
+	ScopeExit(const ScopeExit&) = delete;
+	ScopeExit& operator=(const ScopeExit&) = delete;
+
+private:
+	Function function;
+};
+
+}
+
+FrameLoop::FrameLoop(shared_ptr<Environment> environment) : environment(environment), nextID(0), runs{ 0, 0, 0, 0 }, frames(0), dropped(0), step(0.0), maxSteps(1), accumulator(0.0), deltaTime(0.0), started(false), inFrame(false) {
+	if (!environment) throw runtime_error("Error : the frame loop needs an environment.");
+}
+
+size_t FrameLoop::add(FramePhase phase, shared_ptr<System> system, size_t every, double budget) {
+	if (!system) throw runtime_error("Error : the frame loop can't run a null system.");
+	size_t ID = add(phase, function<void()>(), every);
+	Entry& entry = entries.back();
+	entry.system = system;
+	entry.budget = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(budget));
+	return ID;
+}
+
+size_t FrameLoop::add(FramePhase phase, function<void()> task, size_t every) {
+	if (every == 0) throw runtime_error("Error : a system or a task should run at least every 1 run of its phase.");
+
+	// The entries with the same rate take the runs in turn.
+	size_t offset = 0;
+	for (const Entry& entry : entries) {
+		if (!entry.removed && entry.phase == phase && entry.every == every) ++offset;
+	}
+	entries.push_back({ nextID, phase, nullptr, std::move(task), every, offset % every, chrono::steady_clock::duration::zero(), 0.0, false });
+	return nextID++;
+}
+
+void FrameLoop::remove(size_t ID) {
+	for (Entry& entry : entries) {
+		if (entry.ID == ID) entry.removed = true;
+	}
+	if (!inFrame) {
+		erase_if(entries, [](const Entry& entry) {
+			return entry.removed;
+		});
+	}
+}
+
+void FrameLoop::setFixedStep(double step, size_t maxSteps) {
+	if (step < 0.0 || maxSteps == 0) throw runtime_error("Error : the fixed step should be positive with at least 1 step per frame.");
+	this->step = step;
+	this->maxSteps = maxSteps;
+	accumulator = 0.0;
+}
+
+void FrameLoop::frame() {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double elapsed = started ? chrono::duration<double>(now - previous).count() : 0.0;
+	previous = now;
+	started = true;
+	frame(elapsed);
+}
+
+void FrameLoop::frame(double elapsed) {
+	inFrame = true;
+	// The entries removed during the frame are erased after it, even if a system threw.
+	ScopeExit leave([this]() {
+		inFrame = false;
+		erase_if(entries, [](const Entry& entry) {
+			return entry.removed;
+		});
+	});
+	runPhase(FramePhase::PreUpdate);
+
+	if (step > 0.0) {
+		accumulator += std::max(elapsed, 0.0);
+		// The epsilon keeps a frame of exactly one step from being rounded down to none.
+		size_t steps = static_cast<size_t>(accumulator / step + 1e-9);
+		if (steps > maxSteps) {
+			// Caught up at most maxSteps, the rest of the time is dropped.
+			dropped += steps - maxSteps;
+			accumulator -= (steps - maxSteps) * step;
+			steps = maxSteps;
+		}
+		deltaTime = step;
+		for (size_t i = 0; i < steps; ++i) {
+			runPhase(FramePhase::Update);
+			accumulator -= step;
+		}
+		accumulator = std::max(accumulator, 0.0);
+	}
+	else {
+		deltaTime = std::max(elapsed, 0.0);
+		runPhase(FramePhase::Update);
+	}
+
+	environment->getEventBus().dispatch();
+	environment->flushObservers();
+
+	runPhase(FramePhase::PostUpdate);
+	runPhase(FramePhase::Persistence);
+	++frames;
+}
+
+void FrameLoop::run(const function<bool()>& running) {
+	chrono::steady_clock::time_point next = chrono::steady_clock::now();
+	while (running()) {
+		frame();
+		if (step <= 0.0) continue;
+
+		chrono::steady_clock::duration duration = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(step));
+		next += duration;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		// Too late to catch up, the next frame starts now instead of right after.
+		if (now > next + duration * maxSteps) next = now;
+		this_thread::sleep_until(next);
+	}
+}
+
+uint64_t FrameLoop::getFrame() {
+	return frames;
+}
+
+double FrameLoop::getDeltaTime() {
+	return deltaTime;
+}
+
+double FrameLoop::getAlpha() {
+	return step > 0.0 ? std::min(accumulator / step, 1.0) : 0.0;
+}
+
+double FrameLoop::getRunTime(size_t ID) {
+	for (const Entry& entry : entries) {
+		if (entry.ID == ID) return entry.runTime;
+	}
+	return 0.0;
+}
+
+uint64_t FrameLoop::getDroppedSteps() {
+	return dropped;
+}
+
+void FrameLoop::runPhase(FramePhase phase) {
+	uint64_t run = runs[static_cast<size_t>(phase)]++;
+
+	// By index, a system or a task can add entries.
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].removed || entries[i].phase != phase || (run + entries[i].every - entries[i].offset) % entries[i].every != 0) continue;
+
+		// Copied, the vector can grow meanwhile.
+		shared_ptr<System> system = entries[i].system;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (system) {
+			if (entries[i].budget > chrono::steady_clock::duration::zero()) system->deadline = start + entries[i].budget;
+			ScopeExit reset([&system]() { system->deadline = chrono::steady_clock::time_point::max(); });
+			system->run();
+		}
+		else {
+			function<void()> task = entries[i].task;
+			task();
+		}
+		entries[i].runTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+}
@@ -0,0 +1,422 @@
+#include "GroupStreamer.h"
+#include "Environment.h"
+
+using namespace std;
+
+namespace {
+	using event = nlohmann::json::parse_event_t;
+
+	// Return the content of an entity's file without its names, which are given one by one to the vector.
+	nlohmann::json readEntities(const string& file, vector<string>& names) {
+		ifstream entityFile(file);
+		if (!entityFile) {
+			throw runtime_error("Error : Can't read the file \"" + file + "\"");
+		}
+
+		bool inNames = false;
+		nlohmann::json header = nlohmann::json::parse(entityFile, [&](int depth, event type, nlohmann::json& parsed) {
+			if (type == event::key && depth == 1) {
+				inNames = parsed == "names";
+				return true;
+			}
+			if (inNames && type == event::value && depth == 2) {
+				names.push_back(parsed.get<string>());
+				return false;
+			}
+			return true;
+		});
+
+		if (header.contains("name")) names.push_back(header["name"]);
+		return header;
+	}
+
+	// Return the content of a subscription's file without its components.
+	nlohmann::json readSubscription(const string& file) {
+		ifstream subsFile(file);
+		if (!subsFile) {
+			throw runtime_error("Error : Can't read the file \"" + file + "\"");
+		}
+
+		return nlohmann::json::parse(subsFile, [](int depth, event type, nlohmann::json& parsed) {
+			return !(type == event::key && depth == 1 && parsed == "components");
+		});
+	}
+
+	// The same path, whatever the way it was written.
+	string normalize(const string& path) {
+		return filesystem::path(path).lexically_normal().string();
+	}
+}
+
+GroupStreamer::GroupStreamer(const string& entitiesPath, const string& subscriptionsPath) {
+	// The entities' files, read in parallel then registered in their order, the first definition of a name is kept.
+	vector<string> files = getAllFilesFromDirectory(entitiesPath);
+	vector<nlohmann::json> headers(files.size());
+	vector<vector<string>> names(files.size());
+	vector<exception_ptr> errors(files.size());
+	ThreadPool::global().parallelFor(files.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			try {
+				headers[i] = readEntities(files[i], names[i]);
+			}
+			catch (...) {
+				errors[i] = current_exception();
+			}
+		}
+	});
+
+	unordered_set<string> known;
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (errors[i]) rethrow_exception(errors[i]);
+
+		EntityFile record;
+		if (headers[i].contains("tags")) record.tags = headers[i]["tags"].get<vector<string>>();
+		if (headers[i].contains("group")) record.key = headers[i]["group"];
+		entityFiles.push_back(move(record));
+
+		uint32_t file = static_cast<uint32_t>(i);
+		for (const auto& name : names[i]) {
+			if (headers[i].contains("generate")) {
+				for (int j = 0; j < headers[i]["generate"]; ++j) {
+					if (known.insert(name + to_string(j)).second) definitions.push_back({ name + to_string(j), file });
+				}
+			}
+			else if (known.insert(name).second) {
+				definitions.push_back({ name, file });
+			}
+		}
+	}
+
+	// Sorted by name, a prefix is a range, then each file gets its entities.
+	sort(definitions.begin(), definitions.end(), [](const Definition& a, const Definition& b) { return a.name < b.name; });
+	holds.assign(definitions.size(), 0);
+	owned.assign(definitions.size(), false);
+	for (uint32_t i = 0; i < definitions.size(); ++i) {
+		entityFiles[definitions[i].file].members.push_back(i);
+	}
+
+	for (uint32_t i = 0; i < entityFiles.size(); ++i) {
+		if (!entityFiles[i].key.empty()) filesByKey[entityFiles[i].key].push_back(i);
+		for (const auto& tag : entityFiles[i].tags) {
+			filesByTag[tag].push_back(i);
+		}
+	}
+
+	// The subscriptions' files, only their targets.
+	files = getAllFilesFromDirectory(subscriptionsPath);
+	headers.assign(files.size(), nlohmann::json());
+	errors.assign(files.size(), nullptr);
+	ThreadPool::global().parallelFor(files.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			try {
+				headers[i] = readSubscription(files[i]);
+			}
+			catch (...) {
+				errors[i] = current_exception();
+			}
+		}
+	});
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (errors[i]) rethrow_exception(errors[i]);
+		addSubscription(files[i], move(headers[i]));
+	}
+}
+
+GroupStreamer::~GroupStreamer() {
+	for (auto& running : prefetches) {
+		if (running.result.valid()) running.result.wait();
+	}
+}
+
+void GroupStreamer::load(Environment& environment, const string& group, GroupBy by, vector<int>& created) {
+	if (groups.contains({ by, group })) return;
+
+	// A file written back by an unloading must be complete before being read again.
+	environment.flushSaves();
+
+	shared_ptr<EntityManager> entityManager = environment.getEntityManager();
+	shared_ptr<Subscription> subscription = environment.subscription;
+	vector<uint32_t> members = find(group, by);
+	size_t first = created.size();
+
+	setApplying(true);
+
+	// Only the entities in no other loaded group are created.
+	vector<uint32_t> fresh;
+	for (uint32_t member : members) {
+		if (holds[member]++ != 0) continue;
+
+		int ID = entityManager->createEntity(definitions[member].name);
+		if (ID == -1) continue; // Already created outside of the groups, it is not removed with them.
+		owned[member] = true;
+
+		for (const auto& tag : entityFiles[definitions[member].file].tags) {
+			entityManager->addTag(ID, tag);
+		}
+		fresh.push_back(member);
+		created.push_back(ID);
+	}
+
+	vector<int> newIDs(created.begin() + first, created.end());
+	sort(newIDs.begin(), newIDs.end());
+
+	// Only the prefetches of these files are waited for, the others keep running.
+	vector<size_t> files = target(fresh);
+	collect(files);
+
+	// Each file is applied on the new entities only, the ones already loaded keep their state.
+	for (size_t file : files) {
+		const SubscriptionFile& record = subscriptionFiles[file];
+		try {
+			vector<int> IDs;
+			bool defaultState = true;
+			if (!subscription->resolve(record.path, record.header, IDs, defaultState)) continue;
+
+			vector<int> targets;
+			set_intersection(IDs.begin(), IDs.end(), newIDs.begin(), newIDs.end(), back_inserter(targets));
+			if (targets.empty()) continue;
+
+			nlohmann::json subsJSON;
+			if (prefetched.contains(file)) {
+				subsJSON = move(prefetched[file]);
+				prefetched.erase(file);
+			}
+			else if (filesystem::file_size(record.path) > streamingFileSize) {
+				subscription->stream(record.path, targets, defaultState);
+				continue;
+			}
+			else {
+				ifstream subsFile(record.path);
+				if (!subsFile) {
+					throw runtime_error("Error : Can't read the file \"" + record.path + "\"");
+				}
+				subsJSON = nlohmann::json::parse(subsFile);
+			}
+
+			if (!subsJSON.contains("components")) continue;
+			for (const auto& component : subsJSON["components"]) {
+				subscription->apply(component, targets, defaultState);
+			}
+		}
+		catch (exception& e) {
+			cerr << "GroupStreamer : " << e.what() << endl;
+		}
+	}
+
+	// A reused ID doesn't keep the changes of its previous entity.
+	{
+		scoped_lock lock(mtx);
+		for (int ID : newIDs) {
+			dirty.erase(ID);
+		}
+	}
+	setApplying(false);
+
+	groups[{ by, group }] = move(members);
+}
+
+void GroupStreamer::unload(Environment& environment, const string& group, GroupBy by, bool save, vector<int>& removed) {
+	auto found = groups.find({ by, group });
+	if (found == groups.end()) return;
+
+	vector<uint32_t> members = move(found->second);
+	groups.erase(found);
+
+	shared_ptr<EntityManager> entityManager = environment.getEntityManager();
+	vector<pair<uint32_t, int>> evicted;
+	for (uint32_t member : members) {
+		if (--holds[member] != 0 || !owned[member]) continue;
+		owned[member] = false;
+
+		int ID = entityManager->getEntity(definitions[member].name);
+		if (ID != -1) evicted.emplace_back(member, ID);
+	}
+
+	// Written back before being removed, a prefetched copy of their files is outdated.
+	if (save && environment.subscription) {
+		if (!environment.persistence) environment.persistence = make_shared<PersistenceService>();
+
+		for (const auto& [member, ID] : evicted) {
+			{
+				scoped_lock lock(mtx);
+				if (!dirty.contains(ID)) continue;
+			}
+
+			EntityImage image = environment.subscription->capture(ID);
+			nlohmann::json header;
+			header["entity"] = image.name;
+			size_t file = addSubscription(image.path, move(header));
+			collect({ file });
+			prefetched.erase(file);
+			environment.persistence->submit(move(image));
+		}
+	}
+
+	setApplying(true);
+	for (const auto& [member, ID] : evicted) {
+		environment.removeEntity(definitions[member].name, false);
+		removed.push_back(ID);
+	}
+	{
+		scoped_lock lock(mtx);
+		for (const auto& [member, ID] : evicted) {
+			dirty.erase(ID);
+		}
+	}
+	setApplying(false);
+}
+
+void GroupStreamer::prefetch(Environment& environment, const string& group, GroupBy by) {
+	if (groups.contains({ by, group })) return;
+
+	environment.flushSaves();
+
+	vector<pair<size_t, string>> files;
+	for (size_t file : target(find(group, by))) {
+		if (!prefetched.contains(file)) files.emplace_back(file, subscriptionFiles[file].path);
+	}
+	if (files.empty()) return;
+
+	Prefetch running;
+	for (const auto& [file, path] : files) {
+		running.files.push_back(file);
+	}
+	sort(running.files.begin(), running.files.end());
+
+	// Not on the global ThreadPool, the simulation's loops must not wait for the disk.
+	running.result = async(launch::async, [files = move(files)]() {
+		vector<pair<size_t, nlohmann::json>> result;
+		for (const auto& [file, path] : files) {
+			try {
+				if (filesystem::file_size(path) > streamingFileSize) continue;
+
+				ifstream subsFile(path);
+				if (!subsFile) continue;
+				result.emplace_back(file, nlohmann::json::parse(subsFile));
+			}
+			catch (...) {
+				// Read again by the loading, which reports the error.
+			}
+		}
+		return result;
+	});
+	prefetches.push_back(move(running));
+}
+
+bool GroupStreamer::isLoaded(const string& group, GroupBy by) {
+	return groups.contains({ by, group });
+}
+
+size_t GroupStreamer::getResident() {
+	return static_cast<size_t>(count(owned.begin(), owned.end(), true));
+}
+
+void GroupStreamer::onSubscribe(ComponentManager& manager, int entity) {
+	touch(entity);
+}
+
+void GroupStreamer::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	touch(entity);
+}
+
+void GroupStreamer::onStateChange(ComponentManager& manager, int entity, bool oldState) {
+	touch(entity);
+}
+
+void GroupStreamer::afterSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	touch(entity);
+}
+
+vector<uint32_t> GroupStreamer::find(const string& group, GroupBy by) {
+	vector<uint32_t> members;
+
+	if (by == GroupBy::Prefix) {
+		auto it = lower_bound(definitions.begin(), definitions.end(), group, [](const Definition& definition, const string& prefix) { return definition.name < prefix; });
+		for (; it != definitions.end() && it->name.starts_with(group); ++it) {
+			members.push_back(static_cast<uint32_t>(it - definitions.begin()));
+		}
+		return members;
+	}
+
+	const auto& files = by == GroupBy::Key ? filesByKey : filesByTag;
+	auto found = files.find(group);
+	if (found == files.end()) return members;
+
+	for (uint32_t file : found->second) {
+		members.insert(members.end(), entityFiles[file].members.begin(), entityFiles[file].members.end());
+	}
+	return members;
+}
+
+vector<size_t> GroupStreamer::target(const vector<uint32_t>& members) {
+	// The files targeting a single entity go last, they hold the states written back.
+	set<size_t> shared, single;
+
+	for (uint32_t member : members) {
+		const string& name = definitions[member].name;
+
+		if (subscriptionsByEntity.contains(name)) {
+			single.insert(subscriptionsByEntity[name].begin(), subscriptionsByEntity[name].end());
+		}
+		for (const auto& tag : entityFiles[definitions[member].file].tags) {
+			if (subscriptionsByTag.contains(tag)) shared.insert(subscriptionsByTag[tag].begin(), subscriptionsByTag[tag].end());
+		}
+		for (size_t file : generatedFiles) {
+			if (name.starts_with(subscriptionFiles[file].header["entity"].get<string>())) shared.insert(file);
+		}
+	}
+
+	vector<size_t> files(shared.begin(), shared.end());
+	files.insert(files.end(), single.begin(), single.end());
+	return files;
+}
+
+size_t GroupStreamer::addSubscription(const string& path, nlohmann::json header) {
+	string key = normalize(path);
+	if (paths.contains(key)) return paths[key];
+
+	size_t file = subscriptionFiles.size();
+	paths[key] = file;
+
+	// Indexed the way Subscription::resolve reads the file.
+	if (header.contains("tags")) {
+		for (const auto& tag : header["tags"]) {
+			subscriptionsByTag[tag.get<string>()].push_back(file);
+		}
+	}
+	else if (header.contains("generated") && header["generated"] && header.contains("entity")) {
+		generatedFiles.push_back(file);
+	}
+	else if (header.contains("entity")) {
+		subscriptionsByEntity[header["entity"].get<string>()].push_back(file);
+	}
+
+	subscriptionFiles.push_back({ path, move(header) });
+	return file;
+}
+
+void GroupStreamer::collect(const vector<size_t>& files) {
+	for (auto it = prefetches.begin(); it != prefetches.end();) {
+		bool needed = any_of(files.begin(), files.end(), [&it](size_t file) { return binary_search(it->files.begin(), it->files.end(), file); });
+		if (!needed && it->result.wait_for(chrono::seconds(0)) != future_status::ready) {
+			++it;
+			continue;
+		}
+
+		for (auto& [file, subsJSON] : it->result.get()) {
+			prefetched[file] = move(subsJSON);
+		}
+		it = prefetches.erase(it);
+	}
+}
+
+void GroupStreamer::setApplying(bool value) {
+	scoped_lock lock(mtx);
+	applying = value;
+}
+
+void GroupStreamer::touch(int entity) {
+	scoped_lock lock(mtx);
+	if (!applying) dirty.insert(entity);
+}
@@ -0,0 +1,375 @@
+/**
+ * @file Hierarchy.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <Hierarchy.h>
+#include <algorithm>
+
+using namespace std;
+
+Hierarchy::Hierarchy() : firstRoot(-1), lastRoot(-1), count(0), dirty(false), moved(0), planned(false) {}
+
+void Hierarchy::setParent(int child, int parent) {
+	if (child < 0 || parent < -1) throw runtime_error("Error : the hierarchy can't hold a negative entity.");
+	scoped_lock lock(mtx);
+	// Checked before anything is added, a rejected relation leaves the hierarchy as it was.
+	bool cycle = parent == child;
+	if (known(child) && known(parent)) {
+		for (int ancestor = parent; ancestor >= 0 && !cycle; ancestor = nodes[ancestor].parent) {
+			cycle = ancestor == child;
+		}
+	}
+	if (cycle) throw runtime_error("Error : the entity " + to_string(child) + " can't be the child of itself or of one of its descendants.");
+
+	if (!known(child)) insert(child);
+	if (parent >= 0 && !known(parent)) insert(parent);
+	if (nodes[child].parent == parent) return;
+
+	if (!dirty) {
+		size_t c = nodes[child].position;
+		size_t s = sizes[c];
+		// The end of the new parent's subtree, counted without the moved subtree.
+		size_t destination = order.size() - s;
+		if (parent >= 0) {
+			size_t p = nodes[parent].position;
+			bool ancestor = p <= c && c < p + sizes[p];
+			destination = (p < c ? p : p - s) + sizes[p] - (ancestor ? s : 0);
+		}
+		if (inPlace(max(c, destination) + s - min(c, destination))) {
+			move(child, parent, c, destination);
+			return;
+		}
+		dirty = true;
+	}
+	unlink(child);
+	link(child, parent);
+	planned = false;
+}
+
+void Hierarchy::add(int entity) {
+	if (entity < 0) throw runtime_error("Error : the hierarchy can't hold a negative entity.");
+	scoped_lock lock(mtx);
+	if (!known(entity)) insert(entity);
+}
+
+void Hierarchy::remove(int entity) {
+	scoped_lock lock(mtx);
+	if (!known(entity)) return;
+
+	Node& node = nodes[entity];
+	int parent = node.parent;
+	size_t c = node.position;
+	bool shifted = !dirty && inPlace(order.size() - c);
+	if (shifted) {
+		for (int ancestor = parent; ancestor >= 0; ancestor = nodes[ancestor].parent) {
+			--sizes[nodes[ancestor].position];
+		}
+		for (size_t i = c + 1; i < c + sizes[c]; ++i) {
+			--depths[i];
+		}
+	}
+
+	// The children take its place among its siblings, their subtrees don't move.
+	for (int child = node.first; child >= 0; child = nodes[child].next) {
+		nodes[child].parent = parent;
+	}
+	int after = node.first >= 0 ? node.first : node.next;
+	int before = node.first >= 0 ? node.last : node.previous;
+	if (node.first >= 0) {
+		nodes[node.first].previous = node.previous;
+		nodes[node.last].next = node.next;
+	}
+	if (node.previous >= 0) nodes[node.previous].next = after;
+	else (parent < 0 ? firstRoot : nodes[parent].first) = after;
+	if (node.next >= 0) nodes[node.next].previous = before;
+	else (parent < 0 ? lastRoot : nodes[parent].last) = before;
+	node = { absent, -1, -1, -1, -1, -1 };
+	--count;
+	planned = false;
+
+	if (shifted) {
+		order.erase(order.begin() + c);
+		parents.erase(parents.begin() + c);
+		sizes.erase(sizes.begin() + c);
+		depths.erase(depths.begin() + c);
+		int removed = static_cast<int>(c);
+		int parentPosition = parent < 0 ? -1 : nodes[parent].position;
+		for (size_t i = c; i < order.size(); ++i) {
+			int& position = parents[i];
+			if (position == removed) position = parentPosition;
+			else if (position > removed) --position;
+			nodes[order[i]].position = static_cast<int>(i);
+		}
+	}
+	else dirty = true;
+}
+
+int Hierarchy::getParent(int entity) {
+	scoped_lock lock(mtx);
+	return known(entity) ? nodes[entity].parent : -1;
+}
+
+vector<int> Hierarchy::getChildren(int entity) {
+	scoped_lock lock(mtx);
+	vector<int> result;
+	if (!known(entity)) return result;
+	for (int child = nodes[entity].first; child >= 0; child = nodes[child].next) {
+		result.push_back(child);
+	}
+	return result;
+}
+
+vector<int> Hierarchy::getSubtree(int entity) {
+	scoped_lock lock(mtx);
+	if (!known(entity)) return {};
+	sync();
+	size_t c = nodes[entity].position;
+	return vector<int>(order.begin() + c, order.begin() + c + sizes[c]);
+}
+
+int Hierarchy::getDepth(int entity) {
+	scoped_lock lock(mtx);
+	if (!known(entity)) return -1;
+	sync();
+	return depths[nodes[entity].position];
+}
+
+int Hierarchy::getPosition(int entity) {
+	scoped_lock lock(mtx);
+	if (!known(entity)) return -1;
+	sync();
+	return nodes[entity].position;
+}
+
+vector<int> Hierarchy::getOrder() {
+	scoped_lock lock(mtx);
+	sync();
+	return order;
+}
+
+bool Hierarchy::contains(int entity) {
+	scoped_lock lock(mtx);
+	return known(entity);
+}
+
+size_t Hierarchy::size() {
+	scoped_lock lock(mtx);
+	return count;
+}
+
+void Hierarchy::propagate(ComponentManager& manager, const string& localField, const string& worldField) {
+	size_t vector3 = typeToID("vector3");
+	if (manager.getTypeID(localField) != vector3) throw runtime_error("Error : the data \"" + localField + "\" of \"" + manager.getName() + "\" is not a Vector3.");
+	if (manager.getTypeID(worldField) != vector3) throw runtime_error("Error : the data \"" + worldField + "\" of \"" + manager.getName() + "\" is not a Vector3.");
+
+	scoped_lock lock(mtx);
+	sync();
+	// One lock of the manager to find the components, they are read and written outside of it.
+	vector<shared_ptr<Component>> components(order.size());
+	{
+		scoped_lock managerLock(manager.mtx);
+		for (size_t i = 0; i < order.size(); ++i) {
+			auto found = manager.mapEC.find(order[i]);
+			if (found != manager.mapEC.end()) components[i] = found->second.first;
+		}
+	}
+
+	vector<Vector3> local(order.size());
+	vector<Vector3> world(order.size());
+	ThreadPool::global().parallelFor(order.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			local[i] = components[i] ? components[i]->get<Vector3>(localField) : Vector3{ 0.0f, 0.0f, 0.0f };
+		}
+	}, 1024);
+
+	auto offset = [](const Vector3& parent, const Vector3& local) { return parent + local; };
+	propagateLocked<Vector3>(local, world, offset);
+
+	// Only the moved positions are written, the unchanged ones don't notify the listeners.
+	ThreadPool::global().parallelFor(order.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			if (!components[i]) continue;
+			Vector3 stored = components[i]->get<Vector3>(worldField);
+			if (stored.x != world[i].x || stored.y != world[i].y || stored.z != world[i].z) components[i]->set(worldField, world[i]);
+		}
+	}, 1024);
+}
+
+void Hierarchy::onRemove(EntityManager& manager, int entity, const string& name) {
+	remove(entity);
+}
+
+bool Hierarchy::known(int entity) {
+	return entity >= 0 && static_cast<size_t>(entity) < nodes.size() && nodes[entity].parent != absent;
+}
+
+void Hierarchy::insert(int entity) {
+	if (static_cast<size_t>(entity) >= nodes.size()) nodes.resize(entity + 1, { absent, -1, -1, -1, -1, -1 });
+	link(entity, -1);
+	++count;
+	planned = false;
+	if (dirty) return;
+
+	nodes[entity].position = static_cast<int>(order.size());
+	order.push_back(entity);
+	parents.push_back(-1);
+	sizes.push_back(1);
+	depths.push_back(0);
+}
+
+void Hierarchy::move(int child, int parent, size_t c, size_t destination) {
+	size_t s = sizes[c];
+	for (int ancestor = nodes[child].parent; ancestor >= 0; ancestor = nodes[ancestor].parent) {
+		sizes[nodes[ancestor].position] -= static_cast<int>(s);
+	}
+
+	// The subtree is one block, only the entities between its old and new places move.
+	for (vector<int>* values : { &order, &parents, &sizes, &depths }) {
+		if (destination < c) rotate(values->begin() + destination, values->begin() + c, values->begin() + c + s);
+		else if (destination > c) rotate(values->begin() + c, values->begin() + c + s, values->begin() + destination + s);
+	}
+
+	unlink(child);
+	link(child, parent);
+
+	// The positions of the parents are moved like the entities.
+	int first = static_cast<int>(min(c, destination));
+	int last = static_cast<int>(max(c, destination) + s);
+	int block = static_cast<int>(c);
+	int blockEnd = static_cast<int>(c + s);
+	int shift = static_cast<int>(destination) - block;
+	int others = destination < c ? static_cast<int>(s) : -static_cast<int>(s);
+	for (int i = first; i < last; ++i) {
+		int& position = parents[i];
+		if (position >= block && position < blockEnd) position += shift;
+		else if (position >= first && position < last) position += others;
+		nodes[order[i]].position = i;
+	}
+	parents[destination] = parent < 0 ? -1 : nodes[parent].position;
+	follow(first, last);
+
+	for (int ancestor = parent; ancestor >= 0; ancestor = nodes[ancestor].parent) {
+		sizes[nodes[ancestor].position] += static_cast<int>(s);
+	}
+	int delta = (parent < 0 ? 0 : depths[nodes[parent].position] + 1) - depths[destination];
+	if (delta != 0) {
+		for (size_t i = destination; i < destination + s; ++i) {
+			depths[i] += delta;
+		}
+	}
+	planned = false;
+}
+
+void Hierarchy::unlink(int entity) {
+	Node& node = nodes[entity];
+	if (node.previous >= 0) nodes[node.previous].next = node.next;
+	else (node.parent < 0 ? firstRoot : nodes[node.parent].first) = node.next;
+	if (node.next >= 0) nodes[node.next].previous = node.previous;
+	else (node.parent < 0 ? lastRoot : nodes[node.parent].last) = node.previous;
+	node.previous = -1;
+	node.next = -1;
+}
+
+void Hierarchy::link(int entity, int parent) {
+	Node& node = nodes[entity];
+	int& first = parent < 0 ? firstRoot : nodes[parent].first;
+	int& last = parent < 0 ? lastRoot : nodes[parent].last;
+	node.parent = parent;
+	node.previous = last;
+	node.next = -1;
+	if (last >= 0) nodes[last].next = entity;
+	else first = entity;
+	last = entity;
+}
+
+bool Hierarchy::inPlace(size_t moved) {
+	// Past about the cost of building the order again, the next changes only update the relations.
+	if (this->moved + moved > max<size_t>(1024, order.size())) return false;
+	this->moved += moved;
+	return true;
+}
+
+void Hierarchy::sync() {
+	if (!dirty) return;
+
+	order.clear();
+	parents.clear();
+	depths.clear();
+	order.reserve(count);
+	parents.reserve(count);
+	depths.reserve(count);
+
+	// Depth first from the roots, the children in their order: down to the first child, else to the next sibling of the entity or of its closest ancestor.
+	int entity = firstRoot;
+	while (entity >= 0) {
+		Node& node = nodes[entity];
+		int parent = node.parent < 0 ? -1 : nodes[node.parent].position;
+		node.position = static_cast<int>(order.size());
+		order.push_back(entity);
+		parents.push_back(parent);
+		depths.push_back(parent < 0 ? 0 : depths[parent] + 1);
+
+		if (node.first >= 0) {
+			entity = node.first;
+			continue;
+		}
+		while (entity >= 0 && nodes[entity].next < 0) {
+			entity = nodes[entity].parent;
+		}
+		if (entity >= 0) entity = nodes[entity].next;
+	}
+
+	// The children are after their parent, the sizes are summed backward.
+	sizes.assign(order.size(), 1);
+	for (size_t i = order.size(); i-- > 0;) {
+		if (parents[i] >= 0) sizes[parents[i]] += sizes[i];
+	}
+	dirty = false;
+	planned = false;
+	moved = 0;
+}
+
+void Hierarchy::follow(int begin, int end) {
+	if (static_cast<size_t>(end) >= order.size()) return;
+	// Only the ancestors of the next entity can have children on both sides of end.
+	for (int ancestor = nodes[order[end]].parent; ancestor >= 0; ancestor = nodes[ancestor].parent) {
+		int position = nodes[ancestor].position;
+		if (position < begin) break;
+		for (int child = nodes[ancestor].last; child >= 0 && nodes[child].position >= end; child = nodes[child].previous) {
+			parents[nodes[child].position] = position;
+		}
+	}
+}
+
+void Hierarchy::plan() {
+	if (planned) return;
+	serial.clear();
+	ranges.clear();
+
+	// A subtree bigger than the grain gives its root to the serial pass, and its children are split in turn.
+	int grain = static_cast<int>(max<size_t>(order.size() / (ThreadPool::global().getSize() * 4), 4096));
+	vector<pair<int, int>> runs = { { 0, static_cast<int>(order.size()) } };
+	while (!runs.empty()) {
+		auto [begin, end] = runs.back();
+		runs.pop_back();
+
+		int start = begin;
+		for (int i = begin; i < end; i += sizes[i]) {
+			if (sizes[i] > grain) {
+				if (i > start) ranges.push_back({ start, i });
+				serial.push_back(i);
+				runs.push_back({ i + 1, i + sizes[i] });
+				start = i + sizes[i];
+			}
+			else if (i - start + sizes[i] > grain) {
+				ranges.push_back({ start, i });
+				start = i;
+			}
+		}
+		if (end > start) ranges.push_back({ start, end });
+	}
+	planned = true;
+}
@@ -0,0 +1,424 @@
+#include "HotReload.h"
+#include "Environment.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+namespace {
+	// Return the parsed file, or a discarded JSON if it doesn't exist anymore.
+	nlohmann::json readFile(const string& file) {
+		if (!filesystem::exists(file)) return nlohmann::json(nlohmann::json::value_t::discarded);
+
+		ifstream jsonFile(file);
+		if (!jsonFile) {
+			throw runtime_error("Error : Can't read the file \"" + file + "\"");
+		}
+		return nlohmann::json::parse(jsonFile);
+	}
+}
+
+HotReload::HotReload(Environment& environment, const string& entitiesPath, const string& componentsPath, const string& subscriptionsPath) : fd(-1) {
+	if (!environment.subscription) {
+		throw runtime_error("Error : Only an environment loaded from files can be reloaded.");
+	}
+
+#ifdef __linux__
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		throw runtime_error("Error : Can't start watching the definitions' directories.");
+	}
+
+	// Watched before being read, a change made in between is applied by the first poll.
+	watch(Kind::Component, componentsPath);
+	watch(Kind::Entity, entitiesPath);
+	watch(Kind::Subscription, subscriptionsPath);
+#else
+	throw runtime_error("Error : The hot reload is only available on Linux.");
+#endif
+
+	// What each file brought, read in parallel.
+	vector<string> files = getAllFilesFromDirectory(componentsPath);
+	parsedFiles parsed = parseFiles(files);
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (parsed[i].second || !parsed[i].first.contains("name")) continue;
+		componentFiles[files[i]] = parsed[i].first["name"];
+	}
+
+	files = getAllFilesFromDirectory(entitiesPath);
+	parsed = parseFiles(files);
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (parsed[i].second) continue;
+		EntityFile record = readEntities(parsed[i].first);
+		for (const auto& name : record.names) {
+			++definitions[name];
+		}
+		entityFiles[files[i]] = move(record);
+	}
+
+	// The subscriptions are resolved on the current entities, nothing is applied.
+	shared_ptr<Subscription> subscription = environment.subscription;
+	files = getAllFilesFromDirectory(subscriptionsPath);
+	parsed = parseFiles(files);
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (parsed[i].second) continue;
+		const nlohmann::json& subsJSON = parsed[i].first;
+
+		SubscriptionFile record;
+		if (subsJSON.contains("entity")) record.entity = subsJSON["entity"];
+		if (subsJSON.contains("generated")) record.generated = subsJSON["generated"];
+		if (subsJSON.contains("tags")) record.tags = subsJSON["tags"].get<vector<string>>();
+		if (subsJSON.contains("state")) record.state = subsJSON["state"];
+
+		vector<int> IDs;
+		bool state = true;
+		if (subscription->resolve(files[i], subsJSON, IDs, state) && subsJSON.contains("components")) {
+			for (const auto& component : subsJSON["components"]) {
+				string name = component["name"];
+				if (!environment.getManager(name)) continue;
+
+				for (int ID : IDs) {
+					if (record.targets[name].insert(environment.getName(ID)).second) ++covers[name][environment.getName(ID)];
+				}
+			}
+		}
+		if (subsJSON.contains("components")) {
+			for (const auto& component : subsJSON["components"]) {
+				record.targets.try_emplace(component["name"]);
+			}
+		}
+
+		index(files[i], record, true);
+		subscriptionFiles[files[i]] = move(record);
+	}
+}
+
+HotReload::~HotReload() {
+#ifdef __linux__
+	if (fd != -1) close(fd);
+#endif
+}
+
+size_t HotReload::poll(Environment& environment, unordered_set<int>& touched) {
+	// The changed files, each one once whatever its number of events.
+	set<string> changed[3];
+
+#ifdef __linux__
+	alignas(inotify_event) char buffer[16 * 1024];
+	while (true) {
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		if (length <= 0) break; // EAGAIN, nothing left.
+
+		for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len) {
+			const inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+			if (!watches.contains(event->wd) || event->len == 0) continue;
+
+			const auto& [kind, directory] = watches[event->wd];
+			string path = (filesystem::path(directory) / event->name).string();
+
+			if (event->mask & IN_ISDIR) {
+				// A new directory is watched, the files already in it are applied.
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					watch(kind, path);
+					for (const auto& file : getAllFilesFromDirectory(path)) {
+						changed[static_cast<int>(kind)].insert(file);
+					}
+				}
+				continue;
+			}
+			changed[static_cast<int>(kind)].insert(path);
+		}
+	}
+#endif
+
+	// The components first, the subscriptions use them, and the entities before the subscriptions for the same reason.
+	size_t applied = 0;
+	for (int kind = 0; kind < 3; ++kind) {
+		for (const auto& file : changed[kind]) {
+			try {
+				switch (static_cast<Kind>(kind)) {
+				case Kind::Component: reloadComponent(environment, file, touched); break;
+				case Kind::Entity: reloadEntities(environment, file, touched); break;
+				case Kind::Subscription: reloadSubscription(environment, file, "", true, touched); break;
+				}
+				++applied;
+			}
+			catch (exception& e) {
+				cerr << "HotReload : " << e.what() << endl;
+			}
+		}
+	}
+
+	return applied;
+}
+
+void HotReload::watch(Kind kind, const string& directory) {
+#ifdef __linux__
+	vector<string> directories = { directory };
+	try {
+		for (const auto& entry : filesystem::recursive_directory_iterator(directory)) {
+			if (entry.is_directory()) directories.push_back(entry.path().string());
+		}
+	}
+	catch (const filesystem::filesystem_error& e) {
+		cerr << e.what() << endl;
+	}
+
+	for (const auto& path : directories) {
+		int wd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE);
+		if (wd == -1) {
+			throw runtime_error("Error : Can't watch the directory \"" + path + "\"");
+		}
+		watches[wd] = { kind, path };
+	}
+#endif
+}
+
+void HotReload::reloadEntities(Environment& environment, const string& file, unordered_set<int>& touched) {
+	nlohmann::json entityJSON = readFile(file);
+	EntityFile record = entityJSON.is_discarded() ? EntityFile() : readEntities(entityJSON);
+	EntityFile previous = entityFiles[file];
+
+	unordered_set<string> names(record.names.begin(), record.names.end());
+	unordered_set<string> previousNames(previous.names.begin(), previous.names.end());
+	unordered_set<string> previousTags(previous.tags.begin(), previous.tags.end());
+
+	// Entities gone with their last file.
+	for (const auto& name : previous.names) {
+		if (names.contains(name)) continue;
+		if (--definitions[name] > 0) continue;
+		definitions.erase(name);
+
+		int ID = environment.getEntity(name);
+		if (ID == -1) continue;
+		environment.removeEntity(name, false);
+		touched.insert(ID);
+	}
+
+	// New entities, and new tags on the others.
+	vector<string> updated;
+	for (const auto& name : record.names) {
+		bool isNew = !previousNames.contains(name);
+		if (isNew) ++definitions[name];
+
+		int ID = environment.getEntity(name);
+		if (ID == -1) ID = environment.createEntity(name, false, false);
+		else if (!isNew && previousTags.size() == record.tags.size() && all_of(record.tags.begin(), record.tags.end(), [&](const string& tag) { return previousTags.contains(tag); })) continue;
+
+		for (const auto& tag : record.tags) {
+			environment.addTag(ID, tag, false);
+		}
+		touched.insert(ID);
+		updated.push_back(name);
+	}
+
+	if (entityJSON.is_discarded()) entityFiles.erase(file);
+	else entityFiles[file] = move(record);
+
+	subscribeNew(environment, updated, touched);
+}
+
+void HotReload::reloadComponent(Environment& environment, const string& file, unordered_set<int>& touched) {
+	nlohmann::json compJSON = readFile(file);
+	string previous = componentFiles.contains(file) ? componentFiles[file] : "";
+	string name = compJSON.is_discarded() ? "" : compJSON["name"].get<string>();
+
+	// Removed, or renamed.
+	if (!previous.empty() && previous != name) {
+		shared_ptr<ComponentManager> manager = environment.getManager(previous);
+		if (manager) {
+			for (int entity : manager->getEntities(false)) {
+				touched.insert(entity);
+			}
+			environment.removeManager(previous, false);
+		}
+		componentFiles.erase(file);
+	}
+	if (name.empty()) return;
+	componentFiles[file] = name;
+
+	shared_ptr<ComponentManager> manager = environment.getManager(name);
+	if (manager) {
+		manager->reshape(make_shared<Component>(file));
+	}
+	else {
+		environment.addManager(make_shared<ComponentManager>(file));
+	}
+
+	// The subscriptions of this component are applied again, the new or retyped data get their values back.
+	set<string> files = byComponent[name];
+	for (const auto& subsFile : files) {
+		reloadSubscription(environment, subsFile, name, true, touched);
+	}
+}
+
+void HotReload::reloadSubscription(Environment& environment, const string& file, const string& component, bool changed, unordered_set<int>& touched) {
+	nlohmann::json subsJSON = readFile(file);
+	if (subsJSON.is_discarded() && !component.empty()) return; // Removed, applied by its own event.
+	SubscriptionFile previous = subscriptionFiles[file];
+
+	SubscriptionFile record;
+	vector<int> IDs;
+	bool state = true;
+	if (!subsJSON.is_discarded()) {
+		if (subsJSON.contains("entity")) record.entity = subsJSON["entity"];
+		if (subsJSON.contains("generated")) record.generated = subsJSON["generated"];
+		if (subsJSON.contains("tags")) record.tags = subsJSON["tags"].get<vector<string>>();
+		if (subsJSON.contains("state")) record.state = subsJSON["state"];
+
+		if (!environment.subscription->resolve(file, subsJSON, IDs, state)) IDs.clear();
+	}
+
+	// Only the given component changes, the others are kept as they were.
+	if (!component.empty()) {
+		record.targets = previous.targets;
+		record.targets.erase(component);
+	}
+
+	vector<string> names;
+	names.reserve(IDs.size());
+	for (int ID : IDs) {
+		names.push_back(environment.getName(ID));
+	}
+
+	if (!subsJSON.is_discarded() && subsJSON.contains("components")) {
+		for (const auto& entry : subsJSON["components"]) {
+			string name = entry["name"];
+			if (!component.empty() && name != component) continue;
+
+			unordered_set<string>& targets = record.targets[name];
+			if (!environment.getManager(name)) continue; // Unknown component, applied once it is created.
+
+			const unordered_set<string>& previousTargets = previous.targets[name];
+			vector<int> toApply;
+			for (size_t i = 0; i < IDs.size(); ++i) {
+				targets.insert(names[i]);
+				if (changed || !previousTargets.contains(names[i])) toApply.push_back(IDs[i]);
+			}
+
+			environment.subscription->apply(entry, toApply, state);
+			// A state changed in the file is given to every entity, not only the new ones.
+			if (changed && state && !previous.state) {
+				shared_ptr<ComponentManager> manager = environment.getManager(name);
+				for (int ID : IDs) {
+					manager->setState(ID, true);
+				}
+			}
+			touched.insert(toApply.begin(), toApply.end());
+		}
+	}
+
+	// Coverage, the entities subscribed by no file anymore are unsubscribed.
+	for (const auto& [name, targets] : record.targets) {
+		const unordered_set<string>& previousTargets = previous.targets[name];
+		for (const auto& entity : targets) {
+			if (!previousTargets.contains(entity)) ++covers[name][entity];
+		}
+	}
+	for (const auto& [name, previousTargets] : previous.targets) {
+		const unordered_set<string>& targets = record.targets[name];
+		for (const auto& entity : previousTargets) {
+			if (targets.contains(entity) || --covers[name][entity] > 0) continue;
+			covers[name].erase(entity);
+
+			shared_ptr<ComponentManager> manager = environment.getManager(name);
+			int ID = environment.getEntity(entity);
+			if (!manager || ID == -1 || !manager->hasEntity(ID, true)) continue;
+			manager->unsubscribe(ID);
+			touched.insert(ID);
+		}
+	}
+
+	index(file, previous, false);
+	if (subsJSON.is_discarded()) {
+		subscriptionFiles.erase(file);
+		return;
+	}
+	index(file, record, true);
+	subscriptionFiles[file] = move(record);
+}
+
+void HotReload::subscribeNew(Environment& environment, const vector<string>& names, unordered_set<int>& touched) {
+	if (names.empty()) return;
+
+	// The files which can target these entities, each one applied once.
+	set<string> files;
+	shared_ptr<EntityManager> entityManager = environment.getEntityManager();
+	for (const auto& name : names) {
+		if (byEntity.contains(name)) files.insert(byEntity[name].begin(), byEntity[name].end());
+
+		for (const auto& tag : entityManager->getTags(environment.getEntity(name))) {
+			if (byTag.contains(tag)) files.insert(byTag[tag].begin(), byTag[tag].end());
+		}
+
+		for (const auto& file : generatedFiles) {
+			if (name.starts_with(subscriptionFiles[file].entity)) files.insert(file);
+		}
+	}
+
+	for (const auto& file : files) {
+		try {
+			reloadSubscription(environment, file, "", false, touched);
+		}
+		catch (exception& e) {
+			cerr << "HotReload : " << e.what() << endl;
+		}
+	}
+}
+
+void HotReload::index(const string& file, const SubscriptionFile& record, bool add) {
+	auto update = [&file, add](set<string>& files) {
+		if (add) files.insert(file);
+		else files.erase(file);
+	};
+
+	if (!record.tags.empty()) {
+		for (const auto& tag : record.tags) {
+			update(byTag[tag]);
+		}
+	}
+	else if (record.generated) {
+		update(generatedFiles);
+	}
+	// Also indexed with tags, a file of an unknown entity is skipped whatever its tags.
+	if (!record.generated && !record.entity.empty()) {
+		update(byEntity[record.entity]);
+	}
+	for (const auto& [name, _] : record.targets) {
+		update(byComponent[name]);
+	}
+}
+
+HotReload::EntityFile HotReload::readEntities(const nlohmann::json& entityJSON) {
+	EntityFile record;
+
+	vector<string> names;
+	if (entityJSON.contains("name")) {
+		names.push_back(entityJSON["name"]);
+	}
+	else if (entityJSON.contains("names")) {
+		names = entityJSON["names"].get<vector<string>>();
+	}
+
+	if (entityJSON.contains("tags")) {
+		record.tags = entityJSON["tags"].get<vector<string>>();
+	}
+
+	for (const auto& name : names) {
+		if (entityJSON.contains("generate")) {
+			for (int i = 0; i < entityJSON["generate"]; ++i) {
+				record.names.push_back(name + to_string(i));
+			}
+		}
+		else {
+			record.names.push_back(name);
+		}
+	}
+
+	return record;
+}
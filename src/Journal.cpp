@@ -0,0 +1,264 @@
+#include "Journal.h"
+#include "Environment.h"
+
+using namespace std;
+
+namespace {
+	const char journalMagic[4] = { 'T', 'M', 'J', 'L' };
+	const char checkpointMagic[4] = { 'T', 'M', 'C', 'P' };
+	const uint32_t journalVersion = 1;
+}
+
+Journal::Journal(const string& path, shared_ptr<EntityManager> entityManager) : OperationListener(entityManager), path(path), generation(0), size(0) {
+}
+
+Journal::~Journal() {
+	flush();
+}
+
+void Journal::flush() {
+	scoped_lock lock(mtx);
+	if (file.is_open()) file.flush();
+}
+
+size_t Journal::getSize() {
+	scoped_lock lock(mtx);
+	return size;
+}
+
+void Journal::checkpoint(Environment& environment) {
+	scoped_lock lock(mtx);
+	shared_ptr<EntityManager> entities = environment.getEntityManager();
+	uint64_t newGeneration = generation + 1;
+
+	string checkpointPath = path + ".checkpoint";
+	{
+		ofstream checkpointFile(checkpointPath + ".tmp", ios::binary | ios::trunc);
+		if (!checkpointFile) {
+			throw runtime_error("Error : Can't write the file \"" + checkpointPath + ".tmp\"");
+		}
+
+		checkpointFile.write(checkpointMagic, 4);
+		writeBinary<uint32_t>(checkpointFile, journalVersion);
+		writeBinary<uint64_t>(checkpointFile, newGeneration);
+
+		// Entities, with their tags.
+		vector<string> names = entities->getNames();
+		writeBinary<uint32_t>(checkpointFile, static_cast<uint32_t>(names.size()));
+		for (const auto& name : names) {
+			stringToBinary(checkpointFile, name);
+			vector<string> tags = entities->getTags(entities->getEntity(name));
+			writeBinary<uint32_t>(checkpointFile, static_cast<uint32_t>(tags.size()));
+			for (const auto& tag : tags) {
+				stringToBinary(checkpointFile, tag);
+			}
+		}
+
+		// Subscriptions of each manager, with their states and data.
+		vector<shared_ptr<ComponentManager>> managers = environment.getManagers();
+		writeBinary<uint32_t>(checkpointFile, static_cast<uint32_t>(managers.size()));
+		for (const auto& manager : managers) {
+			stringToBinary(checkpointFile, manager->getName());
+			vector<int> subscribed = manager->getEntities(false);
+			writeBinary<uint32_t>(checkpointFile, static_cast<uint32_t>(subscribed.size()));
+			for (int entity : subscribed) {
+				stringToBinary(checkpointFile, entities->getName(entity));
+				writeBinary<uint8_t>(checkpointFile, manager->getState(entity) ? 1 : 0);
+
+				const dataUnMap& data = manager->getComponent(entity)->getRawData();
+				writeBinary<uint32_t>(checkpointFile, static_cast<uint32_t>(data.size()));
+				for (const auto& [key, value] : data) {
+					stringToBinary(checkpointFile, key);
+					valueToBinary(checkpointFile, value.second);
+				}
+			}
+		}
+
+		if (!checkpointFile.flush()) {
+			throw runtime_error("Error : Can't write the file \"" + checkpointPath + ".tmp\"");
+		}
+	}
+	filesystem::rename(checkpointPath + ".tmp", checkpointPath);
+
+	// The previous journal is now useless, its generation doesn't match the checkpoint anymore.
+	generation = newGeneration;
+	if (file.is_open()) file.close();
+	file.open(path, ios::binary | ios::trunc);
+	writeHeader(file);
+	file.flush();
+	size = 0;
+}
+
+void Journal::compact() {
+	scoped_lock lock(mtx);
+	if (file.is_open()) file.flush();
+
+	uint64_t journalGeneration = 0;
+	vector<string> records = readRecords(journalGeneration);
+
+	// From the end, only the last write of each data (or state) is kept.
+	unordered_set<string> written;
+	vector<bool> kept(records.size(), true);
+	for (size_t i = records.size(); i-- > 0;) {
+		istringstream record(records[i]);
+		Operation operation = static_cast<Operation>(readBinary<uint8_t>(record));
+		if (operation != Operation::Set && operation != Operation::SetState) continue;
+
+		// Entity, component and, for a write, the data's name.
+		string key = to_string(static_cast<int>(operation));
+		key += '\0' + binaryToString(record);
+		key += '\0' + binaryToString(record);
+		if (operation == Operation::Set) key += '\0' + binaryToString(record);
+
+		if (!written.insert(key).second) kept[i] = false;
+	}
+
+	{
+		ofstream compacted(path + ".tmp", ios::binary | ios::trunc);
+		writeHeader(compacted);
+		size = 0;
+		for (size_t i = 0; i < records.size(); ++i) {
+			if (!kept[i]) continue;
+			writeBinary<uint32_t>(compacted, static_cast<uint32_t>(records[i].size()));
+			writeBinary<uint64_t>(compacted, hashBytes(records[i].data(), records[i].size()));
+			compacted.write(records[i].data(), records[i].size());
+			size += sizeof(uint32_t) + sizeof(uint64_t) + records[i].size();
+		}
+	}
+
+	if (file.is_open()) file.close();
+	filesystem::rename(path + ".tmp", path);
+	file.open(path, ios::binary | ios::app);
+}
+
+bool Journal::recover(Environment& environment) {
+	scoped_lock lock(mtx);
+	bool recovered = loadCheckpoint(environment);
+
+	uint64_t journalGeneration = 0;
+	vector<string> records = readRecords(journalGeneration);
+
+	// A journal from another generation was already folded in a checkpoint.
+	if (journalGeneration == generation) {
+		for (const auto& record : records) {
+			try {
+				applyOperation(environment, record);
+			}
+			catch (exception& e) {
+				cerr << "Journal : " << e.what() << endl;
+			}
+		}
+		recovered = recovered || !records.empty();
+	}
+
+	return recovered;
+}
+
+void Journal::writeHeader(ostream& stream) {
+	stream.write(journalMagic, 4);
+	writeBinary<uint32_t>(stream, journalVersion);
+	writeBinary<uint64_t>(stream, generation);
+}
+
+void Journal::write(const string& record) {
+	scoped_lock lock(mtx);
+	if (!file.is_open()) return; // Nothing is recorded before the first checkpoint.
+
+	// Size and checksum first, a record cut by a crash is detected at the recovery.
+	writeBinary<uint32_t>(file, static_cast<uint32_t>(record.size()));
+	writeBinary<uint64_t>(file, hashBytes(record.data(), record.size()));
+	file.write(record.data(), record.size());
+	size += sizeof(uint32_t) + sizeof(uint64_t) + record.size();
+}
+
+vector<string> Journal::readRecords(uint64_t& journalGeneration) {
+	vector<string> records;
+	ifstream journalFile(path, ios::binary);
+	if (!journalFile) return records;
+
+	char magic[4];
+	if (!journalFile.read(magic, 4) || !equal(magic, magic + 4, journalMagic)) return records;
+
+	try {
+		if (readBinary<uint32_t>(journalFile) != journalVersion) return records;
+		journalGeneration = readBinary<uint64_t>(journalFile);
+
+		while (journalFile.peek() != EOF) {
+			uint32_t recordSize = readBinary<uint32_t>(journalFile);
+			uint64_t checksum = readBinary<uint64_t>(journalFile);
+
+			string record(recordSize, '\0');
+			if (!journalFile.read(record.data(), recordSize)) break; // Cut record.
+			if (hashBytes(record.data(), record.size()) != checksum) break; // Broken record.
+
+			records.push_back(move(record));
+		}
+	}
+	catch (exception&) {
+		// End of the valid records.
+	}
+
+	return records;
+}
+
+bool Journal::loadCheckpoint(Environment& environment) {
+	ifstream checkpointFile(path + ".checkpoint", ios::binary);
+	if (!checkpointFile) return false;
+
+	char magic[4];
+	if (!checkpointFile.read(magic, 4) || !equal(magic, magic + 4, checkpointMagic)) return false;
+	if (readBinary<uint32_t>(checkpointFile) != journalVersion) return false;
+	generation = readBinary<uint64_t>(checkpointFile);
+
+	shared_ptr<EntityManager> entities = environment.getEntityManager();
+
+	// Entities, the ones missing from the checkpoint are removed.
+	unordered_set<string> names;
+	uint32_t nbEntities = readBinary<uint32_t>(checkpointFile);
+	for (uint32_t i = 0; i < nbEntities; ++i) {
+		string name = binaryToString(checkpointFile);
+		int ID = entities->getEntity(name);
+		if (ID == -1) ID = environment.createEntity(name, false, false);
+
+		uint32_t nbTags = readBinary<uint32_t>(checkpointFile);
+		for (uint32_t j = 0; j < nbTags; ++j) {
+			entities->addTag(ID, binaryToString(checkpointFile));
+		}
+		names.insert(move(name));
+	}
+	for (const auto& name : entities->getNames()) {
+		if (!names.contains(name)) environment.removeEntity(name, false);
+	}
+
+	// Subscriptions, the ones missing from the checkpoint are removed.
+	uint32_t nbManagers = readBinary<uint32_t>(checkpointFile);
+	for (uint32_t i = 0; i < nbManagers; ++i) {
+		shared_ptr<ComponentManager> manager = environment.getManager(binaryToString(checkpointFile));
+
+		unordered_set<int> subscribed;
+		uint32_t nbSubscribed = readBinary<uint32_t>(checkpointFile);
+		for (uint32_t j = 0; j < nbSubscribed; ++j) {
+			int ID = entities->getEntity(binaryToString(checkpointFile));
+			bool state = readBinary<uint8_t>(checkpointFile) != 0;
+
+			dataVector data;
+			uint32_t nbData = readBinary<uint32_t>(checkpointFile);
+			for (uint32_t k = 0; k < nbData; ++k) {
+				string key = binaryToString(checkpointFile);
+				data.emplace_back(move(key), binaryToValue(checkpointFile));
+			}
+
+			if (!manager || ID == -1) continue; // Unknown component or entity, skipped.
+			manager->subscribe(ID, data);
+			manager->setState(ID, state);
+			subscribed.insert(ID);
+		}
+
+		if (!manager) continue;
+		for (int entity : manager->getEntities(false)) {
+			if (!subscribed.contains(entity)) manager->unsubscribe(entity);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,151 @@
+#include "Operation.h"
+#include "Environment.h"
+
+using namespace std;
+
+const char* operationName(Operation operation) {
+	switch (operation) {
+	case Operation::CreateEntity: return "CreateEntity";
+	case Operation::RemoveEntity: return "RemoveEntity";
+	case Operation::AddTag: return "AddTag";
+	case Operation::Subscribe: return "Subscribe";
+	case Operation::Unsubscribe: return "Unsubscribe";
+	case Operation::SetState: return "SetState";
+	case Operation::Set: return "Set";
+	case Operation::RunSystem: return "RunSystem";
+	}
+	return "Unknown";
+}
+
+Operation applyOperation(Environment& environment, const string& content) {
+	istringstream record(content);
+	uint8_t type = readBinary<uint8_t>(record);
+	if (type == 0 || type >= operationCount) throw runtime_error("Error : invalid operation " + to_string(type) + ".");
+	Operation operation = static_cast<Operation>(type);
+	string name = binaryToString(record);
+
+	switch (operation) {
+	case Operation::CreateEntity:
+		environment.createEntity(name, false, false);
+		return operation;
+	case Operation::RemoveEntity:
+		environment.removeEntity(name, false);
+		return operation;
+	case Operation::AddTag:
+		environment.addTag(name, binaryToString(record), false);
+		return operation;
+	case Operation::RunSystem:
+		return operation;
+	default:
+		break;
+	}
+
+	// Component's operations.
+	int ID = environment.getEntity(name);
+	shared_ptr<ComponentManager> manager = environment.getManager(binaryToString(record));
+	if (ID == -1 || !manager) return operation;
+
+	switch (operation) {
+	case Operation::Subscribe: {
+		bool state = readBinary<uint8_t>(record) != 0;
+		dataVector data;
+		uint32_t nbData = readBinary<uint32_t>(record);
+		for (uint32_t i = 0; i < nbData; ++i) {
+			string key = binaryToString(record);
+			data.emplace_back(move(key), binaryToValue(record));
+		}
+		manager->subscribe(ID, data);
+		manager->setState(ID, state);
+		break;
+	}
+	case Operation::Unsubscribe:
+		manager->unsubscribe(ID);
+		break;
+	case Operation::SetState:
+		manager->setState(ID, readBinary<uint8_t>(record) != 0);
+		break;
+	case Operation::Set: {
+		string key = binaryToString(record);
+		manager->getComponent(ID)->set(key, binaryToValue(record));
+		break;
+	}
+	default:
+		throw runtime_error("Error : invalid operation " + to_string(static_cast<int>(operation)) + ".");
+	}
+	return operation;
+}
+
+OperationListener::OperationListener(shared_ptr<EntityManager> entityManager) : entityManager(entityManager) {
+}
+
+void OperationListener::onCreate(EntityManager& manager, int entity, const string& name) {
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::CreateEntity));
+	stringToBinary(record, name);
+	write(record.str());
+}
+
+void OperationListener::onRemove(EntityManager& manager, int entity, const string& name) {
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::RemoveEntity));
+	stringToBinary(record, name);
+	write(record.str());
+}
+
+void OperationListener::onTag(EntityManager& manager, int entity, const string& tag) {
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::AddTag));
+	stringToBinary(record, manager.getName(entity));
+	stringToBinary(record, tag);
+	write(record.str());
+}
+
+void OperationListener::onSubscribe(ComponentManager& manager, int entity) {
+	shared_ptr<Component> component = manager.getComponent(entity);
+
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::Subscribe));
+	stringToBinary(record, entityManager->getName(entity));
+	stringToBinary(record, manager.getName());
+	writeBinary<uint8_t>(record, manager.getState(entity) ? 1 : 0);
+
+	// The whole data is recorded, the subscription may come with its own values.
+	dataUnMap data = component->copyRawData();
+	writeBinary<uint32_t>(record, static_cast<uint32_t>(data.size()));
+	for (const auto& [key, value] : data) {
+		stringToBinary(record, key);
+		valueToBinary(record, value.second);
+	}
+	write(record.str());
+}
+
+void OperationListener::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::Unsubscribe));
+	stringToBinary(record, entityManager->getName(entity));
+	stringToBinary(record, manager.getName());
+	write(record.str());
+}
+
+void OperationListener::onStateChange(ComponentManager& manager, int entity, bool oldState) {
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::SetState));
+	stringToBinary(record, entityManager->getName(entity));
+	stringToBinary(record, manager.getName());
+	writeBinary<uint8_t>(record, oldState ? 0 : 1);
+	write(record.str());
+}
+
+void OperationListener::afterSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	// Copied under the component's lock, another thread can write it meanwhile.
+	optional<variant<ECS_Types>> value = component.copyValue(name);
+	if (!value) return;
+
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::Set));
+	stringToBinary(record, entityManager->getName(entity));
+	stringToBinary(record, manager.getName());
+	stringToBinary(record, name);
+	valueToBinary(record, *value);
+	write(record.str());
+}
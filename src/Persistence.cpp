@@ -0,0 +1,83 @@
+#include "Persistence.h"
+
+using namespace std;
+
+PersistenceService::PersistenceService(size_t maxPending) : maxPending(max<size_t>(maxPending, 1)), busy(false), stop(false) {
+	worker = thread([this]() { this->run(); });
+}
+
+PersistenceService::~PersistenceService() {
+	{
+		scoped_lock lock(mtx);
+		stop = true;
+	}
+	notEmpty.notify_all();
+	worker.join(); // The pending images are written before the thread ends.
+}
+
+shared_future<void> PersistenceService::submit(EntityImage image) {
+	unique_lock lock(mtx);
+
+	// The same path can be submitted by another thread during the wait, it is then coalesced too.
+	notFull.wait(lock, [this, &image]() { return pending.size() < maxPending || pending.contains(image.path); });
+
+	// Coalescing, the waiting image is just replaced.
+	auto it = pending.find(image.path);
+	if (it != pending.end()) {
+		it->second.image = move(image);
+		return it->second.future;
+	}
+
+	string path = image.path;
+	Job& job = pending[path];
+	job.image = move(image);
+	job.future = job.promise.get_future().share();
+	order.push_back(path);
+
+	shared_future<void> future = job.future;
+	lock.unlock();
+	notEmpty.notify_one();
+
+	return future;
+}
+
+void PersistenceService::flush() {
+	unique_lock lock(mtx);
+	idle.wait(lock, [this]() { return pending.empty() && !busy; });
+}
+
+size_t PersistenceService::getPending() {
+	scoped_lock lock(mtx);
+	return pending.size();
+}
+
+void PersistenceService::run() {
+	while (true) {
+		Job job;
+		{
+			unique_lock lock(mtx);
+			notEmpty.wait(lock, [this]() { return stop || !pending.empty(); });
+			if (pending.empty()) return; // Stopped, and nothing left.
+
+			auto node = pending.extract(order.front());
+			order.pop_front();
+			job = move(node.mapped());
+			busy = true;
+		}
+		notFull.notify_one();
+
+		try {
+			Subscription::write(job.image);
+			job.promise.set_value();
+		}
+		catch (...) {
+			job.promise.set_exception(current_exception());
+		}
+
+		{
+			scoped_lock lock(mtx);
+			busy = false;
+		}
+		idle.notify_all();
+	}
+}
@@ -0,0 +1,87 @@
+#include "Recorder.h"
+
+using namespace std;
+
+namespace {
+	const char traceMagic[4] = { 'T', 'M', 'T', 'R' };
+	const uint32_t traceVersion = 2;
+}
+
+Recorder::Recorder(const string& path, shared_ptr<EntityManager> entityManager) : OperationListener(entityManager), file(path, ios::binary | ios::trunc), count(0), suspended(0) {
+	if (!file) {
+		throw runtime_error("Error : Can't write the file \"" + path + "\"");
+	}
+	file.write(traceMagic, 4);
+	writeBinary<uint32_t>(file, traceVersion);
+}
+
+Recorder::~Recorder() {
+	flush();
+}
+
+void Recorder::recordRun(const string& system) {
+	ostringstream record;
+	writeBinary<uint8_t>(record, static_cast<uint8_t>(Operation::RunSystem));
+	stringToBinary(record, system);
+	append(record.str());
+}
+
+void Recorder::suspend() {
+	++suspended;
+}
+
+void Recorder::resume() {
+	--suspended;
+}
+
+void Recorder::flush() {
+	scoped_lock lock(mtx);
+	file.flush();
+}
+
+size_t Recorder::getCount() {
+	scoped_lock lock(mtx);
+	return count;
+}
+
+void Recorder::write(const string& record) {
+	if (suspended > 0) return;
+	append(record);
+}
+
+void Recorder::append(const string& record) {
+	scoped_lock lock(mtx);
+	// Size and checksum first, as in the Journal.
+	writeBinary<uint32_t>(file, static_cast<uint32_t>(record.size()));
+	writeBinary<uint64_t>(file, hashBytes(record.data(), record.size()));
+	file.write(record.data(), record.size());
+	++count;
+}
+
+vector<string> readTrace(const string& path) {
+	ifstream file(path, ios::binary);
+	if (!file) {
+		throw runtime_error("Error : Can't read the file \"" + path + "\"");
+	}
+
+	char magic[4];
+	if (!file.read(magic, 4) || !equal(magic, magic + 4, traceMagic) || readBinary<uint32_t>(file) != traceVersion) {
+		throw runtime_error("Error : \"" + path + "\" is not a valid trace.");
+	}
+
+	vector<string> records;
+	while (file.peek() != EOF) {
+		uint32_t size = readBinary<uint32_t>(file);
+		uint64_t checksum = readBinary<uint64_t>(file);
+		string record(size, '\0');
+		if (!file.read(record.data(), size)) {
+			throw runtime_error("Error : unexpected end of the trace \"" + path + "\".");
+		}
+		uint8_t operation = record.empty() ? 0 : static_cast<uint8_t>(record[0]);
+		if (hashBytes(record.data(), record.size()) != checksum || operation == 0 || operation >= operationCount) {
+			throw runtime_error("Error : broken record " + to_string(records.size()) + " in the trace \"" + path + "\".");
+		}
+		records.push_back(move(record));
+	}
+	return records;
+}
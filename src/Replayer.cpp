@@ -0,0 +1,88 @@
+#include "Replayer.h"
+#include <chrono>
+
+using namespace std;
+
+void ReplayReport::toString(ostream& stream) const {
+	stringstream ss;
+	ss << "Replay: " << count << " operations in " << duration << " s";
+	if (duration > 0.0) ss << " (" << static_cast<size_t>(count / duration) << " op/s)";
+	ss << endl;
+
+	for (size_t i = 1; i < operations.size(); ++i) {
+		const OperationStats& stats = operations[i];
+		if (stats.count == 0) continue;
+
+		ss << "    " << operationName(static_cast<Operation>(i)) << ": " << stats.count << " op";
+		if (stats.total > 0.0) ss << ", " << static_cast<size_t>(stats.count / (stats.total / 1e6)) << " op/s";
+		ss << ", p50: " << stats.p50 << " us, p90: " << stats.p90 << " us, p99: " << stats.p99 << " us, max: " << stats.max << " us" << endl;
+	}
+
+	stream << ss.str();
+}
+
+Replayer::Replayer(shared_ptr<Environment> environment) : environment(environment) {
+}
+
+void Replayer::addSystem(const string& name, shared_ptr<System> system) {
+	systems[name] = system;
+}
+
+ReplayReport Replayer::run(const string& path) {
+	using clock = chrono::steady_clock;
+
+	vector<string> records = readTrace(path);
+	array<vector<double>, operationCount> latencies;
+	for (auto& latency : latencies) {
+		latency.reserve(records.size() / 4);
+	}
+
+	ReplayReport report;
+	clock::time_point replayStart = clock::now();
+
+	for (const auto& record : records) {
+		clock::time_point start = clock::now();
+		Operation operation;
+
+		try {
+			operation = applyOperation(*environment, record);
+
+			if (operation == Operation::RunSystem) {
+				istringstream content(record);
+				readBinary<uint8_t>(content);
+				auto it = systems.find(binaryToString(content));
+				if (it != systems.end()) it->second->run();
+			}
+		}
+		catch (exception& e) {
+			cerr << "Replayer : " << e.what() << endl;
+			continue;
+		}
+
+		double latency = chrono::duration<double, micro>(clock::now() - start).count();
+		latencies[static_cast<size_t>(operation)].push_back(latency);
+	}
+
+	report.duration = chrono::duration<double>(clock::now() - replayStart).count();
+
+	// Percentiles of each type of operation.
+	for (size_t i = 0; i < latencies.size(); ++i) {
+		vector<double>& latency = latencies[i];
+		if (latency.empty()) continue;
+
+		sort(latency.begin(), latency.end());
+		OperationStats& stats = report.operations[i];
+		stats.count = latency.size();
+		for (double value : latency) {
+			stats.total += value;
+		}
+		auto percentile = [&latency](double p) { return latency[static_cast<size_t>(p * (latency.size() - 1))]; };
+		stats.p50 = percentile(0.50);
+		stats.p90 = percentile(0.90);
+		stats.p99 = percentile(0.99);
+		stats.max = latency.back();
+		report.count += stats.count;
+	}
+
+	return report;
+}
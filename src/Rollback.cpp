@@ -0,0 +1,209 @@
+#include "Rollback.h"
+
+using namespace std;
+
+RollbackBuffer::RollbackBuffer(size_t capacity, size_t memoryBudget) : frames(capacity), head(0), count(0), latest(0), memoryBudget(memoryBudget), memoryUsage(0), rewinding(false) {
+}
+
+size_t RollbackBuffer::captureFrame() {
+	scoped_lock lock(mtx);
+
+	if (latest != 0 && !frames.empty()) {
+		// The oldest slot is recycled when the ring is full, the vectors keep their capacity.
+		if (count == frames.size()) dropOldest();
+
+		FrameDiff& slot = frames[(head + count) % frames.size()];
+		swap(slot, current);
+		memoryUsage += slot.bytes;
+		++count;
+
+		// The budget only trims the history, the latest diff is always kept.
+		while (memoryBudget != 0 && memoryUsage > memoryBudget && count > 1) {
+			dropOldest();
+		}
+	}
+
+	current.records.clear();
+	current.written.clear();
+	current.bytes = 0;
+
+	return ++latest;
+}
+
+bool RollbackBuffer::rewindTo(size_t frame, unordered_set<int>& touched) {
+	vector<FrameDiff> toUndo;
+	{
+		scoped_lock lock(mtx);
+		if (latest == 0 || frame > latest || frame < latest - count) return false;
+
+		// Newest first: the open frame, then the sealed ones down to the given frame.
+		toUndo.push_back(move(current));
+		current = FrameDiff();
+		for (size_t i = latest; i > frame; --i) {
+			FrameDiff& slot = frames[(head + count - 1) % frames.size()];
+			memoryUsage -= slot.bytes;
+			toUndo.push_back(move(slot));
+			slot = FrameDiff();
+			--count;
+		}
+		latest = frame;
+		rewinding = true;
+	}
+
+	// Applied outside of the lock, the managers call back the listeners.
+	for (auto& diff : toUndo) {
+		undo(diff, touched);
+	}
+	rewinding = false;
+
+	return true;
+}
+
+size_t RollbackBuffer::getFrame() {
+	scoped_lock lock(mtx);
+	return latest;
+}
+
+size_t RollbackBuffer::getOldestFrame() {
+	scoped_lock lock(mtx);
+	return latest - count;
+}
+
+size_t RollbackBuffer::getMemoryUsage() {
+	scoped_lock lock(mtx);
+	return memoryUsage + current.bytes;
+}
+
+void RollbackBuffer::resize(size_t capacity, size_t memoryBudget) {
+	scoped_lock lock(mtx);
+	frames = vector<FrameDiff>(capacity);
+	this->memoryBudget = memoryBudget;
+	head = 0;
+	count = 0;
+	memoryUsage = 0;
+	current = FrameDiff();
+}
+
+void RollbackBuffer::clear() {
+	scoped_lock lock(mtx);
+	for (auto& frame : frames) {
+		frame.records.clear();
+		frame.written.clear();
+		frame.bytes = 0;
+	}
+	head = 0;
+	count = 0;
+	latest = 0;
+	memoryUsage = 0;
+	current = FrameDiff();
+}
+
+void RollbackBuffer::forget(const ComponentManager* manager) {
+	scoped_lock lock(mtx);
+	for (size_t i = 0; i < count; ++i) {
+		memoryUsage -= forget(frames[(head + i) % frames.size()], manager);
+	}
+	forget(current, manager);
+}
+
+void RollbackBuffer::onSubscribe(ComponentManager& manager, int entity) {
+	if (rewinding) return;
+	record({ RecordType::Subscribe, &manager, entity, nullptr, true, {} });
+}
+
+void RollbackBuffer::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	if (rewinding) return;
+	record({ RecordType::Unsubscribe, &manager, entity, component, state, {} });
+}
+
+void RollbackBuffer::onStateChange(ComponentManager& manager, int entity, bool oldState) {
+	if (rewinding) return;
+	record({ RecordType::State, &manager, entity, nullptr, oldState, {} });
+}
+
+void RollbackBuffer::beforeSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	if (rewinding) return;
+	{
+		scoped_lock lock(mtx);
+		if (latest == 0 || current.written.contains(&component)) return; // Already saved during this frame.
+		current.written.insert(&component);
+	}
+
+	// The whole component is saved, once per frame.
+	// Copied under the component's lock, another thread can write it meanwhile.
+	dataVector data;
+	dataUnMap rawData = component.copyRawData();
+	data.reserve(rawData.size());
+	for (const auto& [key, value] : rawData) {
+		data.emplace_back(key, value.second);
+	}
+
+	record({ RecordType::Data, &manager, entity, component.shared_from_this(), true, move(data) });
+}
+
+void RollbackBuffer::record(Record&& record) {
+	size_t bytes = sizeOf(record);
+
+	scoped_lock lock(mtx);
+	if (latest == 0) return; // Nothing to go back to yet.
+	current.records.push_back(move(record));
+	current.bytes += bytes;
+}
+
+void RollbackBuffer::dropOldest() {
+	FrameDiff& slot = frames[head];
+	memoryUsage -= slot.bytes;
+	slot.records.clear();
+	slot.written.clear();
+	slot.bytes = 0;
+	head = (head + 1) % frames.size();
+	--count;
+}
+
+size_t RollbackBuffer::sizeOf(const Record& record) {
+	// Approximation of the memory used by the record.
+	size_t bytes = sizeof(Record);
+	for (const auto& [name, _] : record.data) {
+		bytes += sizeof(pair<string, variant<ECS_Types>>) + name.capacity();
+	}
+	return bytes;
+}
+
+size_t RollbackBuffer::forget(FrameDiff& diff, const ComponentManager* manager) {
+	size_t bytes = 0;
+	erase_if(diff.records, [&diff, &bytes, manager](const Record& record) {
+		if (record.manager != manager) return false;
+		// The component may be freed with the manager, its address must not hide a later component.
+		if (record.component) diff.written.erase(record.component.get());
+		bytes += sizeOf(record);
+		return true;
+	});
+	diff.bytes -= bytes;
+	return bytes;
+}
+
+void RollbackBuffer::undo(FrameDiff& diff, unordered_set<int>& touched) {
+	for (auto it = diff.records.rbegin(); it != diff.records.rend(); ++it) {
+		Record& record = *it;
+
+		switch (record.type) {
+		case RecordType::Data:
+			for (const auto& [name, value] : record.data) {
+				record.component->set(name, value);
+			}
+			break;
+		case RecordType::State:
+			record.manager->setState(record.entity, record.state);
+			touched.insert(record.entity);
+			break;
+		case RecordType::Subscribe:
+			record.manager->unsubscribe(record.entity);
+			touched.insert(record.entity);
+			break;
+		case RecordType::Unsubscribe:
+			record.manager->attach(record.entity, record.component, record.state);
+			touched.insert(record.entity);
+			break;
+		}
+	}
+}
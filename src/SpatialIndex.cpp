@@ -0,0 +1,520 @@
+/**
+ * @file SpatialIndex.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <SpatialIndex.h>
+#include <ThreadPool.h>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+
+/**
+ * Below this number of positions, the tree is not worth building again.
+ */
+constexpr size_t minOutdated = 256;
+
+inline float coordinate(const Vector3& v, size_t axis) {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+inline float squaredDistance(const Vector3& a, const Vector3& b) {
+	Vector3 d = a - b;
+	return d * d;
+}
+
+inline bool inside(const Vector3& p, const Vector3& min, const Vector3& max) {
+	return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+}
+
+/**
+ * Grid's coordinate of a position's coordinate, clamped so the huge ones don't overflow.
+ */
+inline int64_t cellCoordinate(float value, float cellSize) {
+	double cell = floor(static_cast<double>(value) / cellSize);
+	return static_cast<int64_t>(clamp(cell, -1e9, 1e9));
+}
+
+/**
+ * Key of a grid's cell, 21 bits per coordinate. Far cells can share a key, the positions are checked anyway.
+ */
+inline uint64_t packCell(int64_t x, int64_t y, int64_t z) {
+	constexpr uint64_t mask = (1ull << 21) - 1;
+	return ((static_cast<uint64_t>(x) & mask) << 42) | ((static_cast<uint64_t>(y) & mask) << 21) | (static_cast<uint64_t>(z) & mask);
+}
+
+/**
+ * Sort a range of the tree: its median on the axis of its depth, then both halves.
+ */
+template<typename Items>
+void buildRange(Items& tree, size_t begin, size_t end, size_t depth, size_t dimensions) {
+	while (end - begin > 1) {
+		size_t middle = begin + (end - begin) / 2;
+		size_t axis = depth % dimensions;
+		nth_element(tree.begin() + begin, tree.begin() + middle, tree.begin() + end, [axis](const auto& a, const auto& b) {
+			return coordinate(a.position, axis) < coordinate(b.position, axis);
+		});
+		buildRange(tree, begin, middle, depth + 1, dimensions);
+		begin = middle + 1;
+		++depth;
+	}
+}
+
+}
+
+SpatialIndex::SpatialIndex(shared_ptr<ComponentManager> manager, const string& field, SpatialLayout layout, float cellSize) : manager(manager), field(field), layout(layout), cellSize(cellSize) {
+	if (!manager) throw runtime_error("Error : a spatial index needs a manager.");
+	if (cellSize <= 0.0f) throw runtime_error("Error : the cells of a spatial index should have a positive size.");
+	rebuild();
+}
+
+vector<int> SpatialIndex::queryRadius(const Vector3& center, float radius, bool checkState) {
+	refresh();
+	shared_lock lock(mtx);
+
+	vector<int> result;
+	float squaredRadius = radius * radius;
+	visitBox({ center.x - radius, center.y - radius, center.z - radius }, { center.x + radius, center.y + radius, center.z + radius }, [&](int entity, const Vector3& position, bool active) {
+		if ((active || !checkState) && squaredDistance(position, center) <= squaredRadius) result.push_back(entity);
+	});
+	return result;
+}
+
+vector<int> SpatialIndex::queryRadius(const Vector2& center, float radius, bool checkState) {
+	return queryRadius(Vector3{ center.x, center.y, 0.0f }, radius, checkState);
+}
+
+vector<int> SpatialIndex::queryBox(const Vector3& min, const Vector3& max, bool checkState) {
+	refresh();
+	shared_lock lock(mtx);
+
+	vector<int> result;
+	visitBox(min, max, [&](int entity, const Vector3& position, bool active) {
+		if ((active || !checkState) && inside(position, min, max)) result.push_back(entity);
+	});
+	return result;
+}
+
+vector<int> SpatialIndex::queryBox(const Vector2& min, const Vector2& max, bool checkState) {
+	return queryBox(Vector3{ min.x, min.y, 0.0f }, Vector3{ max.x, max.y, 0.0f }, checkState);
+}
+
+vector<int> SpatialIndex::queryNearest(const Vector3& point, size_t k, bool checkState) {
+	if (k == 0) return {};
+	refresh();
+	shared_lock lock(mtx);
+
+	// Max-heap of the k nearest found, the farthest on top.
+	vector<pair<float, int>> heap;
+	auto keep = [&](int entity, const Vector3& position, bool active) {
+		if (!active && checkState) return;
+		float distance = squaredDistance(position, point);
+		if (heap.size() < k) {
+			heap.push_back({ distance, entity });
+			push_heap(heap.begin(), heap.end());
+		}
+		else if (distance < heap.front().first) {
+			pop_heap(heap.begin(), heap.end());
+			heap.back() = { distance, entity };
+			push_heap(heap.begin(), heap.end());
+		}
+	};
+
+	if (layout == SpatialLayout::Tree) {
+		nearestInTree(0, tree.size(), 0, point, k, checkState, heap);
+		for (int entity : pending) {
+			const Entry& entry = entries.at(entity);
+			keep(entity, entry.position, entry.active);
+		}
+	}
+	else {
+		// Boxes twice bigger each time, until the k nearest are found inside the radius (a farther entity could be in a corner).
+		for (float radius = cellSize; ; radius *= 2.0f) {
+			heap.clear();
+			bool all = visitBox({ point.x - radius, point.y - radius, point.z - radius }, { point.x + radius, point.y + radius, point.z + radius }, keep);
+			if (all || (heap.size() == k && heap.front().first <= radius * radius)) break;
+		}
+	}
+
+	sort_heap(heap.begin(), heap.end());
+	vector<int> result;
+	result.reserve(heap.size());
+	for (const auto& [_, entity] : heap) {
+		result.push_back(entity);
+	}
+	return result;
+}
+
+vector<int> SpatialIndex::queryNearest(const Vector2& point, size_t k, bool checkState) {
+	return queryNearest(Vector3{ point.x, point.y, 0.0f }, k, checkState);
+}
+
+void SpatialIndex::suspend() {
+	suspended = true;
+}
+
+void SpatialIndex::rebuild() {
+	shared_ptr<ComponentManager> manager = this->manager.lock();
+	if (!manager) throw runtime_error("Error : the manager of the spatial index doesn't exist anymore.");
+
+	// The data's type is checked again, the manager may have been reshaped.
+	size_t typeID = manager->getTypeID(field);
+	if (typeID != typeToID("vector2") && typeID != typeToID("vector3")) {
+		throw runtime_error("Error : the data \"" + field + "\" of \"" + manager->getName() + "\" is not a Vector2 or a Vector3.");
+	}
+	is3D = typeID == typeToID("vector3");
+
+	// One lock of the manager for the whole snapshot, the components are read outside of it.
+	vector<int> entities;
+	vector<shared_ptr<Component>> components;
+	vector<char> states;
+	{
+		scoped_lock lock(manager->mtx);
+		entities.reserve(manager->mapEC.size());
+		components.reserve(manager->mapEC.size());
+		states.reserve(manager->mapEC.size());
+		for (const auto& [entity, value] : manager->mapEC) {
+			entities.push_back(entity);
+			components.push_back(value.first);
+			states.push_back(value.second);
+		}
+	}
+
+	vector<Vector3> positions(entities.size());
+	ThreadPool::global().parallelFor(entities.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			positions[i] = read(*components[i]);
+		}
+	}, 1024);
+
+	unique_lock lock(mtx);
+	// The entries are updated in place, only the entities which changed of cell are moved in the grid. The tree is built again anyway.
+	for (size_t i = 0; i < entities.size(); ++i) {
+		auto found = entries.find(entities[i]);
+		if (layout == SpatialLayout::Tree) {
+			if (found == entries.end()) entries[entities[i]] = { positions[i], states[i] != 0, false, 0, 0 };
+			else found->second = { positions[i], states[i] != 0, false, 0, 0 };
+		}
+		else if (found == entries.end()) {
+			insert(entities[i], positions[i], states[i]);
+		}
+		else {
+			setActive(found->second, states[i]);
+			move(entities[i], found->second, positions[i]);
+		}
+	}
+
+	if (entries.size() != entities.size()) {
+		unordered_set<int> kept(entities.begin(), entities.end());
+		vector<int> removed;
+		for (const auto& [entity, _] : entries) {
+			if (!kept.contains(entity)) removed.push_back(entity);
+		}
+		for (int entity : removed) {
+			remove(entity);
+		}
+	}
+
+	if (layout == SpatialLayout::Tree) buildTree();
+	suspended = false;
+}
+
+size_t SpatialIndex::size() {
+	shared_lock lock(mtx);
+	return entries.size();
+}
+
+const string& SpatialIndex::getField() {
+	return field;
+}
+
+shared_ptr<ComponentManager> SpatialIndex::getManager() {
+	return manager.lock();
+}
+
+void SpatialIndex::onSubscribe(ComponentManager& manager, int entity) {
+	// Already unsubscribed by another listener of the notification.
+	if (!manager.hasEntity(entity, true)) return;
+	shared_ptr<Component> component = manager.getComponent(entity);
+	Vector3 position = read(*component);
+	bool state = manager.getState(entity);
+
+	unique_lock lock(mtx);
+	insert(entity, position, state);
+}
+
+void SpatialIndex::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	unique_lock lock(mtx);
+	remove(entity);
+}
+
+void SpatialIndex::onStateChange(ComponentManager& manager, int entity, bool oldState) {
+	unique_lock lock(mtx);
+	auto found = entries.find(entity);
+	if (found != entries.end()) setActive(found->second, !oldState);
+}
+
+void SpatialIndex::afterSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	if (suspended || name != field) return;
+	Vector3 position = read(component);
+
+	unique_lock lock(mtx);
+	auto found = entries.find(entity);
+	if (found != entries.end()) move(entity, found->second, position);
+}
+
+Vector3 SpatialIndex::read(Component& component) {
+	if (is3D) return component.get<Vector3>(field);
+	Vector2 position = component.get<Vector2>(field);
+	return { position.x, position.y, 0.0f };
+}
+
+uint64_t SpatialIndex::cellOf(const Vector3& position) {
+	return packCell(cellCoordinate(position.x, cellSize), cellCoordinate(position.y, cellSize), cellCoordinate(position.z, cellSize));
+}
+
+void SpatialIndex::insert(int entity, const Vector3& position, bool active) {
+	auto found = entries.find(entity);
+	if (found != entries.end()) {
+		// Attached again (e.g.: a rollback), only its values may have changed.
+		setActive(found->second, active);
+		move(entity, found->second, position);
+		return;
+	}
+
+	Entry& entry = entries[entity];
+	entry = { position, active, false, 0, 0 };
+	if (layout == SpatialLayout::Grid) {
+		link(entity, entry);
+	}
+	else {
+		pending.insert(entity);
+		checkOutdated();
+	}
+}
+
+void SpatialIndex::move(int entity, Entry& entry, const Vector3& position) {
+	entry.position = position;
+	if (layout == SpatialLayout::Grid) {
+		uint64_t cell = cellOf(position);
+		if (cell == entry.cell) {
+			cells[cell][entry.slot].position = position;
+			return;
+		}
+		unlink(entry);
+		link(entity, entry);
+	}
+	else if (entry.inTree) {
+		detach(entity, entry);
+	}
+}
+
+void SpatialIndex::setActive(Entry& entry, bool active) {
+	entry.active = active;
+	if (layout == SpatialLayout::Grid) cells[entry.cell][entry.slot].active = active;
+	else if (entry.inTree) tree[entry.slot].active = active;
+}
+
+void SpatialIndex::remove(int entity) {
+	auto found = entries.find(entity);
+	if (found == entries.end()) return;
+
+	if (layout == SpatialLayout::Grid) {
+		unlink(found->second);
+	}
+	else if (found->second.inTree) {
+		detach(entity, found->second);
+	}
+	pending.erase(entity);
+	entries.erase(found);
+}
+
+void SpatialIndex::link(int entity, Entry& entry) {
+	entry.cell = cellOf(entry.position);
+	vector<Item>& items = cells[entry.cell];
+	entry.slot = static_cast<uint32_t>(items.size());
+	items.push_back({ entry.position, entity, entry.active });
+}
+
+void SpatialIndex::unlink(Entry& entry) {
+	auto cell = cells.find(entry.cell);
+	vector<Item>& items = cell->second;
+	// The last entity of the cell takes the place of the removed one.
+	items[entry.slot] = items.back();
+	items.pop_back();
+	if (entry.slot < items.size()) entries[items[entry.slot].entity].slot = entry.slot;
+	if (items.empty()) cells.erase(cell);
+}
+
+void SpatialIndex::detach(int entity, Entry& entry) {
+	tree[entry.slot].entity = -1;
+	entry.inTree = false;
+	--current;
+	pending.insert(entity);
+	checkOutdated();
+}
+
+void SpatialIndex::buildTree() {
+	tree.clear();
+	pending.clear();
+	current = 0;
+	outdated = false;
+
+	tree.reserve(entries.size());
+	for (const auto& [entity, entry] : entries) {
+		tree.push_back({ entry.position, entity, entry.active });
+	}
+
+	// The first levels are split on this thread, then the ranges are sorted over the pool.
+	size_t dimensions = is3D ? 3 : 2;
+	vector<tuple<size_t, size_t, size_t>> ranges = { { 0, tree.size(), 0 } };
+	size_t wanted = ThreadPool::global().getSize() * 4;
+	while (ranges.size() < wanted && tree.size() > minOutdated * wanted) {
+		vector<tuple<size_t, size_t, size_t>> next;
+		for (const auto& [begin, end, depth] : ranges) {
+			size_t middle = begin + (end - begin) / 2;
+			size_t axis = depth % dimensions;
+			nth_element(tree.begin() + begin, tree.begin() + middle, tree.begin() + end, [axis](const Item& a, const Item& b) {
+				return coordinate(a.position, axis) < coordinate(b.position, axis);
+			});
+			next.push_back({ begin, middle, depth + 1 });
+			next.push_back({ middle + 1, end, depth + 1 });
+		}
+		ranges = std::move(next);
+	}
+
+	ThreadPool::global().parallelFor(ranges.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			buildRange(tree, get<0>(ranges[i]), get<1>(ranges[i]), get<2>(ranges[i]), dimensions);
+		}
+	});
+
+	// The entries are only written, each by one thread.
+	ThreadPool::global().parallelFor(tree.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			Entry& entry = entries.find(tree[i].entity)->second;
+			entry.inTree = true;
+			entry.slot = static_cast<uint32_t>(i);
+		}
+	}, 4096);
+	current = tree.size();
+}
+
+void SpatialIndex::refresh() {
+	if (!outdated) return;
+	unique_lock lock(mtx);
+	if (outdated) buildTree();
+}
+
+void SpatialIndex::checkOutdated() {
+	size_t stale = pending.size() + (tree.size() - current);
+	if (stale > max(minOutdated, tree.size() / 4)) outdated = true;
+}
+
+template<typename Visit>
+bool SpatialIndex::visitBox(const Vector3& min, const Vector3& max, Visit visit) {
+	if (layout == SpatialLayout::Tree) {
+		auto visitItem = [&visit](const Item& item) {
+			if (item.entity >= 0) visit(item.entity, item.position, item.active);
+		};
+		visitTree(0, tree.size(), 0, min, max, visitItem);
+		for (int entity : pending) {
+			const Entry& entry = entries.at(entity);
+			visit(entity, entry.position, entry.active);
+		}
+		return false;
+	}
+
+	int64_t fromX = cellCoordinate(min.x, cellSize), toX = cellCoordinate(max.x, cellSize);
+	int64_t fromY = cellCoordinate(min.y, cellSize), toY = cellCoordinate(max.y, cellSize);
+	int64_t fromZ = cellCoordinate(min.z, cellSize), toZ = cellCoordinate(max.z, cellSize);
+	double count = static_cast<double>(toX - fromX + 1) * static_cast<double>(toY - fromY + 1) * static_cast<double>(toZ - fromZ + 1);
+
+	// More cells in the box than cells used, every cell is visited.
+	if (count >= static_cast<double>(cells.size())) {
+		for (const auto& [_, items] : cells) {
+			for (const Item& item : items) {
+				visit(item.entity, item.position, item.active);
+			}
+		}
+		return true;
+	}
+
+	for (int64_t x = fromX; x <= toX; ++x) {
+		for (int64_t y = fromY; y <= toY; ++y) {
+			for (int64_t z = fromZ; z <= toZ; ++z) {
+				auto cell = cells.find(packCell(x, y, z));
+				if (cell == cells.end()) continue;
+				for (const Item& item : cell->second) {
+					visit(item.entity, item.position, item.active);
+				}
+			}
+		}
+	}
+	return false;
+}
+
+template<typename Visit>
+void SpatialIndex::visitTree(size_t begin, size_t end, size_t depth, const Vector3& min, const Vector3& max, Visit& visit) {
+	size_t dimensions = is3D ? 3 : 2;
+	while (begin < end) {
+		size_t middle = begin + (end - begin) / 2;
+		size_t axis = depth % dimensions;
+		const Item& item = tree[middle];
+		visit(item);
+
+		// The lower half is below or at the median, the upper half above or at it.
+		float value = coordinate(item.position, axis);
+		bool lower = coordinate(min, axis) <= value;
+		bool upper = coordinate(max, axis) >= value;
+		++depth;
+		if (lower && upper) {
+			visitTree(begin, middle, depth, min, max, visit);
+			begin = middle + 1;
+		}
+		else if (lower) {
+			end = middle;
+		}
+		else if (upper) {
+			begin = middle + 1;
+		}
+		else {
+			return;
+		}
+	}
+}
+
+void SpatialIndex::nearestInTree(size_t begin, size_t end, size_t depth, const Vector3& point, size_t k, bool checkState, vector<pair<float, int>>& heap) {
+	if (begin >= end) return;
+	size_t middle = begin + (end - begin) / 2;
+	size_t axis = depth % (is3D ? 3 : 2);
+	const Item& item = tree[middle];
+
+	if (item.entity >= 0 && (item.active || !checkState)) {
+		float distance = squaredDistance(item.position, point);
+		if (heap.size() < k) {
+			heap.push_back({ distance, item.entity });
+			push_heap(heap.begin(), heap.end());
+		}
+		else if (distance < heap.front().first) {
+			pop_heap(heap.begin(), heap.end());
+			heap.back() = { distance, item.entity };
+			push_heap(heap.begin(), heap.end());
+		}
+	}
+
+	// The half of the point first, the other one only if it can be nearer than the k-th found.
+	float difference = coordinate(point, axis) - coordinate(item.position, axis);
+	bool lowerFirst = difference <= 0.0f;
+	if (lowerFirst) nearestInTree(begin, middle, depth + 1, point, k, checkState, heap);
+	else nearestInTree(middle + 1, end, depth + 1, point, k, checkState, heap);
+
+	if (heap.size() < k || difference * difference < heap.front().first) {
+		if (lowerFirst) nearestInTree(middle + 1, end, depth + 1, point, k, checkState, heap);
+		else nearestInTree(begin, middle, depth + 1, point, k, checkState, heap);
+	}
+}
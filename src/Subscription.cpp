@@ -6,101 +6,308 @@ Subscription::Subscription(const string& directory, shared_ptr<EntityManager> en
 
 	vector<string> files = getAllFilesFromDirectory(directory); // Return every files in the directory's folder and its sub-folders
 
-	for (const auto& file : files) {
-		ifstream subsFile(file);
+	// The files are read and parsed in parallel, then applied in their order so the result is always the same.
+	// The biggest ones are streamed instead, not to hold their whole content.
+	parsedFiles parsed = parseFiles(files, streamingFileSize);
 
-		nlohmann::json subsJSON = nlohmann::json::parse(subsFile);
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (parsed[i].second) rethrow_exception(parsed[i].second);
 
-		if (!subsJSON.contains("generated") && subsJSON.contains("entity")) {
-			entitiesFP[subsJSON["entity"]] = file;
-			// We skipped subscriptions for unknown entities
-			if (entityManager->getEntity(subsJSON["entity"]) == -1) continue;
+		if (parsed[i].first.is_discarded()) this->stream(files[i]);
+		else this->load(files[i], parsed[i].first);
+	}
+}
+
+Subscription::Subscription(const string& directory, shared_ptr<EntityManager> entityManager, shared_ptr<unorMapCM> compManagers, unordered_map<string, string> files) : directory(directory), entitiesFP(move(files)), entityManager(entityManager), managers(compManagers) {
+}
+
+void Subscription::load(const string& file, const nlohmann::json& subsJSON) {
+	// A combined file, its entities are saved back in their own files.
+	if (subsJSON.is_array()) {
+		for (const auto& entry : subsJSON) {
+			this->load("", entry);
 		}
+		return;
+	}
+
+	vector<int> IDs;
+	bool defaultState = true;
+	if (!this->resolve(file, subsJSON, IDs, defaultState)) return;
+
+	if (!subsJSON.contains("components")) return;
+
+	for (const auto& component : subsJSON["components"]) {
+		this->apply(component, IDs, defaultState);
+	}
+}
+
+void Subscription::stream(const string& file) {
+	using event = nlohmann::json::parse_event_t;
 
-		vector<int> IDs;
+	ifstream subsFile(file);
+	if (!subsFile) {
+		throw runtime_error("Error : Can't read the file \"" + file + "\"");
+	}
 
-		// Firstly, we check if its a tag attributed subscription.
-		if (subsJSON.contains("tags")) {
-			// Get every entities from that tag
-			vector<string> tags = subsJSON["tags"];
-			// We get every entities of the given tags
-			for (const auto& tag : tags) {
-				vector<int> localIDs = entityManager->getEntities(tag, false);
-				IDs.insert(IDs.end(), localIDs.begin(), localIDs.end());
+	// A combined file, each entry is applied once parsed, then dropped.
+	char first = ' ';
+	while (subsFile.get(first) && isspace(static_cast<unsigned char>(first))) {}
+	subsFile.clear();
+	subsFile.seekg(0);
+	if (first == '[') {
+		std::ignore = nlohmann::json::parse(subsFile, [this](int depth, event type, nlohmann::json& parsed) {
+			if (type == event::object_end && depth == 1) {
+				this->load("", parsed);
+				return false;
 			}
+			return true;
+		});
+		return;
+	}
+
+	// Everything but the components first, the targets must be known before applying them.
+	nlohmann::json header = nlohmann::json::parse(subsFile, [](int depth, event type, nlohmann::json& parsed) {
+		return !(type == event::key && depth == 1 && parsed == "components");
+	});
+
+	vector<int> IDs;
+	bool defaultState = true;
+	if (!this->resolve(file, header, IDs, defaultState)) return;
+
+	subsFile.close();
+	this->stream(file, IDs, defaultState);
+}
+
+void Subscription::stream(const string& file, const vector<int>& IDs, bool defaultState) {
+	using event = nlohmann::json::parse_event_t;
+
+	ifstream subsFile(file);
+	if (!subsFile) {
+		throw runtime_error("Error : Can't read the file \"" + file + "\"");
+	}
+
+	// Each component is applied once parsed, then dropped.
+	bool inComponents = false;
+	std::ignore = nlohmann::json::parse(subsFile, [&](int depth, event type, nlohmann::json& parsed) {
+		if (type == event::key && depth == 1) {
+			inComponents = parsed == "components";
+			return inComponents;
 		}
-		else if (subsJSON.contains("generated") && subsJSON["generated"]) {
-			// Search by prefix, for the generated entities
-			IDs = entityManager->getEntities(subsJSON["entity"]);
+		if (inComponents && type == event::object_end && depth == 2) {
+			this->apply(parsed, IDs, defaultState);
+			return false;
 		}
-		else {
-			// Otherwise, by complete name
-			IDs.push_back(entityManager->getEntity(subsJSON["entity"]));
+		return true;
+	});
+}
+
+bool Subscription::resolve(const string& file, const nlohmann::json& subsJSON, vector<int>& IDs, bool& defaultState) {
+	if (!subsJSON.is_object()) return false;
+
+	if (!subsJSON.contains("generated") && subsJSON.contains("entity")) {
+		if (!file.empty()) entitiesFP[subsJSON["entity"]] = file;
+		// We skipped subscriptions for unknown entities
+		if (entityManager->getEntity(subsJSON["entity"]) == -1) return false;
+	}
+
+	// Firstly, we check if its a tag attributed subscription.
+	if (subsJSON.contains("tags")) {
+		// Get every entities from that tag
+		vector<string> tags = subsJSON["tags"];
+		// We get every entities of the given tags
+		for (const auto& tag : tags) {
+			vector<int> localIDs = entityManager->getEntities(tag, false);
+			IDs.insert(IDs.end(), localIDs.begin(), localIDs.end());
 		}
+	}
+	else if (subsJSON.contains("generated") && subsJSON["generated"]) {
+		// Search by prefix, for the generated entities
+		IDs = entityManager->getEntities(subsJSON["entity"]);
+	}
+	else {
+		// Otherwise, by complete name
+		IDs.push_back(entityManager->getEntity(subsJSON["entity"]));
+	}
 
-		// We check if a default state is given and apply it to the components
-		bool defaultState = true;
+	// An entity can be found through several tags, it is subscribed only once.
+	sort(IDs.begin(), IDs.end());
+	IDs.erase(unique(IDs.begin(), IDs.end()), IDs.end());
 
-		if (subsJSON.contains("state")) defaultState = subsJSON["state"];
+	// We check if a default state is given and apply it to the components
+	if (subsJSON.contains("state")) defaultState = subsJSON["state"];
 
-		nlohmann::json components = subsJSON["components"];
-		for (const auto& component : components) {
-			string name = component["name"];
+	return true;
+}
 
-			if (!managers->contains(name)) continue; // Skip the unknown components.
+void Subscription::apply(const nlohmann::json& component, const vector<int>& IDs, bool defaultState) {
+	string name = component["name"];
 
-			shared_ptr<ComponentManager> compManager = managers->at(name);
+	if (!managers->contains(name)) return; // Skip the unknown components.
 
-			dataVector data;
+	shared_ptr<ComponentManager> compManager = managers->at(name);
 
-			for (const auto& [key, value] : component["data"].items()) {
-				data.push_back({ key, valueToType(value, compManager->getType(key)) });
-			}
+	dataVector data;
 
-			for (const auto& entity : IDs) {
-				compManager->subscribe(entity, data);
-				if (!defaultState) {
-					compManager->setState(entity, false);
-				}
-			}
+	for (const auto& [key, value] : component["data"].items()) {
+		data.push_back({ key, valueToType(value, compManager->getTypeID(key)) });
+	}
+
+	compManager->subscribe(IDs, data);
+	if (!defaultState) {
+		for (const auto& entity : IDs) {
+			compManager->setState(entity, false);
 		}
 	}
 }
 
 void Subscription::save(int entity) {
-	string name = entityManager->getName(entity);
-	string path;
-	if (entitiesFP.contains(name)) {
-		path = entitiesFP[name];
-	}
-	else {
-		path = directory + "/" + name + ".json";
+	write(capture(entity));
+}
+
+void Subscription::save(const vector<int>& entities, const string& file, bool compact) {
+	vector<EntityImage> images = capture(entities);
+
+	if (!file.empty()) {
+		write(images, file, compact);
+		return;
 	}
 
-	ofstream subsFile(path);
+	// One file per entity, written in parallel.
+	vector<exception_ptr> errors(images.size());
+	ThreadPool::global().parallelFor(images.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			try {
+				write(images[i], compact);
+			}
+			catch (...) {
+				errors[i] = current_exception();
+			}
+		}
+	});
 
-	nlohmann::ordered_json subsJSON;
-	subsJSON["entity"] = name;
+	for (const auto& error : errors) {
+		if (error) rethrow_exception(error);
+	}
+}
 
-	vector<shared_ptr<Component>> components;
+EntityImage Subscription::capture(int entity) {
+	return move(capture(vector<int>{ entity }).front());
+}
 
-	// Get the list of the entity's components
+vector<EntityImage> Subscription::capture(const vector<int>& entities) {
+	vector<EntityImage> images(entities.size());
+	for (size_t i = 0; i < entities.size(); ++i) {
+		images[i].name = entityManager->getName(entities[i]);
+		if (entitiesFP.contains(images[i].name)) {
+			images[i].path = entitiesFP[images[i].name];
+		}
+		else {
+			images[i].path = directory + "/" + images[i].name + ".json";
+		}
+	}
+
+	// Each manager is visited once for the whole batch.
 	for (const auto& [_, manager] : *managers) {
-		if (manager->hasEntity(entity)) {
-			components.push_back(manager->getComponent(entity));
+		for (size_t i = 0; i < entities.size(); ++i) {
+			if (manager->hasEntity(entities[i])) {
+				shared_ptr<Component> component = manager->getComponent(entities[i]);
+				images[i].components.emplace_back(component->getName(), component->copyRawData());
+			}
 		}
 	}
 
-	vector<nlohmann::ordered_json> componentsJSON;
+	return images;
+}
+
+const unordered_map<string, string>& Subscription::getFiles() {
+	return entitiesFP;
+}
+
+void Subscription::addManager(shared_ptr<ComponentManager> manager) {
+	managers->insert({ manager->getName(), manager });
+}
+
+void Subscription::removeManager(const string& name) {
+	managers->erase(name);
+}
+
+void Subscription::write(const EntityImage& image, bool compact) {
+	ofstream subsFile(image.path);
+
+	if (!subsFile) {
+		throw runtime_error("Error : Can't write the file \"" + image.path + "\"");
+	}
+
+	writeEntity(subsFile, image, compact, 0);
+	if (!subsFile.flush()) {
+		throw runtime_error("Error : Can't write the file \"" + image.path + "\"");
+	}
+}
+
+void Subscription::write(const vector<EntityImage>& images, const string& file, bool compact) {
+	ofstream subsFile(file);
 
-	for (const auto& component : components) {
-		nlohmann::ordered_json dict;
-		dict["name"] = component->getName();
-		dict["data"] = serializeType(component->getRawData());
-		componentsJSON.push_back(dict);
+	if (!subsFile) {
+		throw runtime_error("Error : Can't write the file \"" + file + "\"");
 	}
 
-	subsJSON["components"] = componentsJSON;
+	subsFile << '[';
+	for (size_t i = 0; i < images.size(); ++i) {
+		if (i != 0) subsFile << ',';
+		if (!compact) subsFile << "\n    ";
+		writeEntity(subsFile, images[i], compact, compact ? 0 : 4);
+	}
+	if (!compact && !images.empty()) subsFile << '\n';
+	subsFile << ']';
+
+	if (!subsFile.flush()) {
+		throw runtime_error("Error : Can't write the file \"" + file + "\"");
+	}
+}
+
+void Subscription::writeEntity(ostream& stream, const EntityImage& image, bool compact, int indent) {
+	// Written as it goes, the same text as the dump of the JSON object (indented by 4, or compact).
+	auto line = [&stream, compact, indent](int depth) {
+		if (!compact) stream << '\n' << string(indent + 4 * depth, ' ');
+	};
+	const char* colon = compact ? ":" : ": ";
 
-	subsFile << subsJSON.dump(4);
+	stream << "{";
+	line(1);
+	stream << "\"entity\"" << colon;
+	stringToJSON(stream, image.name);
+	stream << ',';
+	line(1);
+	stream << "\"components\"" << colon << '[';
+
+	for (size_t i = 0; i < image.components.size(); ++i) {
+		const auto& [name, data] = image.components[i];
+		if (i != 0) stream << ',';
+		line(2);
+		stream << '{';
+		line(3);
+		stream << "\"name\"" << colon;
+		stringToJSON(stream, name);
+		stream << ',';
+		line(3);
+		stream << "\"data\"" << colon << '{';
+
+		bool first = true;
+		for (const auto& [key, value] : data) {
+			if (!first) stream << ',';
+			line(4);
+			stringToJSON(stream, key);
+			stream << colon;
+			valueToJSON(stream, value.second, compact ? -1 : indent + 4 * 5);
+			first = false;
+		}
+		if (!data.empty()) line(3);
+		stream << '}';
+		line(2);
+		stream << '}';
+	}
+	if (!image.components.empty()) line(1);
+	stream << ']';
+	line(0);
+	stream << '}';
 }
\ No newline at end of file
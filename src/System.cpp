@@ -12,7 +12,7 @@ void System::newEntity(int entity) {
 
 	// Verify if the entity is already present, in which case we have to remove it first and then check back if we need it.
 	// Handle the changement of state of a component.
-	if (entities.contains(entity)) entities.erase(entity);
+	bool known = entities.erase(entity) > 0;
 
 	// Firstly, we checked the tags (faster).
 	if (!desiredTags.empty()) {
@@ -21,6 +21,7 @@ void System::newEntity(int entity) {
 			if (environment->hasTag(entity, tag)) {
 				entities.insert(entity);
 				change = true;
+				if (lod && !known) lod->add(entity);
 				return;
 			}
 		}
@@ -45,6 +46,7 @@ void System::newEntity(int entity) {
 		}
 		entities.insert(entity);
 		change = true;
+		if (lod && !known) lod->add(entity);
 	}
 }
 
@@ -103,3 +105,97 @@ void System::addTags(vector<string> names) {
 	}
 	environment->notify(ID);
 }
+
+vector<int> System::select(span<const int> candidates) {
+	scoped_lock lock(mtx);
+	vector<int> selected;
+	for (int entity : candidates) {
+		if (entities.contains(entity)) selected.push_back(entity);
+	}
+	return selected;
+}
+
+void System::addChanged(const string& name) {
+	if (environment->getManager(name)) environment->enableChangeTracking(name);
+	followedChanges.push_back({ name, {}, 0 });
+}
+
+vector<int> System::getChanged() {
+	vector<int> changed;
+	unordered_set<int> seen;
+	for (Followed& followed : followedChanges) {
+		shared_ptr<ChangeTracker> tracker = environment->getChangeTracker(followed.component);
+		if (!tracker && environment->getManager(followed.component)) tracker = environment->enableChangeTracking(followed.component);
+		if (!tracker) continue;
+
+		// Another tracker (e.g.: the component was added again) counts every entity as changed.
+		if (tracker != followed.tracker.lock()) {
+			followed.tracker = tracker;
+			followed.tick = 0;
+		}
+		for (int entity : tracker->changedSince(followed.tick)) {
+			if (followedChanges.size() == 1 || seen.insert(entity).second) changed.push_back(entity);
+		}
+	}
+
+	scoped_lock lock(mtx);
+	erase_if(changed, [this](int entity) {
+		return !entities.contains(entity);
+	});
+	return changed;
+}
+
+bool System::overBudget() {
+	return deadline != chrono::steady_clock::time_point::max() && chrono::steady_clock::now() >= deadline;
+}
+
+void System::setLOD(function<float(int)> priority, vector<float> thresholds, vector<size_t> periods) {
+	shared_ptr<UpdateLOD> levels = make_shared<UpdateLOD>(std::move(priority), std::move(thresholds), std::move(periods));
+	scoped_lock lock(mtx);
+	for (int entity : entities) {
+		levels->add(entity);
+	}
+	lod = levels;
+}
+
+vector<int> System::getLOD() {
+	shared_ptr<UpdateLOD> levels;
+	{
+		scoped_lock lock(mtx);
+		if (!lod) return vector<int>(entities.begin(), entities.end());
+		levels = lod;
+	}
+	// The entities removed from the System are dropped when they are due.
+	return levels->next([this](int entity) {
+		scoped_lock lock(mtx);
+		return entities.contains(entity);
+	});
+}
+
+SlicedSystem::SlicedSystem(shared_ptr<Environment> environment, bool autoUpdate) : System(environment, autoUpdate), cursor(0) {}
+
+void SlicedSystem::run() {
+	if (cursor == pass.size()) {
+		scoped_lock lock(mtx);
+		pass.assign(entities.begin(), entities.end());
+		cursor = 0;
+	}
+
+	// The clock is read every few entities, the budget is soft.
+	constexpr size_t checkEvery = 16;
+	size_t processed = 0;
+	while (cursor < pass.size()) {
+		int entity = pass[cursor++];
+		{
+			// Removed from the System since the pass started.
+			scoped_lock lock(mtx);
+			if (!entities.contains(entity)) continue;
+		}
+		process(entity);
+		if (++processed % checkEvery == 0 && overBudget()) break;
+	}
+}
+
+bool SlicedSystem::isPassDone() {
+	return cursor == pass.size();
+}
@@ -0,0 +1,118 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+	// The pool whose loop the current thread is working on, to detect nested loops.
+	thread_local ThreadPool* currentPool = nullptr;
+}
+
+ThreadPool::ThreadPool(size_t threads) : job(nullptr), count(0), grain(1), next(0), active(0), generation(0), stop(false) {
+	if (threads == 0) {
+		size_t hardware = thread::hardware_concurrency();
+		threads = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	for (size_t i = 0; i < threads; ++i) {
+		workers.emplace_back([this]() { this->run(); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		scoped_lock lock(mtx);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::global() {
+	static ThreadPool pool;
+	return pool;
+}
+
+size_t ThreadPool::getSize() {
+	return workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t, size_t)>& function, size_t grain) {
+	if (count == 0) return;
+	grain = max<size_t>(grain, 1);
+
+	// Small or nested loops are not worth waking the threads.
+	if (workers.empty() || count <= grain || currentPool == this) {
+		function(0, count);
+		return;
+	}
+
+	scoped_lock jobLock(jobMtx); // One loop at a time.
+	{
+		scoped_lock lock(mtx);
+		job = &function;
+		this->count = count;
+		this->grain = grain;
+		next = 0;
+		active = workers.size();
+		error = nullptr;
+		++generation;
+	}
+	wake.notify_all();
+
+	work();
+
+	exception_ptr thrown;
+	{
+		unique_lock lock(mtx);
+		done.wait(lock, [this]() { return active == 0; });
+		job = nullptr;
+		thrown = error;
+	}
+
+	if (thrown) rethrow_exception(thrown);
+}
+
+void ThreadPool::run() {
+	uint64_t seen = 0;
+
+	while (true) {
+		{
+			unique_lock lock(mtx);
+			wake.wait(lock, [this, seen]() { return stop || generation != seen; });
+			if (stop) return;
+			seen = generation;
+		}
+
+		work();
+
+		{
+			scoped_lock lock(mtx);
+			--active;
+		}
+		done.notify_one();
+	}
+}
+
+void ThreadPool::work() {
+	ThreadPool* previous = currentPool;
+	currentPool = this;
+
+	while (true) {
+		size_t begin = next.fetch_add(grain);
+		if (begin >= count) break;
+		size_t end = min(begin + grain, count);
+
+		try {
+			(*job)(begin, end);
+		}
+		catch (...) {
+			scoped_lock lock(mtx);
+			if (!error) error = current_exception();
+		}
+	}
+
+	currentPool = previous;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file TimerWheel.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <TimerWheel.h>
+
+using namespace std;
+
+TimerWheel::TimerWheel() : heads(overflow + 1, none), sizes(levels + 1, 0), tick(0), pending(0) {}
+
+TimerID TimerWheel::removeAfter(int entity, uint64_t ticks) {
+	scoped_lock lock(mtx);
+	return add(ticks, TimerAction::Remove, entity, none, false, nullptr);
+}
+
+TimerID TimerWheel::setStateAfter(int entity, const string& component, bool state, uint64_t ticks) {
+	scoped_lock lock(mtx);
+	auto [found, inserted] = componentIDs.try_emplace(component, static_cast<uint32_t>(components.size()));
+	if (inserted) components.push_back(component);
+	return add(ticks, TimerAction::State, entity, found->second, state, nullptr);
+}
+
+TimerID TimerWheel::callAfter(uint64_t ticks, function<void()> callback, int entity) {
+	if (!callback) throw runtime_error("Error : a timer can't call an empty function.");
+	scoped_lock lock(mtx);
+	return add(ticks, TimerAction::Callback, entity, none, false, std::move(callback));
+}
+
+bool TimerWheel::cancel(TimerID ID) {
+	scoped_lock lock(mtx);
+	uint32_t index = static_cast<uint32_t>(ID & UINT32_MAX);
+	uint32_t generation = static_cast<uint32_t>(ID >> 32);
+	if (index >= timers.size() || timers[index].generation != generation || timers[index].list == none) return false;
+	release(index);
+	return true;
+}
+
+void TimerWheel::cancelEntity(int entity) {
+	scoped_lock lock(mtx);
+	auto found = entityHeads.find(entity);
+	while (found != entityHeads.end()) {
+		release(found->second);
+		found = entityHeads.find(entity);
+	}
+}
+
+ExpiredTimers TimerWheel::advance(uint64_t ticks) {
+	ExpiredTimers expired;
+	scoped_lock lock(mtx);
+	uint64_t target = tick + ticks;
+	while (tick < target) {
+		if (pending == 0) {
+			tick = target;
+			break;
+		}
+		// The ticks before the next slot of the lowest level with timers are skipped, nothing expires or cascades there.
+		size_t lowest = 0;
+		while (sizes[lowest] == 0) ++lowest;
+		if (lowest > 0) tick = min(tick | ((uint64_t(1) << (slotBits * lowest)) - 1), target - 1);
+
+		++tick;
+		// Entering a new slot of a level brings its timers down, from the highest level.
+		if ((tick & (slotCount - 1)) == 0) {
+			size_t level = 1;
+			while (level < levels && ((tick >> (slotBits * level)) & (slotCount - 1)) == 0) ++level;
+			if (level == levels) cascade(overflow);
+			for (size_t l = min(level, levels - 1); l >= 1; --l) {
+				cascade(static_cast<uint32_t>(l * slotCount + ((tick >> (slotBits * l)) & (slotCount - 1))));
+			}
+		}
+
+		uint32_t list = static_cast<uint32_t>(tick & (slotCount - 1));
+		while (heads[list] != none) {
+			uint32_t index = heads[list];
+			Timer& timer = timers[index];
+			switch (timer.action) {
+			case TimerAction::Remove:
+				expired.removed.push_back(timer.entity);
+				break;
+			case TimerAction::State:
+				expired.states.push_back({ timer.entity, components[timer.component], timer.state });
+				break;
+			case TimerAction::Callback:
+				expired.callbacks.push_back(std::move(timer.callback));
+				break;
+			}
+			release(index);
+		}
+	}
+	return expired;
+}
+
+uint64_t TimerWheel::getTick() {
+	scoped_lock lock(mtx);
+	return tick;
+}
+
+size_t TimerWheel::size() {
+	scoped_lock lock(mtx);
+	return pending;
+}
+
+void TimerWheel::onRemove(EntityManager& manager, int entity, const string& name) {
+	cancelEntity(entity);
+}
+
+TimerID TimerWheel::add(uint64_t ticks, TimerAction action, int entity, uint32_t component, bool state, function<void()> callback) {
+	uint32_t index;
+	if (!freeTimers.empty()) {
+		index = freeTimers.back();
+		freeTimers.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>(timers.size());
+		timers.push_back({});
+		timers[index].generation = 0;
+	}
+
+	Timer& timer = timers[index];
+	timer.deadline = tick + max<uint64_t>(ticks, 1);
+	timer.entity = entity;
+	timer.component = component;
+	timer.action = action;
+	timer.state = state;
+	timer.callback = std::move(callback);
+	++timer.generation;
+	link(index);
+
+	// Linked at the head of its entity's list.
+	timer.entityPrevious = none;
+	timer.entityNext = none;
+	if (entity >= 0) {
+		auto [head, inserted] = entityHeads.try_emplace(entity, index);
+		if (!inserted) {
+			timer.entityNext = head->second;
+			timers[head->second].entityPrevious = index;
+			head->second = index;
+		}
+	}
+	++pending;
+	return (static_cast<uint64_t>(timer.generation) << 32) | index;
+}
+
+void TimerWheel::link(uint32_t index) {
+	Timer& timer = timers[index];
+	uint32_t list = overflow;
+	// The lowest level whose window, seen from the current tick, contains the deadline.
+	for (size_t level = 0; level < levels; ++level) {
+		if ((timer.deadline >> (slotBits * (level + 1))) == (tick >> (slotBits * (level + 1)))) {
+			list = static_cast<uint32_t>(level * slotCount + ((timer.deadline >> (slotBits * level)) & (slotCount - 1)));
+			break;
+		}
+	}
+
+	timer.list = list;
+	++sizes[list / slotCount];
+	timer.previous = none;
+	timer.next = heads[list];
+	if (heads[list] != none) timers[heads[list]].previous = index;
+	heads[list] = index;
+}
+
+void TimerWheel::unlink(uint32_t index) {
+	Timer& timer = timers[index];
+	if (timer.previous != none) timers[timer.previous].next = timer.next;
+	else heads[timer.list] = timer.next;
+	if (timer.next != none) timers[timer.next].previous = timer.previous;
+	--sizes[timer.list / slotCount];
+	timer.list = none;
+}
+
+void TimerWheel::release(uint32_t index) {
+	unlink(index);
+
+	Timer& timer = timers[index];
+	if (timer.entity >= 0) {
+		if (timer.entityPrevious != none) timers[timer.entityPrevious].entityNext = timer.entityNext;
+		else if (timer.entityNext != none) entityHeads[timer.entity] = timer.entityNext;
+		else entityHeads.erase(timer.entity);
+		if (timer.entityNext != none) timers[timer.entityNext].entityPrevious = timer.entityPrevious;
+	}
+	timer.callback = nullptr;
+	freeTimers.push_back(index);
+	--pending;
+}
+
+void TimerWheel::cascade(uint32_t list) {
+	uint32_t index = heads[list];
+	heads[list] = none;
+	while (index != none) {
+		uint32_t next = timers[index].next;
+		--sizes[list / slotCount];
+		link(index);
+		index = next;
+	}
+}
@@ -0,0 +1,148 @@
+#include "TypeRegistry.h"
+#include "TM_Tools.h"
+
+using namespace std;
+
+TypeRegistry& TypeRegistry::global() {
+	static TypeRegistry registry;
+	return registry;
+}
+
+const TypeInfo& TypeRegistry::get(size_t typeID) {
+	if (typeID < getFirstID() || typeID - getFirstID() >= types.size()) {
+		throw runtime_error("Error : invalid type ID " + to_string(typeID) + ".");
+	}
+	return types[typeID - getFirstID()];
+}
+
+size_t TypeRegistry::find(const string& name) {
+	auto found = names.find(name);
+	if (found == names.end()) return variant_npos;
+	return found->second;
+}
+
+size_t TypeRegistry::findHash(uint64_t hash) {
+	auto found = hashes.find(hash);
+	if (found == hashes.end()) return variant_npos;
+	return found->second;
+}
+
+size_t TypeRegistry::getFirstID() {
+	return variant_size_v<variant<ECS_Types>> - 1; // Every type but CustomValue.
+}
+
+size_t TypeRegistry::insert(TypeInfo info) {
+	if (names.contains(info.name)) {
+		const TypeInfo& registered = get(names[info.name]);
+		if (registered.size != info.size || registered.toJSON != info.toJSON) {
+			throw runtime_error("Error : the type \"" + info.name + "\" is already registered.");
+		}
+		return names[info.name];
+	}
+
+	// A name of ECS_Types can't be taken.
+	bool builtin = true;
+	try {
+		typeToID(info.name);
+	}
+	catch (runtime_error&) {
+		builtin = false;
+	}
+	if (builtin) {
+		throw runtime_error("Error : the type \"" + info.name + "\" is already registered.");
+	}
+
+	info.hash = hashBytes(info.name.data(), info.name.size());
+	size_t typeID = getFirstID() + types.size();
+	names[info.name] = typeID;
+	hashes[info.hash] = typeID;
+	types.push_back(move(info));
+	return typeID;
+}
+
+CustomValue::CustomValue(size_t typeID) {
+	allocate(typeID);
+	TypeRegistry::global().get(typeID).construct(data());
+}
+
+CustomValue::CustomValue(size_t typeID, const nlohmann::json& value) {
+	allocate(typeID);
+	TypeRegistry::global().get(typeID).fromJSON(value, data());
+}
+
+CustomValue::CustomValue(const CustomValue& other) {
+	allocate(other.typeID);
+	memcpy(data(), other.data(), TypeRegistry::global().get(typeID).size);
+}
+
+CustomValue::CustomValue(CustomValue&& other) noexcept : typeID(other.typeID) {
+	// The heap's room changes hands, the inline bytes are copied.
+	memcpy(bytes, other.bytes, inlineSize);
+	other.heap = nullptr;
+	other.typeID = 0;
+}
+
+CustomValue& CustomValue::operator=(const CustomValue& other) {
+	if (this == &other) return *this;
+
+	release();
+	allocate(other.typeID);
+	memcpy(data(), other.data(), TypeRegistry::global().get(typeID).size);
+	return *this;
+}
+
+CustomValue& CustomValue::operator=(CustomValue&& other) noexcept {
+	if (this == &other) return *this;
+
+	release();
+	typeID = other.typeID;
+	memcpy(bytes, other.bytes, inlineSize);
+	other.heap = nullptr;
+	other.typeID = 0;
+	return *this;
+}
+
+CustomValue::~CustomValue() {
+	release();
+}
+
+size_t CustomValue::getTypeID() const {
+	return typeID;
+}
+
+const void* CustomValue::data() const {
+	if (onHeap(TypeRegistry::global().get(typeID))) return heap;
+	return bytes;
+}
+
+void* CustomValue::data() {
+	return const_cast<void*>(static_cast<const CustomValue*>(this)->data());
+}
+
+bool CustomValue::operator==(const CustomValue& other) const {
+	return typeID == other.typeID && memcmp(data(), other.data(), TypeRegistry::global().get(typeID).size) == 0;
+}
+
+bool CustomValue::onHeap(const TypeInfo& info) {
+	return info.size > inlineSize || info.alignment > 8;
+}
+
+void CustomValue::allocate(size_t typeID) {
+	const TypeInfo& info = TypeRegistry::global().get(typeID);
+	this->typeID = static_cast<uint32_t>(typeID);
+	if (onHeap(info)) heap = ::operator new(info.size, align_val_t(info.alignment));
+}
+
+void CustomValue::release() {
+	// A moved value (type ID 0) owns nothing.
+	if (typeID == 0) return;
+	if (onHeap(TypeRegistry::global().get(typeID))) {
+		::operator delete(heap, align_val_t(TypeRegistry::global().get(typeID).alignment));
+	}
+	typeID = 0;
+}
+
+ostream& operator<<(ostream& os, const CustomValue& value) {
+	os << TypeRegistry::global().get(value.getTypeID()).toJSON(value.data()).dump();
+	return os;
+}
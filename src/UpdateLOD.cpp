@@ -0,0 +1,144 @@
+/**
+ * @file UpdateLOD.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <UpdateLOD.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+UpdateLOD::UpdateLOD(function<float(int)> priority, vector<float> thresholds, vector<size_t> periods) : priority(std::move(priority)), thresholds(std::move(thresholds)), periods(std::move(periods)), run(0) {
+	if (!this->priority) throw runtime_error("Error : the update LOD needs a priority function.");
+	if (this->periods.size() != this->thresholds.size() + 1) throw runtime_error("Error : the update LOD needs one period more than thresholds.");
+	if (!is_sorted(this->thresholds.begin(), this->thresholds.end())) throw runtime_error("Error : the thresholds of the update LOD should be increasing.");
+
+	slots.resize(this->periods.size());
+	for (size_t level = 0; level < this->periods.size(); ++level) {
+		if (this->periods[level] == 0) throw runtime_error("Error : the periods of the update LOD should be at least 1.");
+		slots[level].resize(this->periods[level]);
+	}
+}
+
+void UpdateLOD::add(int entity) {
+	scoped_lock lock(mtx);
+	pending.push_back(entity);
+}
+
+vector<int> UpdateLOD::next(const function<bool(int)>& alive) {
+	vector<int> added;
+	{
+		scoped_lock lock(mtx);
+		added.swap(pending);
+	}
+
+	vector<int> due;
+	vector<Place> from;
+	for (size_t level = 0; level < slots.size(); ++level) {
+		size_t slot = run % periods[level];
+		vector<int>& entities = slots[level][slot];
+		for (int entity : entities) {
+			due.push_back(entity);
+			from.push_back({ level, slot });
+		}
+		// Put back below, in the same slot if they stay in this level.
+		entities.clear();
+	}
+	for (int entity : added) {
+		// Already followed (e.g.: removed then added again before it was dropped).
+		if (places.contains(entity)) continue;
+		places[entity] = { slots.size(), 0 };
+		due.push_back(entity);
+		from.push_back({ slots.size(), 0 });
+	}
+	++run;
+
+	vector<int> updated;
+	updated.reserve(due.size());
+	vector<pair<int, size_t>> moved;
+	size_t i = 0;
+	try {
+		for (; i < due.size(); ++i) {
+			int entity = due[i];
+			if (!alive(entity)) {
+				places.erase(entity);
+				continue;
+			}
+			updated.push_back(entity);
+			size_t level = levelOf(priority(entity));
+			if (level == from[i].level) put(entity, level, from[i].slot);
+			else moved.push_back({ entity, level });
+		}
+	}
+	catch (...) {
+		// A user's function threw: the entities not placed yet go back to their slots, the new ones are added again at the next run.
+		for (; i < due.size(); ++i) {
+			if (from[i].level < slots.size()) {
+				put(due[i], from[i].level, from[i].slot);
+				continue;
+			}
+			places.erase(due[i]);
+			scoped_lock lock(mtx);
+			pending.push_back(due[i]);
+		}
+		for (const auto& [entity, level] : moved) {
+			put(entity, level, numeric_limits<size_t>::max());
+		}
+		throw;
+	}
+
+	// Once the others are back in their slots, the least filled slots are known.
+	for (const auto& [entity, level] : moved) {
+		put(entity, level, numeric_limits<size_t>::max());
+	}
+	return updated;
+}
+
+size_t UpdateLOD::getLevel(int entity) {
+	auto found = places.find(entity);
+	return found == places.end() || found->second.level >= slots.size() ? string::npos : found->second.level;
+}
+
+size_t UpdateLOD::count(size_t level) {
+	if (level >= slots.size()) return 0;
+	size_t n = 0;
+	for (const vector<int>& entities : slots[level]) {
+		n += entities.size();
+	}
+	return n;
+}
+
+function<float(int)> UpdateLOD::distance(shared_ptr<ComponentManager> manager, const string& field, function<Vector3()> origin) {
+	if (!manager) throw runtime_error("Error : the distance of the update LOD needs a manager.");
+	if (manager->getTypeID(field) != typeToID("vector3")) throw runtime_error("Error : the data \"" + field + "\" of \"" + manager->getName() + "\" is not a Vector3.");
+
+	weak_ptr<ComponentManager> weak = manager;
+	return [weak, field, origin](int entity) {
+		shared_ptr<ComponentManager> manager = weak.lock();
+		// An entity without the component is the least important, getComponent would throw.
+		if (!manager || !manager->hasEntity(entity, true)) return numeric_limits<float>::infinity();
+		return !(manager->getComponent(entity)->get<Vector3>(field) - origin());
+	};
+}
+
+size_t UpdateLOD::levelOf(float priority) {
+	// NaN goes to the last level.
+	if (std::isnan(priority)) return thresholds.size();
+	return upper_bound(thresholds.begin(), thresholds.end(), priority) - thresholds.begin();
+}
+
+void UpdateLOD::put(int entity, size_t level, size_t slot) {
+	vector<vector<int>>& levelSlots = slots[level];
+	if (slot >= levelSlots.size()) {
+		// The least filled slot keeps the runs even.
+		slot = min_element(levelSlots.begin(), levelSlots.end(), [](const vector<int>& a, const vector<int>& b) {
+			return a.size() < b.size();
+		}) - levelSlots.begin();
+	}
+	levelSlots[slot].push_back(entity);
+	places[entity] = { level, slot };
+}
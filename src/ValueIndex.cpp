@@ -0,0 +1,277 @@
+/**
+ * @file ValueIndex.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <ValueIndex.h>
+#include <ThreadPool.h>
+
+using namespace std;
+
+namespace {
+
+inline bool isNaN(const IndexValue& value) {
+	return holds_alternative<float>(value) && isnan(get<float>(value));
+}
+
+}
+
+ValueIndex::ValueIndex(shared_ptr<ComponentManager> manager, const string& field, ValueIndexKind kind) : manager(manager), field(field), kind(kind), typeID(variant_npos) {
+	if (!manager) throw runtime_error("Error : a value index needs a manager.");
+	rebuild();
+}
+
+EntitySpan ValueIndex::equal(const IndexValue& value) {
+	IndexValue key = convert(value);
+	if (isNaN(key)) return {};
+	scoped_lock lock(mtx);
+
+	if (kind == ValueIndexKind::Hash) {
+		auto found = buckets.find(key);
+		if (found == buckets.end()) return {};
+		return EntitySpan(found->second, 0, found->second->size());
+	}
+
+	merge();
+	auto [first, last] = equal_range(values.begin(), values.end(), key);
+	return slice(first - values.begin(), last - values.begin());
+}
+
+EntitySpan ValueIndex::range(const IndexValue& min, const IndexValue& max) {
+	checkOrdered();
+	IndexValue low = convert(min);
+	IndexValue high = convert(max);
+	if (isNaN(low) || isNaN(high) || high < low) return {};
+	scoped_lock lock(mtx);
+
+	merge();
+	size_t begin = lower_bound(values.begin(), values.end(), low) - values.begin();
+	size_t end = upper_bound(values.begin(), values.end(), high) - values.begin();
+	return slice(begin, end);
+}
+
+EntitySpan ValueIndex::below(const IndexValue& value, bool inclusive) {
+	checkOrdered();
+	IndexValue key = convert(value);
+	if (isNaN(key)) return {};
+	scoped_lock lock(mtx);
+
+	merge();
+	auto bound = inclusive ? upper_bound(values.begin(), values.end(), key) : lower_bound(values.begin(), values.end(), key);
+	return slice(0, bound - values.begin());
+}
+
+EntitySpan ValueIndex::above(const IndexValue& value, bool inclusive) {
+	checkOrdered();
+	IndexValue key = convert(value);
+	if (isNaN(key)) return {};
+	scoped_lock lock(mtx);
+
+	merge();
+	auto bound = inclusive ? lower_bound(values.begin(), values.end(), key) : upper_bound(values.begin(), values.end(), key);
+	return slice(bound - values.begin(), values.size());
+}
+
+void ValueIndex::rebuild() {
+	shared_ptr<ComponentManager> manager = this->manager.lock();
+	if (!manager) throw runtime_error("Error : the manager of the value index doesn't exist anymore.");
+
+	// The data's type is checked again, the manager may have been reshaped.
+	size_t typeID = manager->getTypeID(field);
+	if (typeID >= variant_size_v<IndexValue>) {
+		throw runtime_error("Error : the data \"" + field + "\" of \"" + manager->getName() + "\" is not an int, a float, a string or a bool.");
+	}
+
+	// One lock of the manager for the whole snapshot, the components are read outside of it.
+	vector<int> entities;
+	vector<shared_ptr<Component>> components;
+	{
+		scoped_lock lock(manager->mtx);
+		entities.reserve(manager->mapEC.size());
+		components.reserve(manager->mapEC.size());
+		for (const auto& [entity, value] : manager->mapEC) {
+			entities.push_back(entity);
+			components.push_back(value.first);
+		}
+	}
+
+	scoped_lock lock(mtx);
+	this->typeID = typeID;
+	vector<IndexValue> current(entities.size());
+	ThreadPool::global().parallelFor(entities.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			current[i] = read(*components[i]);
+		}
+	}, 1024);
+
+	// The vectors shared with an EntitySpan are kept by it, the index starts over.
+	entries.clear();
+	buckets.clear();
+	values.clear();
+	ids = make_shared<const vector<int>>();
+	changed.clear();
+	for (size_t i = 0; i < entities.size(); ++i) {
+		update(entities[i], move(current[i]));
+	}
+	merge();
+}
+
+size_t ValueIndex::size() {
+	scoped_lock lock(mtx);
+	return entries.size();
+}
+
+const string& ValueIndex::getField() {
+	return field;
+}
+
+ValueIndexKind ValueIndex::getKind() {
+	return kind;
+}
+
+shared_ptr<ComponentManager> ValueIndex::getManager() {
+	return manager.lock();
+}
+
+void ValueIndex::onSubscribe(ComponentManager& manager, int entity) {
+	// Already unsubscribed by another listener of the notification.
+	if (!manager.hasEntity(entity, true)) return;
+	shared_ptr<Component> component = manager.getComponent(entity);
+	IndexValue value = read(*component);
+
+	scoped_lock lock(mtx);
+	update(entity, move(value));
+}
+
+void ValueIndex::onUnsubscribe(ComponentManager& manager, int entity, shared_ptr<Component> component, bool state) {
+	scoped_lock lock(mtx);
+	remove(entity);
+}
+
+void ValueIndex::afterSet(ComponentManager& manager, int entity, Component& component, const string& name) {
+	if (name != field) return;
+	IndexValue value = read(component);
+
+	scoped_lock lock(mtx);
+	update(entity, move(value));
+}
+
+IndexValue ValueIndex::read(Component& component) {
+	switch (typeID) {
+	case 0:
+		return component.get<int>(field);
+	case 1:
+		return component.get<float>(field);
+	case 2:
+		return component.get<string>(field);
+	default:
+		return component.get<bool>(field);
+	}
+}
+
+IndexValue ValueIndex::convert(const IndexValue& value) {
+	if (value.index() == typeID) return value;
+	if (typeID == 1 && holds_alternative<int>(value)) return static_cast<float>(get<int>(value));
+	throw runtime_error("Error : the value doesn't match the type of the indexed data \"" + field + "\".");
+}
+
+void ValueIndex::checkOrdered() {
+	if (kind != ValueIndexKind::Ordered) {
+		throw runtime_error("Error : the hash index of \"" + field + "\" only answers the equality queries.");
+	}
+}
+
+void ValueIndex::update(int entity, IndexValue value) {
+	if (isNaN(value)) {
+		remove(entity);
+		return;
+	}
+
+	auto found = entries.find(entity);
+	if (found != entries.end()) {
+		if (found->second.value == value) return;
+		if (kind == ValueIndexKind::Hash) unlink(found->second);
+	}
+
+	Entry& entry = found != entries.end() ? found->second : entries[entity];
+	entry.value = move(value);
+	if (kind == ValueIndexKind::Hash) {
+		vector<int>& list = bucket(entry.value);
+		entry.slot = static_cast<uint32_t>(list.size());
+		list.push_back(entity);
+	}
+	else {
+		changed.insert(entity);
+	}
+}
+
+void ValueIndex::remove(int entity) {
+	auto found = entries.find(entity);
+	if (found == entries.end()) return;
+
+	if (kind == ValueIndexKind::Hash) unlink(found->second);
+	else changed.insert(entity);
+	entries.erase(found);
+}
+
+vector<int>& ValueIndex::bucket(const IndexValue& value) {
+	shared_ptr<vector<int>>& list = buckets[value];
+	if (!list) list = make_shared<vector<int>>();
+	else if (list.use_count() > 1) list = make_shared<vector<int>>(*list);
+	return *list;
+}
+
+void ValueIndex::unlink(const Entry& entry) {
+	vector<int>& list = bucket(entry.value);
+	int last = list.back();
+	uint32_t slot = entry.slot;
+	list[slot] = last;
+	entries[last].slot = slot;
+	list.pop_back();
+	if (list.empty()) buckets.erase(entry.value);
+}
+
+void ValueIndex::merge() {
+	if (changed.empty()) return;
+
+	vector<pair<IndexValue, int>> added;
+	added.reserve(changed.size());
+	for (int entity : changed) {
+		auto found = entries.find(entity);
+		if (found != entries.end()) added.push_back({ found->second.value, entity });
+	}
+	sort(added.begin(), added.end(), [](const auto& a, const auto& b) {
+		return a.first < b.first;
+	});
+
+	// The sorted values still current are kept in order, the changed ones are merged in between.
+	vector<IndexValue> merged;
+	shared_ptr<vector<int>> mergedIDs = make_shared<vector<int>>();
+	merged.reserve(entries.size());
+	mergedIDs->reserve(entries.size());
+	size_t next = 0;
+	for (size_t i = 0; i < values.size(); ++i) {
+		int entity = (*ids)[i];
+		if (changed.contains(entity)) continue;
+		for (; next < added.size() && added[next].first < values[i]; ++next) {
+			merged.push_back(move(added[next].first));
+			mergedIDs->push_back(added[next].second);
+		}
+		merged.push_back(move(values[i]));
+		mergedIDs->push_back(entity);
+	}
+	for (; next < added.size(); ++next) {
+		merged.push_back(move(added[next].first));
+		mergedIDs->push_back(added[next].second);
+	}
+
+	values = move(merged);
+	ids = move(mergedIDs);
+	changed.clear();
+}
+
+EntitySpan ValueIndex::slice(size_t begin, size_t end) {
+	return EntitySpan(ids, begin, max(begin, end));
+}
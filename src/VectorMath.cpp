@@ -0,0 +1,673 @@
+/**
+ * @file VectorMath.cpp
+ * Project TailorMade
+ * @author Thomas K/BIDI
+ * @version 2.0
+ */
+
+#include <VectorMath.h>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TM_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TM_TARGET_AVX2
+#endif
+
+using namespace std;
+
+static_assert(sizeof(Vector2) == 2 * sizeof(float) && sizeof(Vector3) == 3 * sizeof(float), "The vectors should be arrays of floats.");
+
+namespace {
+
+/**
+ * Partial sums, minimums and maximums of the reduce kernels: the i-th value goes in the lane i % 8 whatever the instruction set.
+ */
+typedef struct Lanes {
+	float sum[8];
+	float min[8];
+	float max[8];
+} Lanes;
+
+/**
+ * Kernels of an instruction set, on arrays of floats (add, scale, addScaled) or on columns of n vectors (the others).
+ * The z column of the inputs is null for 2D vectors, except for cross.
+ */
+typedef struct Kernels {
+	void (*add)(const float* a, const float* b, float* out, size_t n);
+	void (*scale)(const float* a, float s, float* out, size_t n);
+	void (*addScaled)(const float* a, const float* b, float s, float* out, size_t n);
+	void (*dot)(const VectorColumns& a, const VectorColumns& b, float* out, size_t n);
+	void (*cross)(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n);
+	void (*length)(const VectorColumns& a, float* out, size_t n);
+	void (*normalize)(const VectorColumns& a, const VectorColumns& out, size_t n);
+	void (*project)(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n);
+	void (*reduce)(const float* a, size_t n, Lanes& lanes);
+} Kernels;
+
+/**
+ * Return the columns starting at the i-th vector, used for the last vectors of the SIMD kernels.
+ */
+VectorColumns offset(const VectorColumns& columns, size_t i) {
+	return { columns.x + i, columns.y + i, columns.z ? columns.z + i : nullptr, columns.size - i };
+}
+
+/*
+ * Scalar kernels, computing in the same order as the operators of Vector2 and Vector3.
+ */
+
+void addScalar(const float* a, const float* b, float* out, size_t n) {
+	for (size_t i = 0; i < n; ++i) out[i] = a[i] + b[i];
+}
+
+void scaleScalar(const float* a, float s, float* out, size_t n) {
+	for (size_t i = 0; i < n; ++i) out[i] = a[i] * s;
+}
+
+void addScaledScalar(const float* a, const float* b, float s, float* out, size_t n) {
+	for (size_t i = 0; i < n; ++i) out[i] = a[i] + b[i] * s;
+}
+
+inline float dotAt(const VectorColumns& a, const VectorColumns& b, size_t i) {
+	float d = a.x[i] * b.x[i] + a.y[i] * b.y[i];
+	if (a.z) d += a.z[i] * b.z[i];
+	return d;
+}
+
+void dotScalar(const VectorColumns& a, const VectorColumns& b, float* out, size_t n) {
+	for (size_t i = 0; i < n; ++i) out[i] = dotAt(a, b, i);
+}
+
+void crossScalar(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		float x = a.y[i] * b.z[i] - a.z[i] * b.y[i];
+		float y = a.z[i] * b.x[i] - a.x[i] * b.z[i];
+		float z = a.x[i] * b.y[i] - a.y[i] * b.x[i];
+		out.x[i] = x;
+		out.y[i] = y;
+		out.z[i] = z;
+	}
+}
+
+void lengthScalar(const VectorColumns& a, float* out, size_t n) {
+	for (size_t i = 0; i < n; ++i) out[i] = sqrt(dotAt(a, a, i));
+}
+
+void normalizeScalar(const VectorColumns& a, const VectorColumns& out, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		float norm = sqrt(dotAt(a, a, i));
+		if (norm == 0.0f) {
+			out.x[i] = out.y[i] = 0.0f;
+			if (out.z) out.z[i] = 0.0f;
+			continue;
+		}
+		out.x[i] = a.x[i] / norm;
+		out.y[i] = a.y[i] / norm;
+		if (out.z) out.z[i] = a.z[i] / norm;
+	}
+}
+
+void projectScalar(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		float norm2 = dotAt(b, b, i);
+		float k = norm2 == 0.0f ? 0.0f : dotAt(a, b, i) / norm2;
+		out.x[i] = b.x[i] * k;
+		out.y[i] = b.y[i] * k;
+		if (out.z) out.z[i] = b.z[i] * k;
+	}
+}
+
+// Same comparisons as the SIMD min/max instructions, the lane is kept when a value is NaN.
+void reduceScalar(const float* a, size_t n, Lanes& lanes) {
+	for (size_t i = 0; i < n; ++i) {
+		size_t lane = i % 8;
+		lanes.sum[lane] += a[i];
+		lanes.min[lane] = a[i] < lanes.min[lane] ? a[i] : lanes.min[lane];
+		lanes.max[lane] = a[i] > lanes.max[lane] ? a[i] : lanes.max[lane];
+	}
+}
+
+const Kernels scalarKernels = { addScalar, scaleScalar, addScaledScalar, dotScalar, crossScalar, lengthScalar, normalizeScalar, projectScalar, reduceScalar };
+
+#ifdef TM_X86_64
+
+/*
+ * SSE kernels, 4 vectors at once, the last ones by the scalar kernels.
+ */
+
+inline __m128 dotAtSSE(const VectorColumns& a, const VectorColumns& b, size_t i) {
+	__m128 d = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a.x + i), _mm_loadu_ps(b.x + i)), _mm_mul_ps(_mm_loadu_ps(a.y + i), _mm_loadu_ps(b.y + i)));
+	if (a.z) d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(a.z + i), _mm_loadu_ps(b.z + i)));
+	return d;
+}
+
+void addSSE(const float* a, const float* b, float* out, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	addScalar(a + i, b + i, out + i, n - i);
+}
+
+void scaleSSE(const float* a, float s, float* out, size_t n) {
+	__m128 k = _mm_set1_ps(s);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), k));
+	scaleScalar(a + i, s, out + i, n - i);
+}
+
+void addScaledSSE(const float* a, const float* b, float s, float* out, size_t n) {
+	__m128 k = _mm_set1_ps(s);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_mul_ps(_mm_loadu_ps(b + i), k)));
+	addScaledScalar(a + i, b + i, s, out + i, n - i);
+}
+
+void dotSSE(const VectorColumns& a, const VectorColumns& b, float* out, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, dotAtSSE(a, b, i));
+	dotScalar(offset(a, i), offset(b, i), out + i, n - i);
+}
+
+void crossSSE(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 ax = _mm_loadu_ps(a.x + i), ay = _mm_loadu_ps(a.y + i), az = _mm_loadu_ps(a.z + i);
+		__m128 bx = _mm_loadu_ps(b.x + i), by = _mm_loadu_ps(b.y + i), bz = _mm_loadu_ps(b.z + i);
+		_mm_storeu_ps(out.x + i, _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)));
+		_mm_storeu_ps(out.y + i, _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)));
+		_mm_storeu_ps(out.z + i, _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)));
+	}
+	crossScalar(offset(a, i), offset(b, i), offset(out, i), n - i);
+}
+
+void lengthSSE(const VectorColumns& a, float* out, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, _mm_sqrt_ps(dotAtSSE(a, a, i)));
+	lengthScalar(offset(a, i), out + i, n - i);
+}
+
+void normalizeSSE(const VectorColumns& a, const VectorColumns& out, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 norm = _mm_sqrt_ps(dotAtSSE(a, a, i));
+		__m128 valid = _mm_cmpneq_ps(norm, _mm_setzero_ps()); // The null vectors stay null
+		_mm_storeu_ps(out.x + i, _mm_and_ps(valid, _mm_div_ps(_mm_loadu_ps(a.x + i), norm)));
+		_mm_storeu_ps(out.y + i, _mm_and_ps(valid, _mm_div_ps(_mm_loadu_ps(a.y + i), norm)));
+		if (out.z) _mm_storeu_ps(out.z + i, _mm_and_ps(valid, _mm_div_ps(_mm_loadu_ps(a.z + i), norm)));
+	}
+	normalizeScalar(offset(a, i), offset(out, i), n - i);
+}
+
+void projectSSE(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 norm2 = dotAtSSE(b, b, i);
+		__m128 valid = _mm_cmpneq_ps(norm2, _mm_setzero_ps());
+		__m128 k = _mm_and_ps(valid, _mm_div_ps(dotAtSSE(a, b, i), norm2));
+		_mm_storeu_ps(out.x + i, _mm_mul_ps(_mm_loadu_ps(b.x + i), k));
+		_mm_storeu_ps(out.y + i, _mm_mul_ps(_mm_loadu_ps(b.y + i), k));
+		if (out.z) _mm_storeu_ps(out.z + i, _mm_mul_ps(_mm_loadu_ps(b.z + i), k));
+	}
+	projectScalar(offset(a, i), offset(b, i), offset(out, i), n - i);
+}
+
+void reduceSSE(const float* a, size_t n, Lanes& lanes) {
+	__m128 sumLow = _mm_loadu_ps(lanes.sum), sumHigh = _mm_loadu_ps(lanes.sum + 4);
+	__m128 minLow = _mm_loadu_ps(lanes.min), minHigh = _mm_loadu_ps(lanes.min + 4);
+	__m128 maxLow = _mm_loadu_ps(lanes.max), maxHigh = _mm_loadu_ps(lanes.max + 4);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128 low = _mm_loadu_ps(a + i), high = _mm_loadu_ps(a + i + 4);
+		sumLow = _mm_add_ps(sumLow, low);
+		sumHigh = _mm_add_ps(sumHigh, high);
+		minLow = _mm_min_ps(low, minLow);
+		minHigh = _mm_min_ps(high, minHigh);
+		maxLow = _mm_max_ps(low, maxLow);
+		maxHigh = _mm_max_ps(high, maxHigh);
+	}
+	_mm_storeu_ps(lanes.sum, sumLow);
+	_mm_storeu_ps(lanes.sum + 4, sumHigh);
+	_mm_storeu_ps(lanes.min, minLow);
+	_mm_storeu_ps(lanes.min + 4, minHigh);
+	_mm_storeu_ps(lanes.max, maxLow);
+	_mm_storeu_ps(lanes.max + 4, maxHigh);
+	reduceScalar(a + i, n - i, lanes);
+}
+
+const Kernels sseKernels = { addSSE, scaleSSE, addScaledSSE, dotSSE, crossSSE, lengthSSE, normalizeSSE, projectSSE, reduceSSE };
+
+/*
+ * AVX2 kernels, 8 vectors at once, the last ones by the scalar kernels.
+ */
+
+TM_TARGET_AVX2 inline __m256 dotAtAVX2(const VectorColumns& a, const VectorColumns& b, size_t i) {
+	__m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a.x + i), _mm256_loadu_ps(b.x + i)), _mm256_mul_ps(_mm256_loadu_ps(a.y + i), _mm256_loadu_ps(b.y + i)));
+	if (a.z) d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(a.z + i), _mm256_loadu_ps(b.z + i)));
+	return d;
+}
+
+TM_TARGET_AVX2 void addAVX2(const float* a, const float* b, float* out, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	addScalar(a + i, b + i, out + i, n - i);
+}
+
+TM_TARGET_AVX2 void scaleAVX2(const float* a, float s, float* out, size_t n) {
+	__m256 k = _mm256_set1_ps(s);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), k));
+	scaleScalar(a + i, s, out + i, n - i);
+}
+
+TM_TARGET_AVX2 void addScaledAVX2(const float* a, const float* b, float s, float* out, size_t n) {
+	__m256 k = _mm256_set1_ps(s);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_mul_ps(_mm256_loadu_ps(b + i), k)));
+	addScaledScalar(a + i, b + i, s, out + i, n - i);
+}
+
+TM_TARGET_AVX2 void dotAVX2(const VectorColumns& a, const VectorColumns& b, float* out, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, dotAtAVX2(a, b, i));
+	dotScalar(offset(a, i), offset(b, i), out + i, n - i);
+}
+
+TM_TARGET_AVX2 void crossAVX2(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 ax = _mm256_loadu_ps(a.x + i), ay = _mm256_loadu_ps(a.y + i), az = _mm256_loadu_ps(a.z + i);
+		__m256 bx = _mm256_loadu_ps(b.x + i), by = _mm256_loadu_ps(b.y + i), bz = _mm256_loadu_ps(b.z + i);
+		_mm256_storeu_ps(out.x + i, _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by)));
+		_mm256_storeu_ps(out.y + i, _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz)));
+		_mm256_storeu_ps(out.z + i, _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx)));
+	}
+	crossScalar(offset(a, i), offset(b, i), offset(out, i), n - i);
+}
+
+TM_TARGET_AVX2 void lengthAVX2(const VectorColumns& a, float* out, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_sqrt_ps(dotAtAVX2(a, a, i)));
+	lengthScalar(offset(a, i), out + i, n - i);
+}
+
+TM_TARGET_AVX2 void normalizeAVX2(const VectorColumns& a, const VectorColumns& out, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 norm = _mm256_sqrt_ps(dotAtAVX2(a, a, i));
+		__m256 valid = _mm256_cmp_ps(norm, _mm256_setzero_ps(), _CMP_NEQ_UQ); // The null vectors stay null
+		_mm256_storeu_ps(out.x + i, _mm256_and_ps(valid, _mm256_div_ps(_mm256_loadu_ps(a.x + i), norm)));
+		_mm256_storeu_ps(out.y + i, _mm256_and_ps(valid, _mm256_div_ps(_mm256_loadu_ps(a.y + i), norm)));
+		if (out.z) _mm256_storeu_ps(out.z + i, _mm256_and_ps(valid, _mm256_div_ps(_mm256_loadu_ps(a.z + i), norm)));
+	}
+	normalizeScalar(offset(a, i), offset(out, i), n - i);
+}
+
+TM_TARGET_AVX2 void projectAVX2(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, size_t n) {
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 norm2 = dotAtAVX2(b, b, i);
+		__m256 valid = _mm256_cmp_ps(norm2, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+		__m256 k = _mm256_and_ps(valid, _mm256_div_ps(dotAtAVX2(a, b, i), norm2));
+		_mm256_storeu_ps(out.x + i, _mm256_mul_ps(_mm256_loadu_ps(b.x + i), k));
+		_mm256_storeu_ps(out.y + i, _mm256_mul_ps(_mm256_loadu_ps(b.y + i), k));
+		if (out.z) _mm256_storeu_ps(out.z + i, _mm256_mul_ps(_mm256_loadu_ps(b.z + i), k));
+	}
+	projectScalar(offset(a, i), offset(b, i), offset(out, i), n - i);
+}
+
+TM_TARGET_AVX2 void reduceAVX2(const float* a, size_t n, Lanes& lanes) {
+	__m256 sum = _mm256_loadu_ps(lanes.sum), min = _mm256_loadu_ps(lanes.min), max = _mm256_loadu_ps(lanes.max);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 values = _mm256_loadu_ps(a + i);
+		sum = _mm256_add_ps(sum, values);
+		min = _mm256_min_ps(values, min);
+		max = _mm256_max_ps(values, max);
+	}
+	_mm256_storeu_ps(lanes.sum, sum);
+	_mm256_storeu_ps(lanes.min, min);
+	_mm256_storeu_ps(lanes.max, max);
+	reduceScalar(a + i, n - i, lanes);
+}
+
+const Kernels avx2Kernels = { addAVX2, scaleAVX2, addScaledAVX2, dotAVX2, crossAVX2, lengthAVX2, normalizeAVX2, projectAVX2, reduceAVX2 };
+
+#endif
+
+const Kernels& kernelsOf(SimdLevel level) {
+#ifdef TM_X86_64
+	if (level == SimdLevel::AVX2) return avx2Kernels;
+	if (level == SimdLevel::SSE) return sseKernels;
+#endif
+	return scalarKernels;
+}
+
+/**
+ * The instruction set in use, the best one supported when first used.
+ */
+SimdLevel& currentLevel() {
+	static SimdLevel level = VectorMath::detect();
+	return level;
+}
+
+const Kernels& kernels() {
+	return kernelsOf(currentLevel());
+}
+
+/*
+ * The spans of Vector2/Vector3 are reordered by blocks in columns for the kernels, then written back.
+ */
+
+constexpr size_t blockSize = 256;
+
+typedef struct Block {
+	alignas(32) float x[blockSize];
+	alignas(32) float y[blockSize];
+	alignas(32) float z[blockSize];
+} Block;
+
+template<typename Vector>
+VectorColumns columnsOf(Block& block, size_t count) {
+	return { block.x, block.y, is_same_v<Vector, Vector3> ? block.z : nullptr, count };
+}
+
+template<typename Vector>
+void split(const Vector* vectors, size_t count, Block& block) {
+	size_t i = 0;
+#ifdef TM_X86_64
+	// SSE is on every x86-64 CPU, 4 vectors are reordered at once
+	const float* in = reinterpret_cast<const float*>(vectors);
+	for (; i + 4 <= count; i += 4) {
+		if constexpr (is_same_v<Vector, Vector3>) {
+			__m128 a = _mm_loadu_ps(in + 3 * i), b = _mm_loadu_ps(in + 3 * i + 4), c = _mm_loadu_ps(in + 3 * i + 8); // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+			_mm_store_ps(block.x + i, _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0)));
+			_mm_store_ps(block.y + i, _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_store_ps(block.z + i, _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+		else {
+			__m128 a = _mm_loadu_ps(in + 2 * i), b = _mm_loadu_ps(in + 2 * i + 4); // x0 y0 x1 y1 | x2 y2 x3 y3
+			_mm_store_ps(block.x + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_store_ps(block.y + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		block.x[i] = vectors[i].x;
+		block.y[i] = vectors[i].y;
+		if constexpr (is_same_v<Vector, Vector3>) block.z[i] = vectors[i].z;
+	}
+}
+
+template<typename Vector>
+void merge(const Block& block, size_t count, Vector* vectors) {
+	size_t i = 0;
+#ifdef TM_X86_64
+	float* out = reinterpret_cast<float*>(vectors);
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_load_ps(block.x + i), y = _mm_load_ps(block.y + i);
+		if constexpr (is_same_v<Vector, Vector3>) {
+			__m128 z = _mm_load_ps(block.z + i);
+			_mm_storeu_ps(out + 3 * i, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(out + 3 * i + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(out + 3 * i + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+		else {
+			_mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(x, y));
+			_mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(x, y));
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		vectors[i].x = block.x[i];
+		vectors[i].y = block.y[i];
+		if constexpr (is_same_v<Vector, Vector3>) vectors[i].z = block.z[i];
+	}
+}
+
+/**
+ * Run a kernel on the vectors by blocks, b and out can be null, values (the floats' output) too.
+ */
+template<typename Vector, typename Kernel>
+void byBlocks(size_t n, const Vector* a, const Vector* b, Vector* out, float* values, Kernel kernel) {
+	// The output is filled by the kernel through its columns, which the compiler can't follow: zeroed once.
+	Block blockA, blockB, blockOut = {};
+	for (size_t i = 0; i < n; i += blockSize) {
+		size_t count = min(blockSize, n - i);
+		split(a + i, count, blockA);
+		if (b) split(b + i, count, blockB);
+		// The unused blocks are given as null columns, their floats are never read.
+		VectorColumns columnsB = b ? columnsOf<Vector>(blockB, count) : VectorColumns{ nullptr, nullptr, nullptr, 0 };
+		VectorColumns columnsOut = out ? columnsOf<Vector>(blockOut, count) : VectorColumns{ nullptr, nullptr, nullptr, 0 };
+		kernel(columnsOf<Vector>(blockA, count), columnsB, columnsOut, values ? values + i : nullptr, count);
+		if (out) merge(blockOut, count, out + i);
+	}
+}
+
+/**
+ * Check the sizes of the arrays, an error is thrown if one of them doesn't have n elements.
+ */
+void checkSizes(size_t n, initializer_list<size_t> sizes) {
+	for (size_t size : sizes) {
+		if (size != n) throw runtime_error("Error : the arrays of vectors should have the same size (" + to_string(size) + " instead of " + to_string(n) + ").");
+	}
+}
+
+/**
+ * Check that the columns have the same size and dimension as a, an error is thrown otherwise (the empty ones can be null).
+ */
+void checkColumns(const VectorColumns& a, const VectorColumns& other) {
+	checkSizes(a.size, { other.size });
+	if (a.size == 0) return;
+	if (!a.x || !a.y || !other.x || !other.y) throw runtime_error("Error : the x and y columns of the vectors should be given.");
+	if (!a.z != !other.z) throw runtime_error("Error : the vectors should be all 2D or all 3D.");
+}
+
+template<typename Vector>
+const float* floats(span<const Vector> vectors) {
+	return reinterpret_cast<const float*>(vectors.data());
+}
+
+template<typename Vector>
+float* floats(span<Vector> vectors) {
+	return reinterpret_cast<float*>(vectors.data());
+}
+
+}
+
+SimdLevel VectorMath::getLevel() {
+	return currentLevel();
+}
+
+SimdLevel VectorMath::setLevel(SimdLevel level) {
+	if (level > detect()) level = detect();
+	currentLevel() = level;
+	return level;
+}
+
+SimdLevel VectorMath::detect() {
+#if defined(TM_X86_64) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+	return SimdLevel::SSE;
+#elif defined(TM_X86_64) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX, and the YMM registers saved by the OS
+	__cpuidex(info, 7, 0);
+	if (avx && (info[1] & (1 << 5))) return SimdLevel::AVX2;
+	return SimdLevel::SSE;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+void VectorMath::add(span<const Vector2> a, span<const Vector2> b, span<Vector2> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	kernels().add(floats(a), floats(b), floats(out), a.size() * 2);
+}
+
+void VectorMath::add(span<const Vector3> a, span<const Vector3> b, span<Vector3> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	kernels().add(floats(a), floats(b), floats(out), a.size() * 3);
+}
+
+void VectorMath::add(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out) {
+	checkColumns(a, b);
+	checkColumns(a, out);
+	kernels().add(a.x, b.x, out.x, a.size);
+	kernels().add(a.y, b.y, out.y, a.size);
+	if (a.z) kernels().add(a.z, b.z, out.z, a.size);
+}
+
+void VectorMath::scale(span<const Vector2> a, float s, span<Vector2> out) {
+	checkSizes(a.size(), { out.size() });
+	kernels().scale(floats(a), s, floats(out), a.size() * 2);
+}
+
+void VectorMath::scale(span<const Vector3> a, float s, span<Vector3> out) {
+	checkSizes(a.size(), { out.size() });
+	kernels().scale(floats(a), s, floats(out), a.size() * 3);
+}
+
+void VectorMath::scale(const VectorColumns& a, float s, const VectorColumns& out) {
+	checkColumns(a, out);
+	kernels().scale(a.x, s, out.x, a.size);
+	kernels().scale(a.y, s, out.y, a.size);
+	if (a.z) kernels().scale(a.z, s, out.z, a.size);
+}
+
+void VectorMath::addScaled(span<const Vector2> a, span<const Vector2> b, float s, span<Vector2> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	kernels().addScaled(floats(a), floats(b), s, floats(out), a.size() * 2);
+}
+
+void VectorMath::addScaled(span<const Vector3> a, span<const Vector3> b, float s, span<Vector3> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	kernels().addScaled(floats(a), floats(b), s, floats(out), a.size() * 3);
+}
+
+void VectorMath::addScaled(const VectorColumns& a, const VectorColumns& b, float s, const VectorColumns& out) {
+	checkColumns(a, b);
+	checkColumns(a, out);
+	kernels().addScaled(a.x, b.x, s, out.x, a.size);
+	kernels().addScaled(a.y, b.y, s, out.y, a.size);
+	if (a.z) kernels().addScaled(a.z, b.z, s, out.z, a.size);
+}
+
+void VectorMath::dot(span<const Vector2> a, span<const Vector2> b, span<float> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	byBlocks(a.size(), a.data(), b.data(), static_cast<Vector2*>(nullptr), out.data(), [](const VectorColumns& a, const VectorColumns& b, const VectorColumns&, float* values, size_t n) {
+		kernels().dot(a, b, values, n);
+	});
+}
+
+void VectorMath::dot(span<const Vector3> a, span<const Vector3> b, span<float> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	byBlocks(a.size(), a.data(), b.data(), static_cast<Vector3*>(nullptr), out.data(), [](const VectorColumns& a, const VectorColumns& b, const VectorColumns&, float* values, size_t n) {
+		kernels().dot(a, b, values, n);
+	});
+}
+
+void VectorMath::dot(const VectorColumns& a, const VectorColumns& b, span<float> out) {
+	checkColumns(a, b);
+	checkSizes(a.size, { out.size() });
+	kernels().dot(a, b, out.data(), a.size);
+}
+
+void VectorMath::cross(span<const Vector3> a, span<const Vector3> b, span<Vector3> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	byBlocks(a.size(), a.data(), b.data(), out.data(), nullptr, [](const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, float*, size_t n) {
+		kernels().cross(a, b, out, n);
+	});
+}
+
+void VectorMath::cross(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out) {
+	checkColumns(a, b);
+	checkColumns(a, out);
+	if (a.size && !a.z) throw runtime_error("Error : the cross product needs 3D vectors.");
+	kernels().cross(a, b, out, a.size);
+}
+
+void VectorMath::length(span<const Vector2> a, span<float> out) {
+	checkSizes(a.size(), { out.size() });
+	byBlocks(a.size(), a.data(), static_cast<const Vector2*>(nullptr), static_cast<Vector2*>(nullptr), out.data(), [](const VectorColumns& a, const VectorColumns&, const VectorColumns&, float* values, size_t n) {
+		kernels().length(a, values, n);
+	});
+}
+
+void VectorMath::length(span<const Vector3> a, span<float> out) {
+	checkSizes(a.size(), { out.size() });
+	byBlocks(a.size(), a.data(), static_cast<const Vector3*>(nullptr), static_cast<Vector3*>(nullptr), out.data(), [](const VectorColumns& a, const VectorColumns&, const VectorColumns&, float* values, size_t n) {
+		kernels().length(a, values, n);
+	});
+}
+
+void VectorMath::length(const VectorColumns& a, span<float> out) {
+	checkColumns(a, a);
+	checkSizes(a.size, { out.size() });
+	kernels().length(a, out.data(), a.size);
+}
+
+void VectorMath::normalize(span<const Vector2> a, span<Vector2> out) {
+	checkSizes(a.size(), { out.size() });
+	byBlocks(a.size(), a.data(), static_cast<const Vector2*>(nullptr), out.data(), nullptr, [](const VectorColumns& a, const VectorColumns&, const VectorColumns& out, float*, size_t n) {
+		kernels().normalize(a, out, n);
+	});
+}
+
+void VectorMath::normalize(span<const Vector3> a, span<Vector3> out) {
+	checkSizes(a.size(), { out.size() });
+	byBlocks(a.size(), a.data(), static_cast<const Vector3*>(nullptr), out.data(), nullptr, [](const VectorColumns& a, const VectorColumns&, const VectorColumns& out, float*, size_t n) {
+		kernels().normalize(a, out, n);
+	});
+}
+
+void VectorMath::normalize(const VectorColumns& a, const VectorColumns& out) {
+	checkColumns(a, out);
+	kernels().normalize(a, out, a.size);
+}
+
+void VectorMath::project(span<const Vector2> a, span<const Vector2> b, span<Vector2> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	byBlocks(a.size(), a.data(), b.data(), out.data(), nullptr, [](const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, float*, size_t n) {
+		kernels().project(a, b, out, n);
+	});
+}
+
+void VectorMath::project(span<const Vector3> a, span<const Vector3> b, span<Vector3> out) {
+	checkSizes(a.size(), { b.size(), out.size() });
+	byBlocks(a.size(), a.data(), b.data(), out.data(), nullptr, [](const VectorColumns& a, const VectorColumns& b, const VectorColumns& out, float*, size_t n) {
+		kernels().project(a, b, out, n);
+	});
+}
+
+void VectorMath::project(const VectorColumns& a, const VectorColumns& b, const VectorColumns& out) {
+	checkColumns(a, b);
+	checkColumns(a, out);
+	kernels().project(a, b, out, a.size);
+}
+
+FloatReduction VectorMath::reduce(span<const float> values) {
+	Lanes lanes;
+	fill(begin(lanes.sum), end(lanes.sum), 0.0f);
+	fill(begin(lanes.min), end(lanes.min), numeric_limits<float>::infinity());
+	fill(begin(lanes.max), end(lanes.max), -numeric_limits<float>::infinity());
+	kernels().reduce(values.data(), values.size(), lanes);
+
+	// The lanes are combined by halves, in the same order whatever the instruction set.
+	for (size_t width = 4; width > 0; width /= 2) {
+		for (size_t lane = 0; lane < width; ++lane) {
+			lanes.sum[lane] += lanes.sum[lane + width];
+			lanes.min[lane] = lanes.min[lane + width] < lanes.min[lane] ? lanes.min[lane + width] : lanes.min[lane];
+			lanes.max[lane] = lanes.max[lane + width] > lanes.max[lane] ? lanes.max[lane + width] : lanes.max[lane];
+		}
+	}
+	return { lanes.sum[0], lanes.min[0], lanes.max[0] };
+}